@@ -6,13 +6,17 @@ add_library(diskimage
   ${LIBDISKIMAGE_DIR}/DIATABlockStorage.cpp
   ${LIBDISKIMAGE_DIR}/DIBackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DIBlockStorage.cpp
+  ${LIBDISKIMAGE_DIR}/DICachedBlockStorage.cpp
   ${LIBDISKIMAGE_DIR}/DICommon.cpp
+  ${LIBDISKIMAGE_DIR}/DICompressedBackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DIDC42BackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DIDDLDiskStorage.cpp
   ${LIBDISKIMAGE_DIR}/DIDiskStorage.cpp
   ${LIBDISKIMAGE_DIR}/DIFDIDiskStorage.cpp
   ${LIBDISKIMAGE_DIR}/DIFileBackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DILogicalDiskStorage.cpp
+  ${LIBDISKIMAGE_DIR}/DIMappedFileBackingStore.cpp
+  ${LIBDISKIMAGE_DIR}/DIOverlayBackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DIRAMBackingStore.cpp
   ${LIBDISKIMAGE_DIR}/DIRAWBlockStorage.cpp
   ${LIBDISKIMAGE_DIR}/DIV2DDiskStorage.cpp
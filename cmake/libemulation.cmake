@@ -7,7 +7,10 @@ add_library(emulation
   ${LIBEMULATION_DIR}/Core/OEDocument.cpp
   ${LIBEMULATION_DIR}/Core/OEEmulation.cpp
   ${LIBEMULATION_DIR}/Core/OEImage.cpp
+  ${LIBEMULATION_DIR}/Core/OEMappedData.cpp
   ${LIBEMULATION_DIR}/Core/OEPackage.cpp
+  ${LIBEMULATION_DIR}/Core/OESharedData.cpp
+  ${LIBEMULATION_DIR}/Core/OESnapshot.cpp
   ${LIBEMULATION_DIR}/Core/OESound.cpp
   ${LIBEMULATION_DIR}/Implementation/Apple/Apple1ACI.cpp
   ${LIBEMULATION_DIR}/Implementation/Apple/Apple1IO.cpp
@@ -55,6 +58,7 @@ add_library(emulation
   ${LIBEMULATION_DIR}/Implementation/Generic/RAM.cpp
   ${LIBEMULATION_DIR}/Implementation/Generic/ROM.cpp
   ${LIBEMULATION_DIR}/Implementation/Generic/VRAM.cpp
+  ${LIBEMULATION_DIR}/Implementation/Generic/WarpPolicy.cpp
   ${LIBEMULATION_DIR}/Implementation/MOS/MOS6502.cpp
   #${LIBEMULATION_DIR}/Implementation/MOS/MOS6509.cpp
   ${LIBEMULATION_DIR}/Implementation/MOS/MOS6522.cpp
@@ -8,7 +8,7 @@
  * Accesses an ATA block storage
  */
 
-#include "DIFileBackingStore.h"
+#include "DIMappedFileBackingStore.h"
 #include "DIRAMBackingStore.h"
 #include "DIATABlockStorage.h"
 
@@ -17,6 +17,8 @@ DIATABlockStorage::DIATABlockStorage()
     forceWriteProtected = false;
     maxSize = 0;
     
+    overlay = false;
+    
     close();
 }
 
@@ -29,14 +31,27 @@ bool DIATABlockStorage::open(string path)
 {
     close();
     
-    if (fileBackingStore.open(path) && open(&fileBackingStore))
+    // With an overlay, the base image is opened read-only
+    DIBackingStore *backingStore = NULL;
+    
+    if (compressedBackingStore.open(path, !overlay))
+        backingStore = &compressedBackingStore;
+    else if (fileBackingStore.open(path, !overlay))
+        backingStore = &fileBackingStore;
+    
+    if (backingStore && overlay)
+        backingStore = openOverlay(backingStore) ? &overlayBackingStore : NULL;
+    
+    if (backingStore && open(backingStore))
     {
+        cachedBlockStorage.open(blockStorage);
+        
         model = getLastPathComponent(path);
         
         return true;
     }
-    else
-        fileBackingStore.close();
+    
+    close();
     
     return false;
 }
@@ -47,6 +62,8 @@ bool DIATABlockStorage::open(DIData& data)
     
     if (ramBackingStore.open(data) && open(&ramBackingStore))
     {
+        cachedBlockStorage.open(blockStorage);
+        
         model = "Memory Disk Image";
         
         return true;
@@ -82,7 +99,7 @@ bool DIATABlockStorage::open(DIBackingStore *backingStore)
     }
     else
     {
-        string pathExtension = strtolower(getPathExtension(fileBackingStore.getPath()));
+        string pathExtension = strtolower(getPathExtension(getImagePath()));
         
         if ((pathExtension != "image") &&
             (pathExtension != "img") &&
@@ -101,6 +118,27 @@ bool DIATABlockStorage::open(DIBackingStore *backingStore)
     return true;
 }
 
+bool DIATABlockStorage::openOverlay(DIBackingStore *backingStore)
+{
+    // Without an overlay path, the delta is kept in RAM
+    if (overlayPath == "")
+        return overlayBackingStore.open(backingStore);
+    
+    if (!deltaBackingStore.open(overlayPath) &&
+        !deltaBackingStore.create(overlayPath))
+        return false;
+    
+    return overlayBackingStore.open(backingStore, &deltaBackingStore);
+}
+
+string DIATABlockStorage::getImagePath()
+{
+    if (compressedBackingStore.getPath() != "")
+        return compressedBackingStore.getImagePath();
+    
+    return fileBackingStore.getPath();
+}
+
 bool DIATABlockStorage::isOpen()
 {
     return blockStorage != &dummyBlockStorage;
@@ -108,12 +146,17 @@ bool DIATABlockStorage::isOpen()
 
 void DIATABlockStorage::close()
 {
+    cachedBlockStorage.close();
+    
     rawBlockStorage.close();
     vdiBlockStorage.close();
     vmdkBlockStorage.close();
     
     twoImgBackingStore.close();
     dc42BackingStore.close();
+    overlayBackingStore.close();
+    deltaBackingStore.close();
+    compressedBackingStore.close();
     fileBackingStore.close();
     ramBackingStore.close();
     
@@ -124,6 +167,9 @@ void DIATABlockStorage::close()
 
 string DIATABlockStorage::getPath()
 {
+    if (compressedBackingStore.getPath() != "")
+        return compressedBackingStore.getPath();
+    
     return fileBackingStore.getPath();
 }
 
@@ -192,12 +238,81 @@ void DIATABlockStorage::setMaxSize(DIInt value)
     maxSize = value;
 }
 
+void DIATABlockStorage::setCacheSize(DIInt value)
+{
+    cachedBlockStorage.setCacheSize(value);
+}
+
+DIInt DIATABlockStorage::getCacheSize()
+{
+    return cachedBlockStorage.getCacheSize();
+}
+
+bool DIATABlockStorage::flush()
+{
+    bool success = cachedBlockStorage.flush();
+    
+    return overlayBackingStore.flush() && success;
+}
+
+DILong DIATABlockStorage::getCacheHitNum()
+{
+    return cachedBlockStorage.getHitNum();
+}
+
+DILong DIATABlockStorage::getCacheMissNum()
+{
+    return cachedBlockStorage.getMissNum();
+}
+
+void DIATABlockStorage::setOverlay(bool value)
+{
+    overlay = value;
+}
+
+bool DIATABlockStorage::getOverlay()
+{
+    return overlay;
+}
+
+void DIATABlockStorage::setOverlayPath(string value)
+{
+    overlayPath = value;
+}
+
+string DIATABlockStorage::getOverlayPath()
+{
+    return overlayPath;
+}
+
+bool DIATABlockStorage::commitOverlay()
+{
+    // Compressed base images are not reopened for writing
+    if (!overlayBackingStore.isOpen() ||
+        (compressedBackingStore.getPath() != ""))
+        return false;
+    
+    if (!flush())
+        return false;
+    
+    // Reopen base image with write access while committing
+    string path = fileBackingStore.getPath();
+    
+    fileBackingStore.open(path, true);
+    
+    bool success = overlayBackingStore.commit();
+    
+    fileBackingStore.open(path, false);
+    
+    return success;
+}
+
 bool DIATABlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
 {
-    return blockStorage->readBlocks(index, buf, num);
+    return cachedBlockStorage.readBlocks(index, buf, num);
 }
 
 bool DIATABlockStorage::writeBlocks(DIInt index, const DIChar *buf, DIInt num)
 {
-    return blockStorage->writeBlocks(index, buf, num);
+    return cachedBlockStorage.writeBlocks(index, buf, num);
 }
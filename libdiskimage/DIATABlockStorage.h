@@ -11,8 +11,10 @@
 #ifndef _DIATABLOCKSTORAGE_H
 #define _DIATABLOCKSTORAGE_H
 
-#include "DIFileBackingStore.h"
+#include "DIMappedFileBackingStore.h"
 #include "DIRAMBackingStore.h"
+#include "DIOverlayBackingStore.h"
+#include "DICompressedBackingStore.h"
 #include "DI2IMGBackingStore.h"
 #include "DIDC42BackingStore.h"
 
@@ -20,6 +22,7 @@
 #include "DIRAWBlockStorage.h"
 #include "DIVDIBlockStorage.h"
 #include "DIVMDKBlockStorage.h"
+#include "DICachedBlockStorage.h"
 
 class DIATABlockStorage
 {
@@ -50,12 +53,27 @@ public:
     
     void setMaxSize(DIInt value);
     
+    void setCacheSize(DIInt value);
+    DIInt getCacheSize();
+    bool flush();
+    DILong getCacheHitNum();
+    DILong getCacheMissNum();
+    
+    void setOverlay(bool value);
+    bool getOverlay();
+    void setOverlayPath(string value);
+    string getOverlayPath();
+    bool commitOverlay();
+    
     bool readBlocks(DIInt index, DIChar *buf, DIInt num);
     bool writeBlocks(DIInt index, const DIChar *buf, DIInt num);
     
 private:
-    DIFileBackingStore fileBackingStore;
+    DIMappedFileBackingStore fileBackingStore;
     DIRAMBackingStore ramBackingStore;
+    DIOverlayBackingStore overlayBackingStore;
+    DIMappedFileBackingStore deltaBackingStore;
+    DICompressedBackingStore compressedBackingStore;
     DI2IMGBackingStore twoImgBackingStore;
     DIDC42BackingStore dc42BackingStore;
     
@@ -65,13 +83,19 @@ private:
     DIVMDKBlockStorage vmdkBlockStorage;
     
     DIBlockStorage *blockStorage;
+    DICachedBlockStorage cachedBlockStorage;
     
     bool forceWriteProtected;
     string model;
     
     DIInt maxSize;
     
+    bool overlay;
+    string overlayPath;
+    
     bool open(DIBackingStore *backingStore);
+    bool openOverlay(DIBackingStore *backingStore);
+    string getImagePath();
 };
 
 #endif
@@ -88,6 +88,8 @@ DIApple525DiskStorage::DIApple525DiskStorage()
     
     forceWriteProtected = false;
     
+    overlay = false;
+    
     close();
 }
 
@@ -100,10 +102,24 @@ bool DIApple525DiskStorage::open(string path)
 {
     close();
     
-    if (fileBackingStore.open(path) && open(&fileBackingStore))
+    // With an overlay, the base image is opened read-only
+    DIBackingStore *backingStore = NULL;
+    
+    if (compressedBackingStore.open(path, !overlay))
+        backingStore = &compressedBackingStore;
+    else if (fileBackingStore.open(path, !overlay))
+        backingStore = &fileBackingStore;
+    
+    if (backingStore && overlay)
+        backingStore = openOverlay(backingStore) ? &overlayBackingStore : NULL;
+    
+    if (backingStore && open(backingStore))
         return true;
-    else
-        fileBackingStore.close();
+    
+    overlayBackingStore.close();
+    deltaBackingStore.close();
+    compressedBackingStore.close();
+    fileBackingStore.close();
     
     return false;
 }
@@ -193,7 +209,7 @@ bool DIApple525DiskStorage::open(DIBackingStore *backingStore)
         if (!validateImageSize(backingStore, trackFormat, trackSize))
             return false;
         
-        string pathExtension = strtolower(getPathExtension(fileBackingStore.getPath()));
+        string pathExtension = strtolower(getPathExtension(getImagePath()));
         
         switch (trackFormat)
         {
@@ -237,74 +253,18 @@ bool DIApple525DiskStorage::close()
 {
     if (trackDataModified)
     {
-        bool save = true;
-        
-        if ((diskStorage == &logicalDiskStorage) &&
-            (logicalDiskStorage.getTrackFormat() != DI_APPLE_NIB))
-        {
-            DITrackFormat trackFormat = logicalDiskStorage.getTrackFormat();
-            
-            bool error = false;
-            
-            for (DIInt i = 0; !error && i < MAX_TRACKNUM; i++)
-            {
-                if ((i >= trackData.size()) || !trackData[i].size())
-                    continue;
-                
-                if (i % 4)
-                    error = true;
-                else
-                {
-                    DITrack track;
-                    track.format = trackFormat;
-                    
-                    if (trackFormat == DI_APPLE_DOS32)
-                    {
-                        if (!decodeGCR53Track(track, i) && (i < MIN_TRACKNUM))
-                            error = true;
-                    }
-                    else
-                    {
-                        if (!decodeGCR62Track(track, i) && (i < MIN_TRACKNUM))
-                            error = true;
-                    }
-                }
-            }
-            
-            if (!error)
-            {
-                // Save
-                for (DIInt i = 0; i < MAX_TRACKNUM; i += 4)
-                {
-                    if ((i >= trackData.size()) || !trackData[i].size())
-                        continue;
-                    
-                    DITrack track;
-                    track.format = trackFormat;
-                    
-                    if (trackFormat == DI_APPLE_DOS32)
-                    {
-                        if (!decodeGCR53Track(track, i))
-                            continue;
-                        
-                        logicalDiskStorage.writeTrack(0, i / 4, track);
-                    }
-                    else
-                    {
-                        if (!decodeGCR62Track(track, i))
-                            continue;
-                        
-                        logicalDiskStorage.writeTrack(0, i / 4, track);
-                    }
-                }
-                
-                save = false;
-            }
-        }
+        bool save = !writeLogicalTracks();
         
         string path = fileBackingStore.getPath();
         
-        if (save && (path != ""))
+        // Compressed images are converted next to the compressed file
+        bool isCompressed = (compressedBackingStore.getPath() != "");
+        
+        if (isCompressed)
+            path = compressedBackingStore.getPath();
+        
+        // Images under an overlay are not converted, the base must stay unmodified
+        if (save && (path != "") && !overlayBackingStore.isOpen())
         {
             // Read in all data
             for (DIInt i = 0; i < MAX_TRACKNUM; i++)
@@ -315,7 +275,7 @@ bool DIApple525DiskStorage::close()
             }
             
             {
-                if (diskStorage == &fdiDiskStorage)
+                if ((diskStorage == &fdiDiskStorage) && !isCompressed)
                 {
                     fdiDiskStorage.close();
                     fileBackingStore.close();
@@ -380,6 +340,9 @@ bool DIApple525DiskStorage::close()
     
     twoIMGBackingStore.close();
     dc42BackingStore.close();
+    overlayBackingStore.close();
+    deltaBackingStore.close();
+    compressedBackingStore.close();
     fileBackingStore.close();
     ramBackingStore.close();
     
@@ -395,6 +358,9 @@ bool DIApple525DiskStorage::close()
 
 string DIApple525DiskStorage::getPath()
 {
+    if (compressedBackingStore.getPath() != "")
+        return compressedBackingStore.getPath();
+    
     return fileBackingStore.getPath();
 }
 
@@ -418,6 +384,141 @@ bool DIApple525DiskStorage::getForceWriteProtected()
     return forceWriteProtected;
 }
 
+void DIApple525DiskStorage::setOverlay(bool value)
+{
+    overlay = value;
+}
+
+bool DIApple525DiskStorage::getOverlay()
+{
+    return overlay;
+}
+
+void DIApple525DiskStorage::setOverlayPath(string value)
+{
+    overlayPath = value;
+}
+
+string DIApple525DiskStorage::getOverlayPath()
+{
+    return overlayPath;
+}
+
+bool DIApple525DiskStorage::commitOverlay()
+{
+    // Compressed base images are not reopened for writing
+    if (!overlayBackingStore.isOpen() ||
+        (compressedBackingStore.getPath() != ""))
+        return false;
+    
+    // Write back modified tracks to the overlay first
+    if (trackDataModified)
+    {
+        if (!writeLogicalTracks())
+            return false;
+        
+        trackDataModified = false;
+    }
+    
+    // Reopen base image with write access while committing
+    string path = fileBackingStore.getPath();
+    
+    fileBackingStore.open(path, true);
+    
+    bool success = overlayBackingStore.commit();
+    
+    fileBackingStore.open(path, false);
+    
+    return success;
+}
+
+bool DIApple525DiskStorage::openOverlay(DIBackingStore *backingStore)
+{
+    // Without an overlay path, the delta is kept in RAM
+    if (overlayPath == "")
+        return overlayBackingStore.open(backingStore);
+    
+    if (!deltaBackingStore.open(overlayPath) &&
+        !deltaBackingStore.create(overlayPath))
+        return false;
+    
+    return overlayBackingStore.open(backingStore, &deltaBackingStore);
+}
+
+string DIApple525DiskStorage::getImagePath()
+{
+    if (compressedBackingStore.getPath() != "")
+        return compressedBackingStore.getImagePath();
+    
+    return fileBackingStore.getPath();
+}
+
+bool DIApple525DiskStorage::writeLogicalTracks()
+{
+    if ((diskStorage != &logicalDiskStorage) ||
+        (logicalDiskStorage.getTrackFormat() == DI_APPLE_NIB))
+        return false;
+    
+    DITrackFormat trackFormat = logicalDiskStorage.getTrackFormat();
+    
+    bool error = false;
+    
+    for (DIInt i = 0; !error && i < MAX_TRACKNUM; i++)
+    {
+        if ((i >= trackData.size()) || !trackData[i].size())
+            continue;
+        
+        if (i % 4)
+            error = true;
+        else
+        {
+            DITrack track;
+            track.format = trackFormat;
+            
+            if (trackFormat == DI_APPLE_DOS32)
+            {
+                if (!decodeGCR53Track(track, i) && (i < MIN_TRACKNUM))
+                    error = true;
+            }
+            else
+            {
+                if (!decodeGCR62Track(track, i) && (i < MIN_TRACKNUM))
+                    error = true;
+            }
+        }
+    }
+    
+    if (error)
+        return false;
+    
+    // Save
+    for (DIInt i = 0; i < MAX_TRACKNUM; i += 4)
+    {
+        if ((i >= trackData.size()) || !trackData[i].size())
+            continue;
+        
+        DITrack track;
+        track.format = trackFormat;
+        
+        if (trackFormat == DI_APPLE_DOS32)
+        {
+            if (!decodeGCR53Track(track, i))
+                continue;
+            
+            logicalDiskStorage.writeTrack(0, i / 4, track);
+        }
+        else
+        {
+            if (!decodeGCR62Track(track, i))
+                continue;
+            
+            logicalDiskStorage.writeTrack(0, i / 4, track);
+        }
+    }
+    
+    return true;
+}
+
 bool DIApple525DiskStorage::readTrack(DIInt trackIndex, DIData& data)
 {
     if (trackIndex >= trackData.size())
@@ -12,6 +12,8 @@
 
 #include "DIFileBackingStore.h"
 #include "DIRAMBackingStore.h"
+#include "DIOverlayBackingStore.h"
+#include "DICompressedBackingStore.h"
 #include "DI2IMGBackingStore.h"
 #include "DIDC42BackingStore.h"
 
@@ -44,6 +46,12 @@ public:
     void setForceWriteProtected(bool value);
     bool getForceWriteProtected();
     
+    void setOverlay(bool value);
+    bool getOverlay();
+    void setOverlayPath(string value);
+    string getOverlayPath();
+    bool commitOverlay();
+    
     bool readTrack(DIInt trackIndex, DIData& data);
     bool writeTrack(DIInt trackIndex, DIData& data);
     
@@ -53,6 +61,9 @@ private:
     
     DIFileBackingStore fileBackingStore;
     DIRAMBackingStore ramBackingStore;
+    DIOverlayBackingStore overlayBackingStore;
+    DIFileBackingStore deltaBackingStore;
+    DICompressedBackingStore compressedBackingStore;
     DI2IMGBackingStore twoIMGBackingStore;
     DIDC42BackingStore dc42BackingStore;
     
@@ -66,6 +77,9 @@ private:
     
     bool forceWriteProtected;
     
+    bool overlay;
+    string overlayPath;
+    
     vector<DIData> trackData;
     bool trackDataModified;
     
@@ -77,6 +91,9 @@ private:
     bool gcrError;
     
     bool open(DIBackingStore *backingStore);
+    bool openOverlay(DIBackingStore *backingStore);
+    string getImagePath();
+    bool writeLogicalTracks();
     
     bool validateImageSize(DIBackingStore *backingStore,
                            DITrackFormat& trackFormat, DIInt& trackSize);
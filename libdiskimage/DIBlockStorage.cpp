@@ -53,3 +53,8 @@ bool DIBlockStorage::writeBlocks(DIInt index, const DIChar *buf, DIInt num)
 {
     return false;
 }
+
+bool DIBlockStorage::flush()
+{
+    return true;
+}
@@ -30,6 +30,8 @@ public:
     
     virtual bool readBlocks(DIInt index, DIChar *buf, DIInt num);
     virtual bool writeBlocks(DIInt index, const DIChar *buf, DIInt num);
+    
+    virtual bool flush();
 };
 
 #endif
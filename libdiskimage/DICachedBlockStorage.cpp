@@ -0,0 +1,367 @@
+/**
+ * libdiskimage
+ * Cached Block Storage
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Caches a block storage with an LRU write-back cache
+ */
+
+#include "DICachedBlockStorage.h"
+
+DICachedBlockStorage::DICachedBlockStorage()
+{
+    blockStorage = NULL;
+    
+    cacheSize = DI_DEFAULT_CACHESIZE;
+    readAhead = DI_DEFAULT_READAHEAD;
+    
+    close();
+}
+
+DICachedBlockStorage::~DICachedBlockStorage()
+{
+    close();
+}
+
+bool DICachedBlockStorage::open(DIBlockStorage *blockStorage)
+{
+    close();
+    
+    this->blockStorage = blockStorage;
+    
+    return true;
+}
+
+void DICachedBlockStorage::close()
+{
+    flush();
+    
+    clearCache();
+    
+    blockStorage = NULL;
+    
+    hitNum = 0;
+    missNum = 0;
+}
+
+void DICachedBlockStorage::setCacheSize(DIInt value)
+{
+    flush();
+    
+    clearCache();
+    
+    cacheSize = value;
+}
+
+DIInt DICachedBlockStorage::getCacheSize()
+{
+    return cacheSize;
+}
+
+void DICachedBlockStorage::setReadAhead(DIInt value)
+{
+    readAhead = value;
+}
+
+DIInt DICachedBlockStorage::getReadAhead()
+{
+    return readAhead;
+}
+
+bool DICachedBlockStorage::flush()
+{
+    if (!blockStorage)
+        return true;
+    
+    bool success = writeBack();
+    
+    return blockStorage->flush() && success;
+}
+
+DILong DICachedBlockStorage::getHitNum()
+{
+    return hitNum;
+}
+
+DILong DICachedBlockStorage::getMissNum()
+{
+    return missNum;
+}
+
+bool DICachedBlockStorage::isWriteEnabled()
+{
+    if (!blockStorage)
+        return false;
+    
+    return blockStorage->isWriteEnabled();
+}
+
+DIInt DICachedBlockStorage::getBlockNum()
+{
+    if (!blockStorage)
+        return 0;
+    
+    return blockStorage->getBlockNum();
+}
+
+string DICachedBlockStorage::getFormatLabel()
+{
+    if (!blockStorage)
+        return "";
+    
+    return blockStorage->getFormatLabel();
+}
+
+DIInt DICachedBlockStorage::getCylinders()
+{
+    if (!blockStorage)
+        return 0;
+    
+    return blockStorage->getCylinders();
+}
+
+DIInt DICachedBlockStorage::getHeads()
+{
+    if (!blockStorage)
+        return 0;
+    
+    return blockStorage->getHeads();
+}
+
+DIInt DICachedBlockStorage::getSectors()
+{
+    if (!blockStorage)
+        return 0;
+    
+    return blockStorage->getSectors();
+}
+
+bool DICachedBlockStorage::writeBack()
+{
+    bool success = true;
+    
+    // Write back runs of consecutive dirty blocks with one call each
+    DIData runData;
+    DIInt runStart = 0;
+    DIInt runNum = 0;
+    
+    for (DICacheMap::iterator i = cacheMap.begin();
+         ;
+         i++)
+    {
+        bool isEnd = (i == cacheMap.end());
+        
+        if (runNum &&
+            (isEnd || !i->second.dirty || (i->first != runStart + runNum)))
+        {
+            if (!blockStorage->writeBlocks(runStart, &runData.front(), runNum))
+                success = false;
+            
+            runNum = 0;
+        }
+        
+        if (isEnd)
+            break;
+        
+        if (!i->second.dirty)
+            continue;
+        
+        if (!runNum)
+            runStart = i->first;
+        
+        runData.resize((runNum + 1) * DI_BLOCKSIZE);
+        memcpy(&runData[runNum * DI_BLOCKSIZE], getSlotData(i->second.slot), DI_BLOCKSIZE);
+        runNum++;
+        
+        i->second.dirty = false;
+    }
+    
+    return success;
+}
+
+bool DICachedBlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
+{
+    if (!blockStorage)
+        return false;
+    
+    if (!cacheSize)
+        return blockStorage->readBlocks(index, buf, num);
+    
+    DIInt blockNum = blockStorage->getBlockNum();
+    
+    bool isSequential = (index == nextSequentialIndex);
+    nextSequentialIndex = index + num;
+    
+    while (num)
+    {
+        if (index >= blockNum)
+            return false;
+        
+        DICacheMap::iterator i = cacheMap.find(index);
+        
+        if (i != cacheMap.end())
+        {
+            hitNum++;
+            
+            memcpy(buf, getSlotData(i->second.slot), DI_BLOCKSIZE);
+            
+            lru.splice(lru.begin(), lru, i->second.lruIterator);
+            
+            index++;
+            buf += DI_BLOCKSIZE;
+            num--;
+            
+            continue;
+        }
+        
+        // Read the uncached run, plus read-ahead on sequential access
+        DIInt runNum = 1;
+        while ((runNum < num) && !cacheMap.count(index + runNum))
+            runNum++;
+        
+        DIInt fetchNum = runNum;
+        if (isSequential && (runNum == num))
+            fetchNum += readAhead;
+        if (fetchNum > cacheSize)
+            fetchNum = (runNum > cacheSize) ? runNum : cacheSize;
+        if (fetchNum > (blockNum - index))
+            fetchNum = blockNum - index;
+        while ((fetchNum > runNum) && cacheMap.count(index + fetchNum - 1))
+            fetchNum--;
+        
+        DIData fetchData;
+        fetchData.resize(fetchNum * DI_BLOCKSIZE);
+        
+        if (!blockStorage->readBlocks(index, &fetchData.front(), fetchNum))
+            return false;
+        
+        missNum += runNum;
+        
+        memcpy(buf, &fetchData.front(), runNum * DI_BLOCKSIZE);
+        
+        for (DIInt j = 0; j < fetchNum; j++)
+        {
+            if (cacheMap.count(index + j))
+                continue;
+            
+            DIChar *data = insertBlock(index + j);
+            
+            if (!data)
+                break;
+            
+            memcpy(data, &fetchData[j * DI_BLOCKSIZE], DI_BLOCKSIZE);
+        }
+        
+        index += runNum;
+        buf += runNum * DI_BLOCKSIZE;
+        num -= runNum;
+    }
+    
+    return true;
+}
+
+bool DICachedBlockStorage::writeBlocks(DIInt index, const DIChar *buf, DIInt num)
+{
+    if (!blockStorage)
+        return false;
+    
+    if (!cacheSize)
+        return blockStorage->writeBlocks(index, buf, num);
+    
+    if (!blockStorage->isWriteEnabled())
+        return false;
+    
+    if ((index + num) > blockStorage->getBlockNum())
+        return false;
+    
+    for (; num; index++, buf += DI_BLOCKSIZE, num--)
+    {
+        DICacheMap::iterator i = cacheMap.find(index);
+        
+        DIChar *data;
+        
+        if (i != cacheMap.end())
+        {
+            data = getSlotData(i->second.slot);
+            
+            lru.splice(lru.begin(), lru, i->second.lruIterator);
+        }
+        else
+        {
+            data = insertBlock(index);
+            
+            if (!data)
+                return blockStorage->writeBlocks(index, buf, num);
+        }
+        
+        memcpy(data, buf, DI_BLOCKSIZE);
+        
+        cacheMap[index].dirty = true;
+    }
+    
+    return true;
+}
+
+void DICachedBlockStorage::clearCache()
+{
+    cacheData.clear();
+    freeSlots.clear();
+    cacheMap.clear();
+    lru.clear();
+    
+    nextSequentialIndex = 0;
+}
+
+DIChar *DICachedBlockStorage::getSlotData(DIInt slot)
+{
+    return &cacheData[slot * DI_BLOCKSIZE];
+}
+
+DIChar *DICachedBlockStorage::insertBlock(DIInt index)
+{
+    if (!cacheData.size())
+    {
+        cacheData.resize(cacheSize * DI_BLOCKSIZE);
+        
+        for (DIInt i = cacheSize; i > 0; i--)
+            freeSlots.push_back(i - 1);
+    }
+    
+    if (!freeSlots.size() && !evictBlock())
+        return NULL;
+    
+    DICacheEntry entry;
+    
+    entry.slot = freeSlots.back();
+    entry.dirty = false;
+    entry.lruIterator = lru.insert(lru.begin(), index);
+    
+    freeSlots.pop_back();
+    
+    cacheMap[index] = entry;
+    
+    return getSlotData(entry.slot);
+}
+
+bool DICachedBlockStorage::evictBlock()
+{
+    if (!lru.size())
+        return false;
+    
+    DIInt index = lru.back();
+    
+    DICacheMap::iterator i = cacheMap.find(index);
+    
+    // Evicting a dirty block writes back all dirty blocks at once,
+    // so neighbouring blocks get coalesced
+    if (i->second.dirty && !writeBack())
+        return false;
+    
+    freeSlots.push_back(i->second.slot);
+    
+    cacheMap.erase(i);
+    lru.pop_back();
+    
+    return true;
+}
@@ -0,0 +1,84 @@
+/**
+ * libdiskimage
+ * Cached Block Storage
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Caches a block storage with an LRU write-back cache
+ */
+
+#ifndef _DICACHEDBLOCKSTORAGE_H
+#define _DICACHEDBLOCKSTORAGE_H
+
+#include <list>
+#include <map>
+
+#include "DICommon.h"
+#include "DIBlockStorage.h"
+
+#define DI_DEFAULT_CACHESIZE    256
+#define DI_DEFAULT_READAHEAD    8
+
+typedef struct
+{
+    DIInt slot;
+    bool dirty;
+    list<DIInt>::iterator lruIterator;
+} DICacheEntry;
+
+typedef map<DIInt, DICacheEntry> DICacheMap;
+
+class DICachedBlockStorage : public DIBlockStorage
+{
+public:
+    DICachedBlockStorage();
+    ~DICachedBlockStorage();
+    
+    bool open(DIBlockStorage *blockStorage);
+    void close();
+    
+    void setCacheSize(DIInt value);
+    DIInt getCacheSize();
+    void setReadAhead(DIInt value);
+    DIInt getReadAhead();
+    
+    bool flush();
+    
+    DILong getHitNum();
+    DILong getMissNum();
+    
+    bool isWriteEnabled();
+    DIInt getBlockNum();
+    string getFormatLabel();
+    
+    DIInt getCylinders();
+    DIInt getHeads();
+    DIInt getSectors();
+    
+    bool readBlocks(DIInt index, DIChar *buf, DIInt num);
+    bool writeBlocks(DIInt index, const DIChar *buf, DIInt num);
+    
+private:
+    DIBlockStorage *blockStorage;
+    
+    DIInt cacheSize;
+    DIInt readAhead;
+    
+    DIData cacheData;
+    vector<DIInt> freeSlots;
+    DICacheMap cacheMap;
+    list<DIInt> lru;
+    
+    DIInt nextSequentialIndex;
+    
+    DILong hitNum;
+    DILong missNum;
+    
+    bool writeBack();
+    void clearCache();
+    DIChar *getSlotData(DIInt slot);
+    DIChar *insertBlock(DIInt index);
+    bool evictBlock();
+};
+
+#endif
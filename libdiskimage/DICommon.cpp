@@ -164,3 +164,25 @@ void setDILongBE(DIChar *p, DILong value)
     p[6] = (value >> 8);
     p[7] = (value >> 0);
 }
+
+bool isDIDataZero(const DIChar *p, DIInt num)
+{
+    DIInt i = 0;
+    
+    // Test 32 bytes at a time, so the compiler can vectorize the loop
+    for (; (i + 4 * sizeof(DILong)) <= num; i += 4 * sizeof(DILong))
+    {
+        DILong value[4];
+        
+        memcpy(value, p + i, sizeof(value));
+        
+        if (value[0] | value[1] | value[2] | value[3])
+            return false;
+    }
+    
+    for (; i < num; i++)
+        if (p[i])
+            return false;
+    
+    return true;
+}
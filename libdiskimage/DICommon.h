@@ -52,4 +52,6 @@ void setDIIntBE(DIChar *p, DIInt value);
 void setDILongLE(DIChar *p, DILong value);
 void setDILongBE(DIChar *p, DILong value);
 
+bool isDIDataZero(const DIChar *p, DIInt num);
+
 #endif
@@ -0,0 +1,432 @@
+
+/**
+ * libdiskimage
+ * Compressed Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a gzip or single-entry zip compressed backing store
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <zip.h>
+
+#include "DICompressedBackingStore.h"
+
+#define DECODE_CHUNKSIZE    0x10000
+#define MAX_RESERVESIZE     0x40000000
+
+DICompressedBackingStore::DICompressedBackingStore()
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    
+    modified = false;
+    threadStarted = false;
+    
+    close();
+}
+
+DICompressedBackingStore::~DICompressedBackingStore()
+{
+    close();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool DICompressedBackingStore::open(string path)
+{
+    return open(path, true);
+}
+
+bool DICompressedBackingStore::open(string path, bool writeEnabled)
+{
+    close();
+    
+    this->path = path;
+    
+    if (!detectFormat())
+    {
+        close();
+        
+        return false;
+    }
+    
+    this->writeEnabled = writeEnabled && !access(path.c_str(), W_OK);
+    
+    // Start decompression
+    decoding = true;
+    
+    if (expectedSize <= MAX_RESERVESIZE)
+        data.reserve((size_t) expectedSize);
+    
+    if (!pthread_create(&decodeThread, NULL, decode, this))
+        threadStarted = true;
+    else
+        decode(this);
+    
+    return true;
+}
+
+bool DICompressedBackingStore::close()
+{
+    bool success = true;
+    
+    // Stop decompression
+    pthread_mutex_lock(&mutex);
+    
+    decodeCancel = true;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    finishDecoding();
+    
+    if (modified && !decodeError)
+    {
+        if (format == DI_COMPRESSED_GZIP)
+            success = encodeGZip();
+        else if (format == DI_COMPRESSED_ZIP)
+            success = encodeZip();
+    }
+    
+    path = "";
+    imagePath = "";
+    format = DI_COMPRESSED_NONE;
+    writeEnabled = false;
+    modified = false;
+    
+    data.clear();
+    expectedSize = 0;
+    
+    decoding = false;
+    decodeCancel = false;
+    decodeError = false;
+    
+    return success;
+}
+
+string DICompressedBackingStore::getPath()
+{
+    return path;
+}
+
+string DICompressedBackingStore::getImagePath()
+{
+    return imagePath;
+}
+
+DICompressedFormat DICompressedBackingStore::getFormat()
+{
+    return format;
+}
+
+bool DICompressedBackingStore::isWriteEnabled()
+{
+    return writeEnabled;
+}
+
+// While decompressing, the size comes from the gzip trailer or zip header
+DILong DICompressedBackingStore::getSize()
+{
+    if (!expectedSize)
+        finishDecoding();
+    
+    pthread_mutex_lock(&mutex);
+    
+    DILong size = decoding ? expectedSize : data.size();
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return size;
+}
+
+string DICompressedBackingStore::getFormatLabel()
+{
+    string formatLabel;
+    
+    if (format == DI_COMPRESSED_ZIP)
+        formatLabel = "ZIP Compressed Disk Image";
+    else
+        formatLabel = "GZIP Compressed Disk Image";
+    
+    if (!isWriteEnabled())
+        formatLabel += " (read-only)";
+    
+    return formatLabel;
+}
+
+bool DICompressedBackingStore::read(DILong pos, DIChar *buf, DIInt num)
+{
+    pthread_mutex_lock(&mutex);
+    
+    // Wait until the range is decompressed
+    while (decoding && ((pos + num) > data.size()))
+        pthread_cond_wait(&cond, &mutex);
+    
+    bool success = !decodeError && ((pos + num) <= data.size());
+    
+    if (success && num)
+        memcpy(buf, &data.front() + pos, num);
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return success;
+}
+
+bool DICompressedBackingStore::write(DILong pos, const DIChar *buf, DIInt num)
+{
+    if (!writeEnabled)
+        return false;
+    
+    finishDecoding();
+    
+    if (decodeError)
+        return false;
+    
+    if (!num)
+        return true;
+    
+    if ((pos + num) > data.size())
+        data.resize((size_t) (pos + num));
+    
+    memcpy(&data.front() + pos, buf, num);
+    
+    modified = true;
+    
+    return true;
+}
+
+bool DICompressedBackingStore::detectFormat()
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    
+    if (!fp)
+        return false;
+    
+    DIChar header[4];
+    
+    bool success = (fread(header, sizeof(header), 1, fp) == 1);
+    
+    if (success && (header[0] == 0x1f) && (header[1] == 0x8b))
+    {
+        // The gzip trailer holds the decompressed size (modulo 4 GiB)
+        DIChar trailer[4];
+        
+        if (!fseeko(fp, -4, SEEK_END) &&
+            (fread(trailer, sizeof(trailer), 1, fp) == 1))
+            expectedSize = getDIIntLE(trailer);
+        
+        format = DI_COMPRESSED_GZIP;
+        
+        if (strtolower(getPathExtension(path)) == "gz")
+            imagePath = path.substr(0, path.size() - 3);
+        else
+            imagePath = path;
+    }
+    
+    fclose(fp);
+    
+    if (format == DI_COMPRESSED_GZIP)
+        return true;
+    
+    if (!success || memcmp(header, "PK\x03\x04", sizeof(header)))
+        return false;
+    
+    // Accept only zip files with a single entry
+    struct zip *zip = zip_open(path.c_str(), 0, NULL);
+    
+    if (!zip)
+        return false;
+    
+    struct zip_stat zipStat;
+    
+    success = ((zip_get_num_entries(zip, 0) == 1) &&
+               !zip_stat_index(zip, 0, 0, &zipStat));
+    
+    if (success)
+    {
+        format = DI_COMPRESSED_ZIP;
+        
+        expectedSize = zipStat.size;
+        imagePath = zipStat.name;
+    }
+    
+    zip_close(zip);
+    
+    return success;
+}
+
+void *DICompressedBackingStore::decode(void *context)
+{
+    DICompressedBackingStore *backingStore = (DICompressedBackingStore *) context;
+    
+    bool success;
+    
+    if (backingStore->format == DI_COMPRESSED_GZIP)
+        success = backingStore->decodeGZip();
+    else
+        success = backingStore->decodeZip();
+    
+    pthread_mutex_lock(&backingStore->mutex);
+    
+    backingStore->decoding = false;
+    backingStore->decodeError = !success;
+    
+    pthread_cond_broadcast(&backingStore->cond);
+    pthread_mutex_unlock(&backingStore->mutex);
+    
+    return NULL;
+}
+
+bool DICompressedBackingStore::decodeGZip()
+{
+    gzFile file = gzopen(path.c_str(), "rb");
+    
+    if (!file)
+        return false;
+    
+    DIChar buf[DECODE_CHUNKSIZE];
+    
+    bool success = true;
+    
+    while (success)
+    {
+        int num = gzread(file, buf, DECODE_CHUNKSIZE);
+        
+        if (num <= 0)
+        {
+            success = (num == 0);
+            
+            break;
+        }
+        
+        success = appendData(buf, num);
+    }
+    
+    gzclose(file);
+    
+    return success;
+}
+
+bool DICompressedBackingStore::decodeZip()
+{
+    struct zip *zip = zip_open(path.c_str(), 0, NULL);
+    
+    if (!zip)
+        return false;
+    
+    struct zip_file *zipFile = zip_fopen_index(zip, 0, 0);
+    
+    bool success = (zipFile != NULL);
+    
+    if (success)
+    {
+        DIChar buf[DECODE_CHUNKSIZE];
+        
+        while (success)
+        {
+            long long num = zip_fread(zipFile, buf, DECODE_CHUNKSIZE);
+            
+            if (num <= 0)
+            {
+                success = (num == 0);
+                
+                break;
+            }
+            
+            success = appendData(buf, (DIInt) num);
+        }
+        
+        zip_fclose(zipFile);
+    }
+    
+    zip_close(zip);
+    
+    return success;
+}
+
+bool DICompressedBackingStore::appendData(const DIChar *buf, DIInt num)
+{
+    pthread_mutex_lock(&mutex);
+    
+    data.insert(data.end(), buf, buf + num);
+    
+    bool cancel = decodeCancel;
+    
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    
+    return !cancel;
+}
+
+void DICompressedBackingStore::finishDecoding()
+{
+    if (!threadStarted)
+        return;
+    
+    pthread_join(decodeThread, NULL);
+    
+    threadStarted = false;
+}
+
+bool DICompressedBackingStore::encodeGZip()
+{
+    // Write to a temporary file, so a failure keeps the original image
+    string tempPath = path + ".tmp";
+    
+    gzFile file = gzopen(tempPath.c_str(), "wb");
+    
+    if (!file)
+        return false;
+    
+    bool success = true;
+    
+    for (size_t i = 0; success && (i < data.size()); i += DECODE_CHUNKSIZE)
+    {
+        unsigned num = (unsigned) min((size_t) DECODE_CHUNKSIZE, data.size() - i);
+        
+        success = (gzwrite(file, &data[i], num) == (int) num);
+    }
+    
+    if (gzclose(file) != Z_OK)
+        success = false;
+    
+    if (success)
+        success = !rename(tempPath.c_str(), path.c_str());
+    
+    if (!success)
+        remove(tempPath.c_str());
+    
+    return success;
+}
+
+bool DICompressedBackingStore::encodeZip()
+{
+    struct zip *zip = zip_open(path.c_str(), 0, NULL);
+    
+    if (!zip)
+        return false;
+    
+    struct zip_source *zipSource = zip_source_buffer(zip,
+                                                     data.size() ? &data.front() : NULL,
+                                                     data.size(), 0);
+    
+    bool success = (zipSource != NULL);
+    
+    if (success && (zip_replace(zip, 0, zipSource) == -1))
+    {
+        zip_source_free(zipSource);
+        
+        success = false;
+    }
+    
+    // The archive is written on close
+    if (zip_close(zip))
+        success = false;
+    
+    return success;
+}
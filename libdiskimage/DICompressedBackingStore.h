@@ -0,0 +1,83 @@
+
+/**
+ * libdiskimage
+ * Compressed Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a gzip or single-entry zip compressed backing store
+ */
+
+// Notes:
+// * The image is decompressed to memory on a worker thread. Reads wait only
+//   until the requested range is available, so format detection can start
+//   right away. getSize() does not wait, it returns the size recorded in the
+//   gzip trailer or zip header.
+// * When modified, the image is compressed back on close().
+
+#ifndef _DICOMPRESSEDBACKINGSTORE_H
+#define _DICOMPRESSEDBACKINGSTORE_H
+
+#include <pthread.h>
+
+#include "DICommon.h"
+#include "DIBackingStore.h"
+
+typedef enum
+{
+    DI_COMPRESSED_NONE,
+    DI_COMPRESSED_GZIP,
+    DI_COMPRESSED_ZIP,
+} DICompressedFormat;
+
+class DICompressedBackingStore : public DIBackingStore
+{
+public:
+    DICompressedBackingStore();
+    ~DICompressedBackingStore();
+    
+    bool open(string path);
+    bool open(string path, bool writeEnabled);
+    bool close();
+    
+    string getPath();
+    string getImagePath();
+    DICompressedFormat getFormat();
+    
+    bool isWriteEnabled();
+    DILong getSize();
+    string getFormatLabel();
+    
+    bool read(DILong pos, DIChar *buf, DIInt num);
+    bool write(DILong pos, const DIChar *buf, DIInt num);
+    
+private:
+    string path;
+    string imagePath;
+    DICompressedFormat format;
+    bool writeEnabled;
+    bool modified;
+    
+    DIData data;
+    DILong expectedSize;
+    
+    pthread_t decodeThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool decoding;
+    bool decodeCancel;
+    bool decodeError;
+    bool threadStarted;
+    
+    bool detectFormat();
+    static void *decode(void *context);
+    bool decodeGZip();
+    bool decodeZip();
+    bool appendData(const DIChar *buf, DIInt num);
+    void finishDecoding();
+    
+    bool encodeGZip();
+    bool encodeZip();
+};
+
+#endif
@@ -8,11 +8,16 @@
  * Accesses FDI disk images
  */
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include "DIFDIDiskStorage.h"
 
 #define FDI_SIGNATURE   "Formatted Disk Image file"
 #define FDI_CREATOR     "libdiskimage " DI_VERSION
 
+#define FDI_MAX_THREADNUM   16
+
 typedef enum
 {
     DI_FDI_BLANK = 0x00,
@@ -70,6 +75,14 @@ static const DIInt tpiCode[] =
     48, 67, 96, 100, 135, 192
 };
 
+typedef struct
+{
+    DIFDIDiskStorage *diskStorage;
+    DIInt threadIndex;
+    DIInt threadNum;
+    vector<DIData> *encodedData;
+} DIFDIPulsesThreadContext;
+
 DIFDIDiskStorage::DIFDIDiskStorage()
 {
     writing = false;
@@ -266,6 +279,10 @@ bool DIFDIDiskStorage::close()
     
     trackData.clear();
     
+    pulsesBitRate = 0;
+    pulsesTrackData.clear();
+    pulsesTrackDecoded.clear();
+    
     return true;
 }
 
@@ -305,6 +322,16 @@ bool DIFDIDiskStorage::readTrack(DIInt headIndex, DIInt trackIndex, DITrack& tra
     
     DIInt format = trackFormat[index];
     
+    if (format == DI_FDI_PULSES)
+    {
+        if (track.format == DI_BITSTREAM_250000BPS)
+            return readPulsesTrack(index, track.data, 250000);
+        else if (track.format == DI_BITSTREAM_500000BPS)
+            return readPulsesTrack(index, track.data, 500000);
+        else
+            return false;
+    }
+    
     DIData data;
     
     if (trackSize[index])
@@ -345,14 +372,6 @@ bool DIFDIDiskStorage::readTrack(DIInt headIndex, DIInt trackIndex, DITrack& tra
             
             return decodeBitstreamTrack(track.data, data);
             
-        case DI_FDI_PULSES:
-            if (track.format == DI_BITSTREAM_250000BPS)
-                return decodePulsesTrack(track.data, data, 250000);
-            else if (track.format == DI_BITSTREAM_500000BPS)
-                return decodePulsesTrack(track.data, data, 500000);
-            else
-                return false;
-            
         default:
             return false;
     }
@@ -490,6 +509,120 @@ DIInt DIFDIDiskStorage::getIndexHoleCount(DIInt value)
     return zeroCount + oneCount;
 }
 
+bool DIFDIDiskStorage::readPulsesTrack(DIInt index, DIData& decodedData, DIInt bitRate)
+{
+    // Decode all pulses tracks at once on first access
+    if (pulsesBitRate != bitRate)
+        decodePulsesTracks(bitRate);
+    
+    if (pulsesTrackDecoded[index])
+    {
+        decodedData.swap(pulsesTrackData[index]);
+        
+        pulsesTrackData[index].clear();
+        pulsesTrackDecoded[index] = false;
+        
+        return true;
+    }
+    
+    // Track was already handed out, or failed to decode
+    DIData data;
+    
+    data.resize(trackSize[index]);
+    
+    if (!data.size() ||
+        !backingStore->read(trackOffset[index], &data.front(), trackSize[index]))
+        return false;
+    
+    return decodePulsesTrack(decodedData, data, bitRate);
+}
+
+void DIFDIDiskStorage::decodePulsesTracks(DIInt bitRate)
+{
+    DIInt indexNum = (DIInt) trackFormat.size();
+    
+    pulsesBitRate = bitRate;
+    pulsesTrackData.clear();
+    pulsesTrackData.resize(indexNum);
+    pulsesTrackDecoded.clear();
+    pulsesTrackDecoded.resize(indexNum);
+    
+    // Read encoded tracks (the backing store is not thread safe)
+    vector<DIData> encodedData;
+    
+    encodedData.resize(indexNum);
+    
+    for (DIInt i = 0; i < indexNum; i++)
+    {
+        if ((trackFormat[i] != DI_FDI_PULSES) || !trackSize[i])
+            continue;
+        
+        encodedData[i].resize(trackSize[i]);
+        
+        if (!backingStore->read(trackOffset[i], &encodedData[i].front(), trackSize[i]))
+            encodedData[i].clear();
+    }
+    
+    // Decode tracks in parallel
+    long processorNum = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    DIInt threadNum = (processorNum > 0) ? (DIInt) processorNum : 1;
+    
+    if (threadNum > FDI_MAX_THREADNUM)
+        threadNum = FDI_MAX_THREADNUM;
+    
+    vector<pthread_t> threads;
+    vector<DIFDIPulsesThreadContext> contexts;
+    
+    threads.resize(threadNum);
+    contexts.resize(threadNum);
+    
+    for (DIInt i = 0; i < threadNum; i++)
+    {
+        contexts[i].diskStorage = this;
+        contexts[i].threadIndex = i;
+        contexts[i].threadNum = threadNum;
+        contexts[i].encodedData = &encodedData;
+    }
+    
+    DIInt startedThreadNum;
+    
+    for (startedThreadNum = 1; startedThreadNum < threadNum; startedThreadNum++)
+        if (pthread_create(&threads[startedThreadNum], NULL,
+                           decodePulsesTracksThread, &contexts[startedThreadNum]))
+            break;
+    
+    // Tracks of threads that could not be started are decoded here
+    for (DIInt i = startedThreadNum; i < threadNum; i++)
+        decodePulsesTracksThread(&contexts[i]);
+    
+    decodePulsesTracksThread(&contexts[0]);
+    
+    for (DIInt i = 1; i < startedThreadNum; i++)
+        pthread_join(threads[i], NULL);
+}
+
+void *DIFDIDiskStorage::decodePulsesTracksThread(void *context)
+{
+    DIFDIPulsesThreadContext *threadContext = (DIFDIPulsesThreadContext *) context;
+    DIFDIDiskStorage *diskStorage = threadContext->diskStorage;
+    vector<DIData>& encodedData = *threadContext->encodedData;
+    
+    for (DIInt i = threadContext->threadIndex;
+         i < encodedData.size();
+         i += threadContext->threadNum)
+    {
+        if (!encodedData[i].size())
+            continue;
+        
+        diskStorage->pulsesTrackDecoded[i] =
+        diskStorage->decodePulsesTrack(diskStorage->pulsesTrackData[i],
+                                       encodedData[i], diskStorage->pulsesBitRate);
+    }
+    
+    return NULL;
+}
+
 bool DIFDIDiskStorage::decodePulsesTrack(DIData& decodedData, DIData& data, DIInt bitRate)
 {
     if (data.size() < 0x10)
@@ -602,54 +735,38 @@ bool DIFDIDiskStorage::getStream(DIFDIStream& stream, DIChar *data, DIInt size,
             
         case 1:
         {
-            initStream(data, size);
+            DIFDIStreamState state;
+            
+            initStream(state, data, size);
+            
+            DIFDIHuffmanTree tree;
+            DIFDIHuffmanLookupTable lookupTable;
             
             DIInt substreamShift;
             
             do
             {
-                DIInt streamIndex = 0;
-                
                 // Read substream header
-                DIInt header1 = readStreamByte();
-                DIInt header2 = readStreamByte();
+                DIInt header1 = readStreamByte(state);
+                DIInt header2 = readStreamByte(state);
                 
                 substreamShift = (header1 & 0x7f);
-                huffmanSignExtension = (header1 & 0x80);
-                huffman16Bits = (header2 & 0x80);
+                state.huffmanSignExtension = (header1 & 0x80);
+                state.huffman16Bits = (header2 & 0x80);
                 
                 // Build Huffman tree
-                DIFDIHuffmanNode *root = new DIFDIHuffmanNode();
+                tree.clear();
+                tree.push_back(DIFDIHuffmanNode());
                 
-                buildHuffmanTree(root);
+                buildHuffmanTree(state, tree, 0);
                 
                 // Read Huffman tree values
-                readHuffmanTreeValues(root);
+                readHuffmanTreeValues(state, tree, 0);
                 
                 // Decode Huffman stream
-                for (DIInt i = 0; i < pulseNum; i++)
-                {
-                    DIFDIHuffmanNode *currentNode = root;
-                    
-                    while (currentNode->left)
-                    {
-                        if (isStreamEnd())
-                        {
-                            delete root;
-                            
-                            return false;
-                        }
-                        
-                        if (!readStreamBit())
-                            currentNode = currentNode->left;
-                        else
-                            currentNode = currentNode->right;
-                    }
-                    
-                    stream[streamIndex++] |= currentNode->value << substreamShift;
-                }
-                
-                delete root;
+                if (!decodeHuffmanStream(state, tree, lookupTable,
+                                         stream, pulseNum, substreamShift))
+                    return false;
             } while (substreamShift);
             
             return true;
@@ -660,74 +777,85 @@ bool DIFDIDiskStorage::getStream(DIFDIStream& stream, DIChar *data, DIInt size,
     }
 }
 
-void DIFDIDiskStorage::initStream(DIChar *data, DIInt size)
+void DIFDIDiskStorage::initStream(DIFDIStreamState& state, DIChar *data, DIInt size)
 {
-    streamData = data;
-    streamSize = size;
-    streamBitMask = 0;
+    state.data = data;
+    state.size = size;
+    state.value = 0;
+    state.bitMask = 0;
+    
+    state.huffmanSignExtension = false;
+    state.huffman16Bits = false;
 }
 
-DIChar DIFDIDiskStorage::readStreamByte()
+DIChar DIFDIDiskStorage::readStreamByte(DIFDIStreamState& state)
 {
-    streamBitMask = 0;
+    state.bitMask = 0;
     
-    if (!streamSize)
+    if (!state.size)
         return 0;
     
-    streamSize--;
-    return *(streamData++);
+    state.size--;
+    return *(state.data++);
 }
 
-bool DIFDIDiskStorage::readStreamBit()
+bool DIFDIDiskStorage::readStreamBit(DIFDIStreamState& state)
 {
-    if (!streamBitMask)
+    if (!state.bitMask)
     {
-        streamValue = readStreamByte();
-        streamBitMask = 0x80;
+        state.value = readStreamByte(state);
+        state.bitMask = 0x80;
     }
     
-    bool bit = (streamValue & streamBitMask);
-    streamBitMask >>= 1;
+    bool bit = (state.value & state.bitMask);
+    state.bitMask >>= 1;
     
     return bit;
 }
 
-bool DIFDIDiskStorage::isStreamEnd()
+bool DIFDIDiskStorage::isStreamEnd(DIFDIStreamState& state)
 {
-    return !streamSize && !streamBitMask;
+    return !state.size && !state.bitMask;
 }
 
-void DIFDIDiskStorage::buildHuffmanTree(DIFDIHuffmanNode *node)
+void DIFDIDiskStorage::buildHuffmanTree(DIFDIStreamState& state,
+                                        DIFDIHuffmanTree& tree, DIInt node)
 {
-    if (isStreamEnd())
+    if (isStreamEnd(state))
         return;
     
-    bool isLeaf = readStreamBit();
+    bool isLeaf = readStreamBit(state);
     
     if (!isLeaf)
     {
-		node->left = new DIFDIHuffmanNode();
-        buildHuffmanTree(node->left);
+        // Indices are used, as the tree may be reallocated
+        DIInt left = (DIInt) tree.size();
         
-		node->right = new DIFDIHuffmanNode();
-		buildHuffmanTree(node->right);
+        tree.push_back(DIFDIHuffmanNode());
+        tree[node].left = left;
+        buildHuffmanTree(state, tree, left);
+        
+        DIInt right = (DIInt) tree.size();
+        
+        tree.push_back(DIFDIHuffmanNode());
+        tree[node].right = right;
+        buildHuffmanTree(state, tree, right);
     }
 }
 
-void DIFDIDiskStorage::readHuffmanTreeValues(DIFDIHuffmanNode *node)
+void DIFDIDiskStorage::readHuffmanTreeValues(DIFDIStreamState& state,
+                                             DIFDIHuffmanTree& tree, DIInt node)
 {
-	if (!node->left)
+	if (!tree[node].left)
     {
-        DIInt value;
+        DIInt value = readStreamByte(state);
         
-        if (huffman16Bits)
-            value = (readStreamByte() << 8) | readStreamByte();
-        else
-            value = readStreamByte();
+        if (state.huffman16Bits)
+            value = (value << 8) | readStreamByte(state);
         
-        if (huffmanSignExtension)
+        if (state.huffmanSignExtension)
         {
-            if (huffman16Bits)
+            if (state.huffman16Bits)
             {
                 if (value & 0x8000)
                     value |= 0xffff0000;
@@ -739,11 +867,116 @@ void DIFDIDiskStorage::readHuffmanTreeValues(DIFDIHuffmanNode *node)
             }
         }
         
-        node->value = value;
+        tree[node].value = value;
 	}
     else
     {
-        readHuffmanTreeValues(node->left);
-        readHuffmanTreeValues(node->right);
+        readHuffmanTreeValues(state, tree, tree[node].left);
+        readHuffmanTreeValues(state, tree, tree[node].right);
     }
 }
+
+void DIFDIDiskStorage::buildHuffmanLookupTable(DIFDIHuffmanTree& tree,
+                                               DIFDIHuffmanLookupTable& lookupTable,
+                                               DIInt node, DIInt depth, DIInt code)
+{
+    // Each entry holds the node reached after (at most) DI_FDI_HUFFMAN_LOOKUPBITS bits
+    if (!tree[node].left || (depth == DI_FDI_HUFFMAN_LOOKUPBITS))
+    {
+        DIInt shift = DI_FDI_HUFFMAN_LOOKUPBITS - depth;
+        DIInt start = code << shift;
+        DIInt end = (code + 1) << shift;
+        
+        for (DIInt i = start; i < end; i++)
+        {
+            lookupTable[i].node = node;
+            lookupTable[i].bitNum = depth;
+        }
+        
+        return;
+    }
+    
+    buildHuffmanLookupTable(tree, lookupTable, tree[node].left, depth + 1, code << 1);
+    buildHuffmanLookupTable(tree, lookupTable, tree[node].right, depth + 1, (code << 1) | 1);
+}
+
+bool DIFDIDiskStorage::decodeHuffmanStream(DIFDIStreamState& state,
+                                           DIFDIHuffmanTree& tree,
+                                           DIFDIHuffmanLookupTable& lookupTable,
+                                           DIFDIStream& stream, DIInt pulseNum, DIInt shift)
+{
+    // A single leaf tree consumes no bits
+    if (!tree[0].left)
+    {
+        for (DIInt i = 0; i < pulseNum; i++)
+            stream[i] |= tree[0].value << shift;
+        
+        return true;
+    }
+    
+    lookupTable.resize(1 << DI_FDI_HUFFMAN_LOOKUPBITS);
+    
+    buildHuffmanLookupTable(tree, lookupTable, 0, 0, 0);
+    
+    // Tree values end on a byte boundary, so codes start at state.data
+    const DIChar *data = state.data;
+    DIInt size = state.size;
+    DIInt bitNum = size * 8;
+    DIInt bitIndex = 0;
+    
+    for (DIInt i = 0; i < pulseNum; i++)
+    {
+        // Peek DI_FDI_HUFFMAN_LOOKUPBITS bits, zero-padded past the end
+        DIInt byteIndex = bitIndex >> 3;
+        DIInt window;
+        
+        if ((byteIndex + 2) < size)
+            window = ((data[byteIndex] << 16) |
+                      (data[byteIndex + 1] << 8) |
+                      data[byteIndex + 2]);
+        else
+        {
+            window = 0;
+            
+            for (DIInt j = 0; j < 3; j++)
+                window = (window << 8) | (((byteIndex + j) < size) ?
+                                          data[byteIndex + j] : 0);
+        }
+        
+        DIInt code = ((window >> (24 - DI_FDI_HUFFMAN_LOOKUPBITS - (bitIndex & 0x7))) &
+                      ((1 << DI_FDI_HUFFMAN_LOOKUPBITS) - 1));
+        
+        DIFDIHuffmanLookup& lookup = lookupTable[code];
+        
+        DIInt node = lookup.node;
+        bitIndex += lookup.bitNum;
+        
+        // Walk codes longer than the lookup table bit by bit
+        while (tree[node].left)
+        {
+            if (bitIndex >= bitNum)
+                return false;
+            
+            if (!((data[bitIndex >> 3] << (bitIndex & 0x7)) & 0x80))
+                node = tree[node].left;
+            else
+                node = tree[node].right;
+            
+            bitIndex++;
+        }
+        
+        if (bitIndex > bitNum)
+            return false;
+        
+        stream[i] |= tree[node].value << shift;
+    }
+    
+    // Skip to next byte boundary
+    DIInt byteNum = (bitIndex + 7) >> 3;
+    
+    state.data += byteNum;
+    state.size -= byteNum;
+    state.bitMask = 0;
+    
+    return true;
+}
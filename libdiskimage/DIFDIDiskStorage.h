@@ -13,30 +13,46 @@
 
 typedef vector<DIInt> DIFDIStream;
 
+#define DI_FDI_HUFFMAN_LOOKUPBITS   10
+
 struct DIFDIHuffmanNode
 {
     DIFDIHuffmanNode()
     {
         value = 0;
         
-        left = NULL;
-        right = NULL;
-    }
-    
-    ~DIFDIHuffmanNode()
-    {
-        if (left)
-            delete left;
-        if (right)
-            delete right;
+        left = 0;
+        right = 0;
     }
     
 	DIShort value;
     
-	struct DIFDIHuffmanNode *left;
-	struct DIFDIHuffmanNode *right;
+    // Child node indices (the root is never a child, so 0 denotes a leaf)
+	DIInt left;
+	DIInt right;
 };
 
+typedef vector<DIFDIHuffmanNode> DIFDIHuffmanTree;
+
+typedef struct
+{
+    DIInt node;
+    DIInt bitNum;
+} DIFDIHuffmanLookup;
+
+typedef vector<DIFDIHuffmanLookup> DIFDIHuffmanLookupTable;
+
+typedef struct
+{
+    DIChar *data;
+    DIInt size;
+    DIChar value;
+    DIInt bitMask;
+    
+    bool huffmanSignExtension;
+    bool huffman16Bits;
+} DIFDIStreamState;
+
 class DIFDIDiskStorage : public DIDiskStorage
 {
 public:
@@ -74,13 +90,9 @@ private:
     
     vector<DIData> trackData;
     
-    DIChar *streamData;
-    DIInt streamSize;
-    DIChar streamValue;
-    DIInt streamBitMask;
-    
-    bool huffmanSignExtension;
-    bool huffman16Bits;
+    DIInt pulsesBitRate;
+    vector<DIData> pulsesTrackData;
+    vector<DIInt> pulsesTrackDecoded;
     
     DIInt getCodeFromTPI(DIInt value);
     DIInt getTPIFromCode(DIInt value);
@@ -89,17 +101,29 @@ private:
     bool encodeBitstreamTrack(DIData& decodedData, DIData& data);
     
     DIInt getIndexHoleCount(DIInt value);
+    bool readPulsesTrack(DIInt index, DIData& decodedData, DIInt bitRate);
+    void decodePulsesTracks(DIInt bitRate);
+    static void *decodePulsesTracksThread(void *context);
     bool decodePulsesTrack(DIData& encodedData, DIData& data, DIInt bitRate);
     
     bool getStream(DIFDIStream& stream,
                    DIChar *data, DIInt size, DIInt compression,
                    DIInt pulseNum);
     
-    void initStream(DIChar *data, DIInt size);
-    DIChar readStreamByte();
-    bool readStreamBit();
-    bool isStreamEnd();
-    
-    void buildHuffmanTree(DIFDIHuffmanNode *node);
-    void readHuffmanTreeValues(DIFDIHuffmanNode *node);
+    void initStream(DIFDIStreamState& state, DIChar *data, DIInt size);
+    DIChar readStreamByte(DIFDIStreamState& state);
+    bool readStreamBit(DIFDIStreamState& state);
+    bool isStreamEnd(DIFDIStreamState& state);
+    
+    void buildHuffmanTree(DIFDIStreamState& state,
+                          DIFDIHuffmanTree& tree, DIInt node);
+    void readHuffmanTreeValues(DIFDIStreamState& state,
+                               DIFDIHuffmanTree& tree, DIInt node);
+    void buildHuffmanLookupTable(DIFDIHuffmanTree& tree,
+                                 DIFDIHuffmanLookupTable& lookupTable,
+                                 DIInt node, DIInt depth, DIInt code);
+    bool decodeHuffmanStream(DIFDIStreamState& state,
+                             DIFDIHuffmanTree& tree,
+                             DIFDIHuffmanLookupTable& lookupTable,
+                             DIFDIStream& stream, DIInt pulseNum, DIInt shift);
 };
@@ -15,6 +15,7 @@ DIFileBackingStore::DIFileBackingStore()
     fp = NULL;
     
     writeEnabled = false;
+    size = 0;
 }
 
 DIFileBackingStore::~DIFileBackingStore()
@@ -23,10 +24,16 @@ DIFileBackingStore::~DIFileBackingStore()
 }
 
 bool DIFileBackingStore::open(string path)
+{
+    return open(path, true);
+}
+
+bool DIFileBackingStore::open(string path, bool writeEnabled)
 {
     close();
     
-    fp = fopen(path.c_str(), "r+b");
+    if (writeEnabled)
+        fp = fopen(path.c_str(), "r+b");
     
     if (!fp)
     {
@@ -36,7 +43,17 @@ bool DIFileBackingStore::open(string path)
             return false;
     }
     else
-        writeEnabled = true;
+        this->writeEnabled = true;
+    
+    // The size is cached, so block reads don't seek to the end
+    if (fseeko(fp, 0, SEEK_END))
+    {
+        close();
+        
+        return false;
+    }
+    
+    size = ftello(fp);
     
     this->path = path; 
     
@@ -53,6 +70,7 @@ bool DIFileBackingStore::create(string path)
         return false;
     
     writeEnabled = true;
+    size = 0;
     
     this->path = path; 
     
@@ -66,6 +84,7 @@ void DIFileBackingStore::close()
     
     fp = NULL;
     writeEnabled = false;
+    size = 0;
     
     path = "";
 }
@@ -82,15 +101,7 @@ bool DIFileBackingStore::isWriteEnabled()
 
 DILong DIFileBackingStore::getSize()
 {
-    if (!fp)
-        return 0;
-    
-    if (fseek(fp, 0, SEEK_END))
-        return 0;
-    
-    DILong dataSize = ftell(fp);
-    
-    return dataSize;
+    return size;
 }
 
 string DIFileBackingStore::getFormatLabel()
@@ -111,7 +122,7 @@ bool DIFileBackingStore::read(DILong pos, DIChar *buf, DIInt num)
     if (!num)
         return true;
     
-    if (fseek(fp, (long) pos, SEEK_SET))
+    if (fseeko(fp, (off_t) pos, SEEK_SET))
         return false;
     
     return fread(buf, num, 1, fp);
@@ -128,8 +139,14 @@ bool DIFileBackingStore::write(DILong pos, const DIChar *buf, DIInt num)
     if (!num)
         return true;
     
-    if (fseek(fp, (long) pos, SEEK_SET))
+    if (fseeko(fp, (off_t) pos, SEEK_SET))
         return false;
     
-    return fwrite(buf, num, 1, fp);
+    if (!fwrite(buf, num, 1, fp))
+        return false;
+    
+    if ((pos + num) > size)
+        size = pos + num;
+    
+    return true;
 }
@@ -23,6 +23,7 @@ public:
     ~DIFileBackingStore();
     
     bool open(string path);
+    bool open(string path, bool writeEnabled);
     bool create(string path);
     void close();
     
@@ -37,6 +38,7 @@ public:
 private:
     FILE *fp;
     bool writeEnabled;
+    DILong size;
     
     string path;
 };
@@ -0,0 +1,229 @@
+/**
+ * libdiskimage
+ * Mapped File Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a memory-mapped file backing store
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "DIMappedFileBackingStore.h"
+
+DIMappedFileBackingStore::DIMappedFileBackingStore()
+{
+    fd = -1;
+    
+    writeEnabled = false;
+    
+    size = 0;
+    
+    mapData = NULL;
+    mapSize = 0;
+}
+
+DIMappedFileBackingStore::~DIMappedFileBackingStore()
+{
+    close();
+}
+
+bool DIMappedFileBackingStore::open(string path)
+{
+    return open(path, true);
+}
+
+bool DIMappedFileBackingStore::open(string path, bool writeEnabled)
+{
+    close();
+    
+    if (writeEnabled)
+        fd = ::open(path.c_str(), O_RDWR);
+    
+    if (fd < 0)
+    {
+        fd = ::open(path.c_str(), O_RDONLY);
+        
+        if (fd < 0)
+            return false;
+    }
+    else
+        this->writeEnabled = true;
+    
+    struct stat st;
+    
+    if (fstat(fd, &st))
+    {
+        close();
+        
+        return false;
+    }
+    
+    size = st.st_size;
+    
+    this->path = path;
+    
+    map();
+    
+    return true;
+}
+
+bool DIMappedFileBackingStore::create(string path)
+{
+    close();
+    
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    
+    if (fd < 0)
+        return false;
+    
+    writeEnabled = true;
+    
+    this->path = path;
+    
+    return true;
+}
+
+void DIMappedFileBackingStore::close()
+{
+    unmap();
+    
+    if (fd >= 0)
+        ::close(fd);
+    
+    fd = -1;
+    writeEnabled = false;
+    
+    size = 0;
+    
+    path = "";
+}
+
+string DIMappedFileBackingStore::getPath()
+{
+    return path;
+}
+
+bool DIMappedFileBackingStore::isWriteEnabled()
+{
+    return writeEnabled;
+}
+
+DILong DIMappedFileBackingStore::getSize()
+{
+    return size;
+}
+
+string DIMappedFileBackingStore::getFormatLabel()
+{
+    string formatLabel = "Raw Disk Image";
+    
+    if (!isWriteEnabled())
+        formatLabel += " (read-only)";
+    
+    return formatLabel;
+}
+
+bool DIMappedFileBackingStore::read(DILong pos, DIChar *buf, DIInt num)
+{
+    if (fd < 0)
+        return false;
+    
+    if (!num)
+        return true;
+    
+    if ((pos + num) > size)
+        return false;
+    
+    if ((pos + num) <= mapSize)
+    {
+        memcpy(buf, mapData + pos, num);
+        
+        return true;
+    }
+    
+    // Fall back to positional I/O outside the mapped region
+    while (num)
+    {
+        ssize_t n = pread(fd, buf, num, (off_t) pos);
+        
+        if (n <= 0)
+            return false;
+        
+        pos += n;
+        buf += n;
+        num -= (DIInt) n;
+    }
+    
+    return true;
+}
+
+bool DIMappedFileBackingStore::write(DILong pos, const DIChar *buf, DIInt num)
+{
+    if (!writeEnabled)
+        return false;
+    
+    if (fd < 0)
+        return false;
+    
+    if (!num)
+        return true;
+    
+    if ((pos + num) <= mapSize)
+    {
+        memcpy(mapData + pos, buf, num);
+        
+        return true;
+    }
+    
+    // Writes that grow the file go through positional I/O; the mapping
+    // keeps covering the original size
+    while (num)
+    {
+        ssize_t n = pwrite(fd, buf, num, (off_t) pos);
+        
+        if (n <= 0)
+            return false;
+        
+        pos += n;
+        buf += n;
+        num -= (DIInt) n;
+        
+        if (pos > size)
+            size = pos;
+    }
+    
+    return true;
+}
+
+void DIMappedFileBackingStore::map()
+{
+    unmap();
+    
+    if (!size || ((size_t) size != size))
+        return;
+    
+    int prot = PROT_READ;
+    
+    if (writeEnabled)
+        prot |= PROT_WRITE;
+    
+    void *data = mmap(NULL, (size_t) size, prot, MAP_SHARED, fd, 0);
+    
+    if (data == MAP_FAILED)
+        return;
+    
+    mapData = (DIChar *) data;
+    mapSize = size;
+}
+
+void DIMappedFileBackingStore::unmap()
+{
+    if (mapData)
+        munmap(mapData, (size_t) mapSize);
+    
+    mapData = NULL;
+    mapSize = 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * libdiskimage
+ * Mapped File Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a memory-mapped file backing store
+ */
+
+#ifndef _DIMAPPEDFILEBACKINGSTORE_H
+#define _DIMAPPEDFILEBACKINGSTORE_H
+
+#include "DICommon.h"
+#include "DIBackingStore.h"
+
+class DIMappedFileBackingStore : public DIBackingStore
+{
+public:
+    DIMappedFileBackingStore();
+    ~DIMappedFileBackingStore();
+    
+    bool open(string path);
+    bool open(string path, bool writeEnabled);
+    bool create(string path);
+    void close();
+    
+    string getPath();
+    bool isWriteEnabled();
+    DILong getSize();
+    string getFormatLabel();
+    
+    bool read(DILong pos, DIChar *buf, DIInt num);
+    bool write(DILong pos, const DIChar *buf, DIInt num);
+    
+private:
+    int fd;
+    bool writeEnabled;
+    
+    string path;
+    
+    DILong size;
+    
+    DIChar *mapData;
+    DILong mapSize;
+    
+    void map();
+    void unmap();
+};
+
+#endif
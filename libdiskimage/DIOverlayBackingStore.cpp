@@ -0,0 +1,407 @@
+
+/**
+ * libdiskimage
+ * Overlay Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a copy-on-write overlay backing store
+ */
+
+#include "DIOverlayBackingStore.h"
+
+#define OVERLAY_SIGNATURE       "libdiskimage overlay"
+#define OVERLAY_VERSION         2
+#define OVERLAY_HEADERSIZE      0x200
+
+#define OVERLAY_RECORDID        0x524f4944
+#define OVERLAY_RECORDHEADERSIZE 0x10
+#define OVERLAY_RECORDSIZE      (OVERLAY_RECORDHEADERSIZE + DI_OVERLAY_CHUNKSIZE)
+
+DIOverlayBackingStore::DIOverlayBackingStore()
+{
+    deltaBackingStore = NULL;
+    
+    close();
+}
+
+DIOverlayBackingStore::~DIOverlayBackingStore()
+{
+    close();
+}
+
+bool DIOverlayBackingStore::open(DIBackingStore *baseBackingStore)
+{
+    close();
+    
+    ramBackingStore.create();
+    
+    return open(baseBackingStore, &ramBackingStore);
+}
+
+bool DIOverlayBackingStore::open(DIBackingStore *baseBackingStore,
+                                 DIBackingStore *deltaBackingStore)
+{
+    if (deltaBackingStore != &ramBackingStore)
+        close();
+    
+    this->baseBackingStore = baseBackingStore;
+    this->deltaBackingStore = deltaBackingStore;
+    
+    baseSize = baseBackingStore->getSize();
+    baseHash = getBaseHash();
+    
+    if (!deltaBackingStore->getSize())
+    {
+        // New delta
+        size = baseSize;
+        generation = 1;
+        
+        if (writeHeader())
+            return true;
+    }
+    else if (readDelta())
+        return true;
+    
+    this->baseBackingStore = NULL;
+    this->deltaBackingStore = NULL;
+    
+    return false;
+}
+
+void DIOverlayBackingStore::close()
+{
+    flush();
+    
+    baseBackingStore = NULL;
+    deltaBackingStore = NULL;
+    
+    ramBackingStore.create();
+    
+    size = 0;
+    baseSize = 0;
+    baseHash = 0;
+    generation = 0;
+    headerModified = false;
+    
+    chunkOffset.clear();
+    nextRecordOffset = OVERLAY_HEADERSIZE;
+}
+
+bool DIOverlayBackingStore::isOpen()
+{
+    return (deltaBackingStore != NULL);
+}
+
+bool DIOverlayBackingStore::isModified()
+{
+    return !chunkOffset.empty() || (size != baseSize);
+}
+
+bool DIOverlayBackingStore::flush()
+{
+    if (!deltaBackingStore || !headerModified)
+        return true;
+    
+    return writeHeader();
+}
+
+bool DIOverlayBackingStore::commit()
+{
+    if (!deltaBackingStore)
+        return false;
+    
+    if (!baseBackingStore->isWriteEnabled() || !isWriteEnabled())
+        return false;
+    
+    // Write modified chunks to base
+    DIData data;
+    
+    data.resize(DI_OVERLAY_CHUNKSIZE);
+    
+    for (map<DILong, DILong>::iterator i = chunkOffset.begin();
+         i != chunkOffset.end();
+         i++)
+    {
+        DILong pos = i->first * DI_OVERLAY_CHUNKSIZE;
+        
+        if (pos >= size)
+            continue;
+        
+        DIInt num = (DIInt) min((DILong) DI_OVERLAY_CHUNKSIZE, size - pos);
+        
+        if (!deltaBackingStore->read(i->second, &data.front(), num))
+            return false;
+        
+        if (!baseBackingStore->write(pos, &data.front(), num))
+            return false;
+    }
+    
+    // Start a new delta generation, which invalidates all previous records
+    if (deltaBackingStore == &ramBackingStore)
+        ramBackingStore.create();
+    
+    baseSize = baseBackingStore->getSize();
+    baseHash = getBaseHash();
+    size = baseSize;
+    generation++;
+    
+    chunkOffset.clear();
+    nextRecordOffset = OVERLAY_HEADERSIZE;
+    
+    return writeHeader();
+}
+
+bool DIOverlayBackingStore::isWriteEnabled()
+{
+    return deltaBackingStore && deltaBackingStore->isWriteEnabled();
+}
+
+DILong DIOverlayBackingStore::getSize()
+{
+    return size;
+}
+
+string DIOverlayBackingStore::getFormatLabel()
+{
+    string formatLabel = "Raw Disk Image";
+    
+    if (!isWriteEnabled())
+        formatLabel += " (read-only)";
+    else
+        formatLabel += " (copy-on-write)";
+    
+    return formatLabel;
+}
+
+bool DIOverlayBackingStore::read(DILong pos, DIChar *buf, DIInt num)
+{
+    if (!deltaBackingStore)
+        return false;
+    
+    if ((pos + num) > size)
+        return false;
+    
+    while (num)
+    {
+        DILong chunkIndex = pos / DI_OVERLAY_CHUNKSIZE;
+        DIInt chunkPos = pos % DI_OVERLAY_CHUNKSIZE;
+        
+        map<DILong, DILong>::iterator i = chunkOffset.find(chunkIndex);
+        
+        DIInt runNum;
+        
+        if (i != chunkOffset.end())
+        {
+            runNum = min(num, DI_OVERLAY_CHUNKSIZE - chunkPos);
+            
+            if (!deltaBackingStore->read(i->second + chunkPos, buf, runNum))
+                return false;
+        }
+        else
+        {
+            // Read from base up to the next modified chunk
+            DILong runEnd = pos + num;
+            
+            map<DILong, DILong>::iterator next = chunkOffset.upper_bound(chunkIndex);
+            
+            if (next != chunkOffset.end())
+                runEnd = min(runEnd, next->first * DI_OVERLAY_CHUNKSIZE);
+            
+            runNum = (DIInt) (runEnd - pos);
+            
+            if (!readBase(pos, buf, runNum))
+                return false;
+        }
+        
+        pos += runNum;
+        buf += runNum;
+        num -= runNum;
+    }
+    
+    return true;
+}
+
+bool DIOverlayBackingStore::write(DILong pos, const DIChar *buf, DIInt num)
+{
+    if (!isWriteEnabled())
+        return false;
+    
+    if ((pos + num) > size)
+    {
+        size = pos + num;
+        
+        headerModified = true;
+    }
+    
+    while (num)
+    {
+        DILong chunkIndex = pos / DI_OVERLAY_CHUNKSIZE;
+        DIInt chunkPos = pos % DI_OVERLAY_CHUNKSIZE;
+        DIInt runNum = min(num, DI_OVERLAY_CHUNKSIZE - chunkPos);
+        
+        map<DILong, DILong>::iterator i = chunkOffset.find(chunkIndex);
+        
+        if (i != chunkOffset.end())
+        {
+            if (!deltaBackingStore->write(i->second + chunkPos, buf, runNum))
+                return false;
+        }
+        else if (!allocateChunk(chunkIndex, chunkPos, buf, runNum))
+            return false;
+        
+        pos += runNum;
+        buf += runNum;
+        num -= runNum;
+    }
+    
+    return true;
+}
+
+// Hashes the first and last chunks of the base (FNV-1a), which catches a
+// replaced or reformatted image of the same size without reading all of it
+DILong DIOverlayBackingStore::getBaseHash()
+{
+    DILong hash = 0xcbf29ce484222325ULL;
+    
+    if (!baseSize)
+        return hash;
+    
+    DILong lastChunkIndex = (baseSize - 1) / DI_OVERLAY_CHUNKSIZE;
+    DILong chunkIndexes[2] = { 0, lastChunkIndex };
+    
+    for (DIInt i = 0; i < (lastChunkIndex ? 2 : 1); i++)
+    {
+        DIChar chunk[DI_OVERLAY_CHUNKSIZE];
+        DILong pos = chunkIndexes[i] * DI_OVERLAY_CHUNKSIZE;
+        DIInt num = (DIInt) min((DILong) DI_OVERLAY_CHUNKSIZE, baseSize - pos);
+        
+        if (!baseBackingStore->read(pos, chunk, num))
+            return 0;
+        
+        for (DIInt j = 0; j < num; j++)
+        {
+            hash ^= chunk[j];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    
+    return hash;
+}
+
+bool DIOverlayBackingStore::readDelta()
+{
+    DIChar header[OVERLAY_HEADERSIZE];
+    
+    if (!deltaBackingStore->read(0, header, OVERLAY_HEADERSIZE))
+        return false;
+    
+    // Check signature and version
+    if (memcmp((char *) header, OVERLAY_SIGNATURE, sizeof(OVERLAY_SIGNATURE) - 1))
+        return false;
+    
+    if (getDIIntLE(&header[0x20]) != OVERLAY_VERSION)
+        return false;
+    
+    if (getDIIntLE(&header[0x24]) != DI_OVERLAY_CHUNKSIZE)
+        return false;
+    
+    // The base must not have changed since the delta was created
+    if ((getDILongLE(&header[0x38]) != baseSize) ||
+        (getDILongLE(&header[0x40]) != baseHash))
+        return false;
+    
+    generation = getDIIntLE(&header[0x28]);
+    size = getDILongLE(&header[0x30]);
+    
+    // Scan records of the current generation
+    DILong deltaSize = deltaBackingStore->getSize();
+    
+    nextRecordOffset = OVERLAY_HEADERSIZE;
+    
+    while ((nextRecordOffset + OVERLAY_RECORDSIZE) <= deltaSize)
+    {
+        DIChar recordHeader[OVERLAY_RECORDHEADERSIZE];
+        
+        if (!deltaBackingStore->read(nextRecordOffset,
+                                     recordHeader, OVERLAY_RECORDHEADERSIZE))
+            return false;
+        
+        if ((getDIIntLE(&recordHeader[0x0]) != OVERLAY_RECORDID) ||
+            (getDIIntLE(&recordHeader[0x4]) != generation))
+            break;
+        
+        DILong chunkIndex = getDILongLE(&recordHeader[0x8]);
+        
+        chunkOffset[chunkIndex] = nextRecordOffset + OVERLAY_RECORDHEADERSIZE;
+        
+        nextRecordOffset += OVERLAY_RECORDSIZE;
+    }
+    
+    return true;
+}
+
+bool DIOverlayBackingStore::writeHeader()
+{
+    DIChar header[OVERLAY_HEADERSIZE];
+    
+    memset(header, 0, OVERLAY_HEADERSIZE);
+    
+    memcpy((char *) header, OVERLAY_SIGNATURE, sizeof(OVERLAY_SIGNATURE) - 1);
+    setDIIntLE(&header[0x20], OVERLAY_VERSION);
+    setDIIntLE(&header[0x24], DI_OVERLAY_CHUNKSIZE);
+    setDIIntLE(&header[0x28], generation);
+    setDILongLE(&header[0x30], size);
+    setDILongLE(&header[0x38], baseSize);
+    setDILongLE(&header[0x40], baseHash);
+    
+    if (!deltaBackingStore->write(0, header, OVERLAY_HEADERSIZE))
+        return false;
+    
+    headerModified = false;
+    
+    return true;
+}
+
+bool DIOverlayBackingStore::readBase(DILong pos, DIChar *buf, DIInt num)
+{
+    // Data beyond the end of the base reads as zero
+    DIInt baseNum = 0;
+    
+    if (pos < baseSize)
+        baseNum = (DIInt) min((DILong) num, baseSize - pos);
+    
+    if (baseNum && !baseBackingStore->read(pos, buf, baseNum))
+        return false;
+    
+    memset(buf + baseNum, 0, num - baseNum);
+    
+    return true;
+}
+
+bool DIOverlayBackingStore::allocateChunk(DILong chunkIndex, DIInt chunkPos,
+                                          const DIChar *buf, DIInt num)
+{
+    // Build record from base chunk and new data, and append it to the delta
+    DIChar record[OVERLAY_RECORDSIZE];
+    
+    setDIIntLE(&record[0x0], OVERLAY_RECORDID);
+    setDIIntLE(&record[0x4], generation);
+    setDILongLE(&record[0x8], chunkIndex);
+    
+    DIChar *chunk = &record[OVERLAY_RECORDHEADERSIZE];
+    
+    if (!readBase(chunkIndex * DI_OVERLAY_CHUNKSIZE, chunk, DI_OVERLAY_CHUNKSIZE))
+        return false;
+    
+    memcpy(chunk + chunkPos, buf, num);
+    
+    if (!deltaBackingStore->write(nextRecordOffset, record, OVERLAY_RECORDSIZE))
+        return false;
+    
+    chunkOffset[chunkIndex] = nextRecordOffset + OVERLAY_RECORDHEADERSIZE;
+    
+    nextRecordOffset += OVERLAY_RECORDSIZE;
+    
+    return true;
+}
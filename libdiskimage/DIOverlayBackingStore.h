@@ -0,0 +1,72 @@
+
+/**
+ * libdiskimage
+ * Overlay Backing Store
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Accesses a copy-on-write overlay backing store
+ */
+
+// Notes:
+// * The base backing store is never written, except by commit().
+// * Modified chunks are kept in a delta backing store (a file, or RAM when
+//   no delta backing store is given). The delta consists of a header followed
+//   by records, each holding a chunk index and a full copy of the chunk.
+// * commit() writes all modified chunks to the base and empties the delta.
+// * The delta records the size of the base and a hash of its first and last
+//   chunks. A delta is refused when the base no longer matches them.
+
+#ifndef _DIOVERLAYBACKINGSTORE_H
+#define _DIOVERLAYBACKINGSTORE_H
+
+#include "DICommon.h"
+#include "DIBackingStore.h"
+#include "DIRAMBackingStore.h"
+
+#define DI_OVERLAY_CHUNKSIZE 0x1000
+
+class DIOverlayBackingStore : public DIBackingStore
+{
+public:
+    DIOverlayBackingStore();
+    ~DIOverlayBackingStore();
+    
+    bool open(DIBackingStore *baseBackingStore);
+    bool open(DIBackingStore *baseBackingStore, DIBackingStore *deltaBackingStore);
+    void close();
+    
+    bool isOpen();
+    bool isModified();
+    bool flush();
+    bool commit();
+    
+    bool isWriteEnabled();
+    DILong getSize();
+    string getFormatLabel();
+    
+    bool read(DILong pos, DIChar *buf, DIInt num);
+    bool write(DILong pos, const DIChar *buf, DIInt num);
+    
+private:
+    DIBackingStore *baseBackingStore;
+    DIBackingStore *deltaBackingStore;
+    DIRAMBackingStore ramBackingStore;
+    
+    DILong size;
+    DILong baseSize;
+    DILong baseHash;
+    DIInt generation;
+    bool headerModified;
+    
+    map<DILong, DILong> chunkOffset;
+    DILong nextRecordOffset;
+    
+    DILong getBaseHash();
+    bool readDelta();
+    bool writeHeader();
+    bool readBase(DILong pos, DIChar *buf, DIInt num);
+    bool allocateChunk(DILong chunkIndex, DIInt chunkPos, const DIChar *buf, DIInt num);
+};
+
+#endif
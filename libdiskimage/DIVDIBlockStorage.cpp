@@ -15,6 +15,13 @@
 #define VDI_EMPTY   0xffffffff
 
 DIVDIBlockStorage::DIVDIBlockStorage()
+{
+    backingStore = NULL;
+    
+    close();
+}
+
+DIVDIBlockStorage::~DIVDIBlockStorage()
 {
     close();
 }
@@ -83,7 +90,7 @@ bool DIVDIBlockStorage::open(DIBackingStore *backingStore)
     if (!backingStore->read(vdiBlockMapOffset, &blockMap.front(), (DIInt) blockMap.size()))
         return false;
     
-    vdiBlockMap.resize(blockNum / vdiBlockSize);
+    vdiBlockMap.resize(vdiBlockNum);
     for (DIInt i = 0; i < vdiBlockMap.size(); i++)
         vdiBlockMap[i] = getDIIntLE(&blockMap[i * sizeof(DIInt)]);
     
@@ -105,6 +112,9 @@ bool DIVDIBlockStorage::open(DIBackingStore *backingStore)
 
 void DIVDIBlockStorage::close()
 {
+    // Write back block map
+    flush();
+    
     backingStore = NULL;
     
     blockNum = 0;
@@ -119,6 +129,8 @@ void DIVDIBlockStorage::close()
     vdiAllocatedBlockNum = 0;
     
     vdiBlockMap.clear();
+    vdiBlockMapDirtyStart = 0;
+    vdiBlockMapDirtyEnd = 0;
 }
 
 bool DIVDIBlockStorage::isWriteEnabled()
@@ -158,24 +170,35 @@ DIInt DIVDIBlockStorage::getSectors()
 
 bool DIVDIBlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
 {
-    for (; num; index++, buf += DI_BLOCKSIZE, num--)
+    while (num)
     {
         if (index >= blockNum)
             return false;
         
-        DIInt vdiBlockMapIndex = index / vdiBlockSize;
-        DIInt vdiBlockIndex = vdiBlockMap[vdiBlockMapIndex];
+        DILong location = getBlockLocation(index);
         
-        if (vdiBlockIndex == VDI_EMPTY)
-            memset(buf, 0, DI_BLOCKSIZE);
-        else            
+        // Extend run over physically contiguous (or unallocated) blocks
+        DIInt runNum = 1;
+        
+        while ((runNum < num) && ((index + runNum) < blockNum))
         {
-            DILong pos = (vdiDataOffset + (index + (vdiBlockIndex - vdiBlockMapIndex) *
-                                           vdiBlockSize) * DI_BLOCKSIZE);
+            DIInt nextLocation = getBlockLocation(index + runNum);
             
-            if (!backingStore->read(pos, buf, DI_BLOCKSIZE))
-                return false;
+            if (nextLocation != (location ? (location + runNum) : 0))
+                break;
+            
+            runNum++;
         }
+        
+        if (!location)
+            memset(buf, 0, runNum * DI_BLOCKSIZE);
+        else if (!backingStore->read(vdiDataOffset + (location - 1) * DI_BLOCKSIZE,
+                                     buf, runNum * DI_BLOCKSIZE))
+            return false;
+        
+        index += runNum;
+        buf += runNum * DI_BLOCKSIZE;
+        num -= runNum;
     }
     
     return true;
@@ -183,74 +206,142 @@ bool DIVDIBlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
 
 bool DIVDIBlockStorage::writeBlocks(DIInt index, const DIChar *buf, DIInt num)
 {
-    for (; num; index++, buf += DI_BLOCKSIZE, num--)
+    const DIChar *runBuf = NULL;
+    DIInt runLocation = 0;
+    DIInt runNum = 0;
+    
+    for (;; index++, buf += DI_BLOCKSIZE, num--)
     {
-        if (index >= blockNum)
-            return false;
-        
-        DIInt vdiBlockMapIndex = index / vdiBlockSize;
-        DIInt vdiBlockIndex = vdiBlockMap[vdiBlockMapIndex];
+        DIInt location = 0;
         
-        if (vdiBlockIndex == VDI_EMPTY)
+        if (num)
         {
-            if (isBlockEmpty(buf))
-                continue;
+            if (index >= blockNum)
+                return false;
             
-            vdiBlockIndex = allocateVDIBlock(vdiBlockMapIndex);
+            location = getBlockLocation(index);
             
-            if (vdiBlockIndex == VDI_EMPTY)
+            // Do not allocate VDI blocks for empty blocks
+            if (!location && !isDIDataZero(buf, DI_BLOCKSIZE))
+            {
+                DIInt vdiBlockIndex = allocateVDIBlock(index / vdiBlockSize);
+                
+                if (vdiBlockIndex == VDI_EMPTY)
+                    return false;
+                
+                location = getBlockLocation(index);
+            }
+        }
+        
+        // Write out run when it can not be extended
+        if (runNum && (location != (runLocation + runNum)))
+        {
+            if (!backingStore->write(vdiDataOffset + (DILong) (runLocation - 1) * DI_BLOCKSIZE,
+                                     runBuf, runNum * DI_BLOCKSIZE))
                 return false;
+            
+            runNum = 0;
         }
         
-        DILong pos = (vdiDataOffset + (vdiBlockIndex * vdiBlockSize +
-                                       index % vdiBlockSize) * DI_BLOCKSIZE);
+        if (!num)
+            break;
         
-        if (!backingStore->write(pos, buf, DI_BLOCKSIZE))
-            return false;
+        if (!location)
+            continue;
+        
+        if (!runNum)
+        {
+            runBuf = buf;
+            runLocation = location;
+        }
+        
+        runNum++;
     }
     
     return true;
 }
 
-bool DIVDIBlockStorage::isBlockEmpty(const DIChar *buf)
+bool DIVDIBlockStorage::flush()
 {
-    for (DIInt i = 0; i < DI_BLOCKSIZE; i++)
-        if (buf[i])
-            return false;
+    if (!backingStore)
+        return true;
+    
+    if (vdiBlockMapDirtyStart == vdiBlockMapDirtyEnd)
+        return true;
+    
+    // Write back modified block map range
+    DIData data;
+    
+    data.resize((vdiBlockMapDirtyEnd - vdiBlockMapDirtyStart) * sizeof(DIInt));
+    
+    for (DIInt i = vdiBlockMapDirtyStart; i < vdiBlockMapDirtyEnd; i++)
+        setDIIntLE(&data[(i - vdiBlockMapDirtyStart) * sizeof(DIInt)], vdiBlockMap[i]);
+    
+    if (!backingStore->write(vdiBlockMapOffset + vdiBlockMapDirtyStart * sizeof(DIInt),
+                             &data.front(), (DIInt) data.size()))
+        return false;
+    
+    // Update number of allocated blocks
+    DIChar intLEValue[4];
+    
+    setDIIntLE(intLEValue, vdiAllocatedBlockNum);
+    
+    if (!backingStore->write(0x184,
+                             intLEValue, sizeof(DIInt)))
+        return false;
+    
+    vdiBlockMapDirtyStart = 0;
+    vdiBlockMapDirtyEnd = 0;
     
     return true;
 }
 
+DIInt DIVDIBlockStorage::getBlockLocation(DIInt index)
+{
+    // Returns the data area block index plus one, or zero when not allocated
+    DIInt vdiBlockIndex = vdiBlockMap[index / vdiBlockSize];
+    
+    if (vdiBlockIndex == VDI_EMPTY)
+        return 0;
+    
+    return vdiBlockIndex * vdiBlockSize + index % vdiBlockSize + 1;
+}
+
 DIInt DIVDIBlockStorage::allocateVDIBlock(DIInt vdiBlockMapIndex)
 {
     // Allocate new block
-    vdiAllocatedBlockNum++;
+    DIInt vdiBlockIndex = vdiAllocatedBlockNum;
     
+    DILong start = vdiDataOffset + (DILong) vdiBlockIndex * vdiBlockSize * DI_BLOCKSIZE;
+    DILong end = start + (DILong) vdiBlockSize * DI_BLOCKSIZE;
+    
+    // Extending the file zero-fills the block, otherwise clear it
     DIData dummy;
     
-    dummy.resize(vdiBlockSize);
+    if (start < backingStore->getSize())
+        dummy.resize(end - start);
+    else
+        dummy.resize(DI_BLOCKSIZE);
     
-    if (!backingStore->write(vdiDataOffset +
-                             (vdiAllocatedBlockNum - 1) * vdiBlockSize * DI_BLOCKSIZE,
+    if (!backingStore->write(end - dummy.size(),
                              &dummy.front(), (DIInt) dummy.size()))
         return VDI_EMPTY;
     
-    // Update block map
-    DIChar intLEValue[4];
-    
-    setDIIntLE(intLEValue, vdiAllocatedBlockNum - 1);
-    
-    if (!backingStore->write(vdiBlockMapOffset + vdiBlockMapIndex * sizeof(DIInt),
-                             intLEValue, sizeof(DIInt)))
-        return VDI_EMPTY;
-    
-    setDIIntLE(intLEValue, vdiAllocatedBlockNum);
+    vdiAllocatedBlockNum++;
     
-    if (!backingStore->write(0x184,
-                             intLEValue, sizeof(DIInt)))
-        return VDI_EMPTY;
+    // Update block map, this is written back on flush
+    vdiBlockMap[vdiBlockMapIndex] = vdiBlockIndex;
     
-    vdiBlockMap[vdiBlockMapIndex] = (vdiAllocatedBlockNum - 1);
+    if (vdiBlockMapDirtyStart == vdiBlockMapDirtyEnd)
+    {
+        vdiBlockMapDirtyStart = vdiBlockMapIndex;
+        vdiBlockMapDirtyEnd = vdiBlockMapIndex + 1;
+    }
+    else
+    {
+        vdiBlockMapDirtyStart = min(vdiBlockMapDirtyStart, vdiBlockMapIndex);
+        vdiBlockMapDirtyEnd = max(vdiBlockMapDirtyEnd, vdiBlockMapIndex + 1);
+    }
     
-    return vdiAllocatedBlockNum;
+    return vdiBlockIndex;
 }
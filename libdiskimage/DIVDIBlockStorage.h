@@ -25,6 +25,7 @@ class DIVDIBlockStorage : public DIBlockStorage
 {
 public:
     DIVDIBlockStorage();
+    ~DIVDIBlockStorage();
     
     bool open(DIBackingStore *backingStore);
     void close();
@@ -40,6 +41,8 @@ public:
     bool readBlocks(DIInt index, DIChar *buf, DIInt num);
     bool writeBlocks(DIInt index, const DIChar *buf, DIInt num);
     
+    bool flush();
+    
 private:
     DIBackingStore *backingStore;
     
@@ -55,8 +58,10 @@ private:
     DIInt vdiAllocatedBlockNum;
     
     vector<DIInt> vdiBlockMap;
+    DIInt vdiBlockMapDirtyStart;
+    DIInt vdiBlockMapDirtyEnd;
     
-    bool isBlockEmpty(const DIChar *buf);
+    DIInt getBlockLocation(DIInt index);
     DIInt allocateVDIBlock(DIInt vdiBlockMapIndex);
 };
 
@@ -88,6 +88,9 @@ bool DIVMDKBlockStorage::open(DIBackingStore *backingStore)
     
     directoryEntrySize = grainTableSize * grainSize;
     
+    // New grains are appended at the end of the file
+    nextGrainBlock = (DIInt) ((backingStore->getSize() + DI_BLOCKSIZE - 1) / DI_BLOCKSIZE);
+    
     // Mark in use
     setInUse(true);
     
@@ -98,7 +101,9 @@ bool DIVMDKBlockStorage::open(DIBackingStore *backingStore)
 
 void DIVMDKBlockStorage::close()
 {
-    // Unmark in use
+    // Write back grain tables and unmark in use
+    flush();
+    
     setInUse(false);
     
     backingStore = NULL;
@@ -115,8 +120,10 @@ void DIVMDKBlockStorage::close()
     directory2Block = 0;
     redundantDirectory = false;
     allocatedBlockNum = 0;
+    nextGrainBlock = 0;
     
     metadata.clear();
+    dirtyMetadataBlocks.clear();
 }
 
 bool DIVMDKBlockStorage::isWriteEnabled()
@@ -156,28 +163,35 @@ DIInt DIVMDKBlockStorage::getSectors()
 
 bool DIVMDKBlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
 {
-    for (; num; index++, buf += DI_BLOCKSIZE, num--)
+    while (num)
     {
         if (index >= blockNum)
             return false;
         
-        DIInt directoryIndex = index / directoryEntrySize;
-        DIInt directoryEntry = metadata[directory1Block * DI_BLOCKSIZE / sizeof(DIInt) +
-                                        directoryIndex];
+        DIInt location = getBlockLocation(index);
         
-        DIInt grainTableIndex = (index % directoryEntrySize) / grainSize;
-        DIInt grainTableEntry = metadata[directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) +
-                                         grainTableIndex];
+        // Extend run over physically contiguous (or unallocated) blocks
+        DIInt runNum = 1;
         
-        if (grainTableEntry <= 1)
-            memset(buf, 0, DI_BLOCKSIZE);
-        else            
+        while ((runNum < num) && ((index + runNum) < blockNum))
         {
-            DIInt blockIndex = grainTableEntry + index % grainSize;
+            DIInt nextLocation = getBlockLocation(index + runNum);
             
-            if (!backingStore->read(blockIndex * DI_BLOCKSIZE, buf, DI_BLOCKSIZE))
-                return false;
+            if (nextLocation != (location ? (location + runNum) : 0))
+                break;
+            
+            runNum++;
         }
+        
+        if (!location)
+            memset(buf, 0, runNum * DI_BLOCKSIZE);
+        else if (!backingStore->read((DILong) location * DI_BLOCKSIZE,
+                                     buf, runNum * DI_BLOCKSIZE))
+            return false;
+        
+        index += runNum;
+        buf += runNum * DI_BLOCKSIZE;
+        num -= runNum;
     }
     
     return true;
@@ -185,36 +199,96 @@ bool DIVMDKBlockStorage::readBlocks(DIInt index, DIChar *buf, DIInt num)
 
 bool DIVMDKBlockStorage::writeBlocks(DIInt index, const DIChar *buf, DIInt num)
 {
-    for (; num; index++, buf += DI_BLOCKSIZE, num--)
+    const DIChar *runBuf = NULL;
+    DIInt runLocation = 0;
+    DIInt runNum = 0;
+    
+    for (;; index++, buf += DI_BLOCKSIZE, num--)
     {
-        if (index >= blockNum)
-            return false;
-        
-        DIInt directoryIndex = index / directoryEntrySize;
-        DIInt directoryEntry = metadata[directory1Block * DI_BLOCKSIZE / sizeof(DIInt) +
-                                        directoryIndex];
-        
-        DIInt grainTableIndex = (index % directoryEntrySize) / grainSize;
-        DIInt grainTableEntry = metadata[directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) +
-                                         grainTableIndex];
+        DIInt location = 0;
         
-        if (grainTableEntry <= 1)
+        if (num)
         {
-            if (isBlockEmpty(buf))
-                continue;
+            if (index >= blockNum)
+                return false;
             
-            grainTableEntry = allocateGrain(directoryIndex, grainTableIndex);
+            location = getBlockLocation(index);
             
-            if (!grainTableEntry)
+            // Do not allocate grains for empty blocks
+            if (!location && !isDIDataZero(buf, DI_BLOCKSIZE))
+            {
+                DIInt directoryIndex = index / directoryEntrySize;
+                DIInt grainTableIndex = (index % directoryEntrySize) / grainSize;
+                
+                DIInt grainTableEntry = allocateGrain(directoryIndex, grainTableIndex);
+                
+                if (!grainTableEntry)
+                    return false;
+                
+                location = grainTableEntry + index % grainSize;
+            }
+        }
+        
+        // Write out run when it can not be extended
+        if (runNum && (location != (runLocation + runNum)))
+        {
+            if (!backingStore->write((DILong) runLocation * DI_BLOCKSIZE,
+                                     runBuf, runNum * DI_BLOCKSIZE))
                 return false;
+            
+            runNum = 0;
+        }
+        
+        if (!num)
+            break;
+        
+        if (!location)
+            continue;
+        
+        if (!runNum)
+        {
+            runBuf = buf;
+            runLocation = location;
         }
         
-        DIInt blockIndex = grainTableEntry + index % grainSize;
+        runNum++;
+    }
+    
+    return true;
+}
+
+bool DIVMDKBlockStorage::flush()
+{
+    if (!backingStore)
+        return true;
+    
+    // Write back runs of consecutive dirty metadata blocks
+    DIInt intsPerBlock = DI_BLOCKSIZE / sizeof(DIInt);
+    
+    DIData data;
+    
+    set<DIInt>::iterator i = dirtyMetadataBlocks.begin();
+    
+    while (i != dirtyMetadataBlocks.end())
+    {
+        DIInt runStart = *i;
+        DIInt runNum = 0;
+        
+        for (; (i != dirtyMetadataBlocks.end()) && (*i == (runStart + runNum)); i++)
+            runNum++;
+        
+        data.resize(runNum * DI_BLOCKSIZE);
+        
+        for (DIInt j = 0; j < runNum * intsPerBlock; j++)
+            setDIIntLE(&data[j * sizeof(DIInt)], metadata[runStart * intsPerBlock + j]);
         
-        if (!backingStore->write(blockIndex * DI_BLOCKSIZE, buf, DI_BLOCKSIZE))
+        if (!backingStore->write((DILong) runStart * DI_BLOCKSIZE,
+                                 &data.front(), (DIInt) data.size()))
             return false;
     }
     
+    dirtyMetadataBlocks.clear();
+    
     return true;
 }
 
@@ -292,63 +366,57 @@ bool DIVMDKBlockStorage::setInUse(bool value)
     return backingStore->write(0x48, &uncleanShutdown, 1);
 }
 
-bool DIVMDKBlockStorage::isBlockEmpty(const DIChar *buf)
+DIInt DIVMDKBlockStorage::getBlockLocation(DIInt index)
 {
-    for (DIInt i = 0; i < DI_BLOCKSIZE; i++)
-        if (buf[i])
-            return false;
+    DIInt directoryIndex = index / directoryEntrySize;
+    DIInt directoryEntry = metadata[directory1Block * DI_BLOCKSIZE / sizeof(DIInt) +
+                                    directoryIndex];
     
-    return true;
+    DIInt grainTableIndex = (index % directoryEntrySize) / grainSize;
+    DIInt grainTableEntry = metadata[directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) +
+                                     grainTableIndex];
+    
+    if (grainTableEntry <= 1)
+        return 0;
+    
+    return grainTableEntry + index % grainSize;
 }
 
 DIInt DIVMDKBlockStorage::allocateGrain(DIInt directoryIndex, DIInt grainTableIndex)
 {
-    // Allocate new block
-    DILong size = backingStore->getSize();
-    
-    DIInt newGrainTableEntry = (DIInt) ((size + DI_BLOCKSIZE - 1) / DI_BLOCKSIZE);
+    // Allocate new grain by extending the file up to its last block
+    DIInt newGrainTableEntry = nextGrainBlock;
     
-    DIData dummy;
+    DIChar dummy[DI_BLOCKSIZE];
     
-    dummy.resize(grainSize * DI_BLOCKSIZE);
+    memset(dummy, 0, DI_BLOCKSIZE);
     
-    if (!backingStore->write(newGrainTableEntry * DI_BLOCKSIZE,
-                             &dummy.front(), (DIInt) dummy.size()))
+    if (!backingStore->write((DILong) (newGrainTableEntry + grainSize - 1) * DI_BLOCKSIZE,
+                             dummy, DI_BLOCKSIZE))
         return 0;
     
-    // Update grain table
-    DIInt directoryEntry = metadata[directory1Block * DI_BLOCKSIZE / sizeof(DIInt) +
-                                     directoryIndex];
+    nextGrainBlock += grainSize;
     
-    DIChar intLEValue[4];
+    // Update grain tables, these are written back on flush
+    setGrainTableEntry(directory1Block, directoryIndex,
+                       grainTableIndex, newGrainTableEntry);
     
-    setDIIntLE(intLEValue, newGrainTableEntry);
+    if (redundantDirectory)
+        setGrainTableEntry(directory2Block, directoryIndex,
+                           grainTableIndex, newGrainTableEntry);
     
-    if (!backingStore->write(directoryEntry * DI_BLOCKSIZE + grainTableIndex * sizeof(DIInt),
-                             intLEValue, sizeof(DIInt)))
-        return 0;
+    return newGrainTableEntry;
+}
+
+void DIVMDKBlockStorage::setGrainTableEntry(DIInt directoryBlock, DIInt directoryIndex,
+                                            DIInt grainTableIndex, DIInt value)
+{
+    DIInt directoryEntry = metadata[directoryBlock * DI_BLOCKSIZE / sizeof(DIInt) +
+                                    directoryIndex];
     
-    metadata[directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) +
-             grainTableIndex] = newGrainTableEntry;
+    DIInt metadataIndex = directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) + grainTableIndex;
     
-    // Update redundant grain table
-    if (redundantDirectory)
-    {
-        DIInt directoryEntry = metadata[directory2Block * DI_BLOCKSIZE / sizeof(DIInt) +
-                                        directoryIndex];
-        
-        DIChar intLEValue[4];
-        
-        setDIIntLE(intLEValue, newGrainTableEntry);
-        
-        if (!backingStore->write(directoryEntry * DI_BLOCKSIZE + grainTableIndex * sizeof(DIInt),
-                                 intLEValue, sizeof(DIInt)))
-            return 0;
-        
-        metadata[directoryEntry * DI_BLOCKSIZE / sizeof(DIInt) +
-                 grainTableIndex] = newGrainTableEntry;
-        
-    }
+    metadata[metadataIndex] = value;
     
-    return newGrainTableEntry;
+    dirtyMetadataBlocks.insert(metadataIndex * sizeof(DIInt) / DI_BLOCKSIZE);
 }
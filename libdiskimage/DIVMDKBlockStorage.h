@@ -11,6 +11,8 @@
 #ifndef DIVMDKBLOCKSTORAGE_H
 #define DIVMDKBLOCKSTORAGE_H
 
+#include <set>
+
 #include "DICommon.h"
 #include "DIBackingStore.h"
 #include "DIBlockStorage.h"
@@ -35,6 +37,8 @@ public:
     bool readBlocks(DIInt index, DIChar *buf, DIInt num);
     bool writeBlocks(DIInt index, const DIChar *buf, DIInt num);
     
+    bool flush();
+    
 private:
     DIBackingStore *backingStore;
     
@@ -50,16 +54,20 @@ private:
     DIInt directory2Block;
     bool redundantDirectory;
     DIInt allocatedBlockNum;
+    DIInt nextGrainBlock;
     
     vector<DIInt> metadata;
+    set<DIInt> dirtyMetadataBlocks;
     
     DIInt directoryEntrySize;
     
     bool parseDescriptor(DIBackingStore *backingStore,
                          DILong offset, DIInt size);
     bool setInUse(bool value);
-    bool isBlockEmpty(const DIChar *buf);
+    DIInt getBlockLocation(DIInt index);
     DIInt allocateGrain(DIInt directoryIndex, DIInt grainTableIndex);
+    void setGrainTableEntry(DIInt directoryBlock, DIInt directoryIndex,
+                            DIInt grainTableIndex, DIInt value);
 };
 
 #endif
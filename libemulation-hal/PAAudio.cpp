@@ -72,6 +72,7 @@ PAAudio::PAAudio()
     
     playerVolume = 1;
     playerPlayThrough = false;
+    playerSpeed = 1;
     playerSNDFILE = NULL;
     playerPlaying = false;
     recorderSNDFILE = NULL;
@@ -346,30 +347,44 @@ void PAAudio::runEmulations()
             memset(localOutputBuffer + samplesPerBuffer, 0, bytesPerBuffer);
         }
         
-        // Copy circular input buffer to local input buffer
-        memcpy(localInputBuffer, localInputBuffer + samplesPerBuffer, bytesPerBuffer);
-        memcpy(localInputBuffer + samplesPerBuffer, getEmulationsInputBuffer(), bytesPerBuffer);
+        // A fast player renders several buffers back to back, fed only by
+        // the player. Only the last is presented, and the output is muted
+        OEInt playerBufferNum = (playerPlaying && (playerSpeed > 1)) ? playerSpeed : 1;
         
-        // Shift local output buffer
-        memcpy(localOutputBuffer, localOutputBuffer + samplesPerBuffer, bytesPerBuffer);
-        memset(localOutputBuffer + samplesPerBuffer, 0, bytesPerBuffer);
-        
-        // Audio play
-        playAudio(localInputBuffer + samplesPerBuffer, localOutputBuffer, framesPerBuffer, channelNum);
-        
-        // Output
-        AudioBuffer audioBuffer =
+        for (OEInt i = playerBufferNum; i > 0; i--)
         {
-            sampleRate,
-            channelNum,
-            framesPerBuffer,
-            localInputBuffer,
-            localOutputBuffer,
-        };
+            // Copy circular input buffer to local input buffer
+            memcpy(localInputBuffer, localInputBuffer + samplesPerBuffer, bytesPerBuffer);
+            if (playerBufferNum > 1)
+                memset(localInputBuffer + samplesPerBuffer, 0, bytesPerBuffer);
+            else
+                memcpy(localInputBuffer + samplesPerBuffer, getEmulationsInputBuffer(), bytesPerBuffer);
+            
+            // Shift local output buffer
+            memcpy(localOutputBuffer, localOutputBuffer + samplesPerBuffer, bytesPerBuffer);
+            memset(localOutputBuffer + samplesPerBuffer, 0, bytesPerBuffer);
+            
+            // Audio play
+            playAudio(localInputBuffer + samplesPerBuffer, localOutputBuffer, framesPerBuffer, channelNum);
+            
+            // Output
+            AudioBuffer audioBuffer =
+            {
+                sampleRate,
+                channelNum,
+                framesPerBuffer,
+                localInputBuffer,
+                localOutputBuffer,
+                (i > 1),
+            };
+            
+            postNotification(this, AUDIO_BUFFER_WILL_RENDER, &audioBuffer);
+            postNotification(this, AUDIO_BUFFER_IS_RENDERING, &audioBuffer);
+            postNotification(this, AUDIO_BUFFER_DID_RENDER, &audioBuffer);
+        }
         
-        postNotification(this, AUDIO_BUFFER_WILL_RENDER, &audioBuffer);
-        postNotification(this, AUDIO_BUFFER_IS_RENDERING, &audioBuffer);
-        postNotification(this, AUDIO_BUFFER_DID_RENDER, &audioBuffer);
+        if (playerBufferNum > 1)
+            memset(localOutputBuffer, 0, bytesPerBuffer);
         
         // Audio recording
         recordAudio(localOutputBuffer, framesPerBuffer, channelNum);
@@ -659,6 +674,12 @@ void PAAudio::setPlayerPlayThrough(bool value)
     playerPlayThrough = value;
 }
 
+// While playing, value buffers are emulated for each audio buffer
+void PAAudio::setPlayerSpeed(OEInt value)
+{
+    playerSpeed = value ? value : 1;
+}
+
 void PAAudio::setPlayerPosition(float value)
 {
     if (!playerSNDFILE)
@@ -48,6 +48,7 @@ public:
     void closePlayer();
     void setPlayerVolume(float value);
     void setPlayerPlayThrough(bool value);
+    void setPlayerSpeed(OEInt value);
     void setPlayerPosition(float value);
     float getPlayerPosition();
     float getPlayerTime();
@@ -87,6 +88,7 @@ private:
     
     float playerVolume;
     bool playerPlayThrough;
+    OEInt playerSpeed;
     bool playerPlaying;
     SNDFILE *playerSNDFILE;
     OEInt playerChannelNum;
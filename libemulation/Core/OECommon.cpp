@@ -118,6 +118,26 @@ OEData getCharVector(const string& value)
     
     return result;
 }
+
+// 64-bit FNV-1a
+OELong getOEHash(const OEData& data)
+{
+    return getOEHash(data.size() ? &data.front() : NULL, data.size());
+}
+
+OELong getOEHash(const OEChar *data, size_t size)
+{
+    OELong hash = 0xcbf29ce484222325ULL;
+    
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    
+    return hash;
+}
+
 string getString(OEInt value)
 {
     stringstream ss;
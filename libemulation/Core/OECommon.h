@@ -72,6 +72,8 @@ OESLong getOESLong(const string& value);
 float getFloat(const string& value);
 double getDouble(const string& value);
 OEData getCharVector(const string& value);
+OELong getOEHash(const OEData& data);
+OELong getOEHash(const OEChar *data, size_t size);
 
 string getString(OEInt value);
 string getString(OESInt value);
@@ -37,6 +37,18 @@ bool OEComponent::setData(string name, OEData *data)
     return false;
 }
 
+// Components that can work on a memory-mapped view override this,
+// otherwise the view is materialized
+bool OEComponent::setMappedData(string name, OEMappedData *data)
+{
+    OEData theData;
+    
+    if (!data->read(&theData))
+        return false;
+    
+    return setData(name, &theData);
+}
+
 bool OEComponent::getData(string name, OEData **data)
 {
     return false;
@@ -92,6 +104,17 @@ void OEComponent::notify(OEComponent *sender, int notification, void *data)
 {
 }
 
+// Components without run-time state store nothing
+bool OEComponent::serialize(OESnapshot *snapshot)
+{
+    return true;
+}
+
+bool OEComponent::deserialize(OESnapshot *snapshot)
+{
+    return true;
+}
+
 OEChar OEComponent::read(OEAddress address)
 {
     return 0;
@@ -127,3 +150,17 @@ OELong OEComponent::read64(OEAddress address)
 void OEComponent::write64(OEAddress address, OELong value)
 {
 }
+
+// Block transfers access memory byte by byte, which keeps the side effects
+// of I/O components. Plain memory and address decoders copy whole runs
+void OEComponent::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    for (OEAddress i = 0; i < size; i++)
+        data[i] = read(address + i);
+}
+
+void OEComponent::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    for (OEAddress i = 0; i < size; i++)
+        write(address + i, data[i]);
+}
@@ -12,6 +12,8 @@
 #define _OECOMPONENT_H
 
 #include "OECommon.h"
+#include "OEMappedData.h"
+#include "OESnapshot.h"
 
 #define OECheckComponent(c) if (!c) { logMessage(#c " not defined"); return false; }
 
@@ -30,6 +32,7 @@ public:
     virtual bool getValue(string name, string& value);
     virtual bool setRef(string name, OEComponent *ref);
     virtual bool setData(string name, OEData *data);
+    virtual bool setMappedData(string name, OEMappedData *data);
     virtual bool getData(string name, OEData **data);
     virtual bool init();
     virtual void update();
@@ -44,6 +47,10 @@ public:
     virtual void postNotification(OEComponent *sender, int notification, void *data);
     virtual void notify(OEComponent *sender, int notification, void *data);
     
+    // State
+    virtual bool serialize(OESnapshot *snapshot);
+    virtual bool deserialize(OESnapshot *snapshot);
+    
     // Memory access
     virtual OEChar read(OEAddress address);
     virtual void write(OEAddress address, OEChar value);
@@ -53,6 +60,8 @@ public:
     virtual void write32(OEAddress address, OEInt value);
     virtual OELong read64(OEAddress address);
     virtual void write64(OEAddress address, OELong value);
+    virtual void readBlock(OEAddress address, OEChar *data, OEAddress size);
+    virtual void writeBlock(OEAddress address, const OEChar *data, OEAddress size);
     
 protected:
     OEObservers observers;
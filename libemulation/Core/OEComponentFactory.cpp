@@ -8,6 +8,8 @@
  * Builds components
  */
 
+#include <sys/time.h>
+
 #include "OEComponentFactory.h"
 
 // FACTORY_INCLUDE_START - Do not modify this section
@@ -28,6 +30,7 @@
 #include "RAM.h"
 #include "ROM.h"
 #include "VRAM.h"
+#include "WarpPolicy.h"
 
 #include "Apple1ACI.h"
 #include "Apple1IO.h"
@@ -79,79 +82,182 @@
 #include "W65C02S.h"
 // FACTORY_INCLUDE_END - Do not modify this section
 
-#define matchComponent(name) if (className == #name) return new name()
+#define registerComponent(name) {#name, newComponent<name>, 0, 0}
 
-OEComponent *OEComponentFactory::construct(const string& className)
+typedef OEComponent *(*OEComponentConstructor)();
+
+typedef struct
+{
+    const char *className;
+    OEComponentConstructor constructor;
+    OEInt count;
+    OELong time;
+} OEComponentClass;
+
+template<class T>
+static OEComponent *newComponent()
+{
+    return new T();
+}
+
+static OEComponentClass componentClasses[] =
 {
     // FACTORY_CODE_START - Do not modify this section
-    matchComponent(AddressDecoder);
-    matchComponent(AddressMapper);
-    matchComponent(AddressMasker);
-    matchComponent(AddressMux);
-    matchComponent(AddressOffset);
-    matchComponent(ATAController);
-    matchComponent(ATADevice);
-    matchComponent(AudioCodec);
-    matchComponent(AudioPlayer);
-    matchComponent(ControlBus);
-    matchComponent(FloatingBus);
-    matchComponent(JoystickMapper);
-    matchComponent(Monitor);
-    matchComponent(Proxy);
-    matchComponent(RAM);
-    matchComponent(ROM);
-    matchComponent(VRAM);
-    
-    matchComponent(Apple1ACI);
-    matchComponent(Apple1IO);
-    matchComponent(Apple1Terminal);
-    
-    matchComponent(AppleDiskDrive525);
-    matchComponent(AppleDiskIIInterfaceCard);
-    matchComponent(AppleGraphicsTablet);
-    matchComponent(AppleGraphicsTabletInterfaceCard);
-    matchComponent(AppleLanguageCard);
-    matchComponent(AppleSilentype);
-    matchComponent(AppleSilentypeInterfaceCard);
-    
-    matchComponent(AppleIIAddressDecoder);
-    matchComponent(AppleIIAudioIn);
-    matchComponent(AppleIIAudioOut);
-    matchComponent(AppleIIDisableC800);
-    matchComponent(AppleIIFloatingBus);
-    matchComponent(AppleIIGamePort);
-    matchComponent(AppleIIKeyboard);
-    matchComponent(AppleIISlotController);
-    matchComponent(AppleIIVideo);
-    matchComponent(AppleIISystemControl);
-    
-    matchComponent(AppleIIIAddressDecoder);
-    matchComponent(AppleIIIBeeper);
-    matchComponent(AppleIIIDiskIO);
-    matchComponent(AppleIIIGamePort);
-    matchComponent(AppleIIIKeyboard);
-    matchComponent(AppleIIIMOS6502);
-    matchComponent(AppleIIIRTC);
-    matchComponent(AppleIIISystemControl);
-//    matchComponent(AppleIIIVideo);
-    
-    matchComponent(MOS6502);
-    matchComponent(MOS6522);
-    matchComponent(MOS6530);
-    matchComponent(MOS6551);
-    matchComponent(MOSKIM1IO);
-    matchComponent(MOSKIM1PLL);
-    
-    matchComponent(MC6821);
-    
-    matchComponent(MM58167);
-    
-    matchComponent(RDCFFA);
-    
-    matchComponent(VidexVideoterm);
-    
-    matchComponent(W65C02S);
+    registerComponent(AddressDecoder),
+    registerComponent(AddressMapper),
+    registerComponent(AddressMasker),
+    registerComponent(AddressMux),
+    registerComponent(AddressOffset),
+    registerComponent(ATAController),
+    registerComponent(ATADevice),
+    registerComponent(AudioCodec),
+    registerComponent(AudioPlayer),
+    registerComponent(ControlBus),
+    registerComponent(FloatingBus),
+    registerComponent(JoystickMapper),
+    registerComponent(Monitor),
+    registerComponent(Proxy),
+    registerComponent(RAM),
+    registerComponent(ROM),
+    registerComponent(VRAM),
+    registerComponent(WarpPolicy),
+    
+    registerComponent(Apple1ACI),
+    registerComponent(Apple1IO),
+    registerComponent(Apple1Terminal),
+    
+    registerComponent(AppleDiskDrive525),
+    registerComponent(AppleDiskIIInterfaceCard),
+    registerComponent(AppleGraphicsTablet),
+    registerComponent(AppleGraphicsTabletInterfaceCard),
+    registerComponent(AppleLanguageCard),
+    registerComponent(AppleSilentype),
+    registerComponent(AppleSilentypeInterfaceCard),
+    
+    registerComponent(AppleIIAddressDecoder),
+    registerComponent(AppleIIAudioIn),
+    registerComponent(AppleIIAudioOut),
+    registerComponent(AppleIIDisableC800),
+    registerComponent(AppleIIFloatingBus),
+    registerComponent(AppleIIGamePort),
+    registerComponent(AppleIIKeyboard),
+    registerComponent(AppleIISlotController),
+    registerComponent(AppleIIVideo),
+    registerComponent(AppleIISystemControl),
+    
+    registerComponent(AppleIIIAddressDecoder),
+    registerComponent(AppleIIIBeeper),
+    registerComponent(AppleIIIDiskIO),
+    registerComponent(AppleIIIGamePort),
+    registerComponent(AppleIIIKeyboard),
+    registerComponent(AppleIIIMOS6502),
+    registerComponent(AppleIIIRTC),
+    registerComponent(AppleIIISystemControl),
+//    registerComponent(AppleIIIVideo),
+    
+    registerComponent(MOS6502),
+    registerComponent(MOS6522),
+    registerComponent(MOS6530),
+    registerComponent(MOS6551),
+    registerComponent(MOSKIM1IO),
+    registerComponent(MOSKIM1PLL),
+    
+    registerComponent(MC6821),
+    
+    registerComponent(MM58167),
+    
+    registerComponent(RDCFFA),
+    
+    registerComponent(VidexVideoterm),
+    
+    registerComponent(W65C02S),
     // FACTORY_CODE_END - Do not modify this section
+};
+
+#define COMPONENTCLASS_NUM (sizeof(componentClasses) / sizeof(OEComponentClass))
+
+static bool compareComponentClasses(const OEComponentClass& a, const OEComponentClass& b)
+{
+    return (strcmp(a.className, b.className) < 0);
+}
+
+// The class table is sorted once at load time, so lookups are binary searches
+static bool sortComponentClasses()
+{
+    sort(componentClasses, componentClasses + COMPONENTCLASS_NUM, compareComponentClasses);
+    
+    return true;
+}
+
+static bool componentClassesSorted = sortComponentClasses();
+
+static OELong getMicroseconds()
+{
+    timeval time;
+    
+    gettimeofday(&time, NULL);
+    
+    return (OELong) time.tv_sec * 1000000 + time.tv_usec;
+}
+
+OEComponent *OEComponentFactory::construct(const string& className)
+{
+    OEComponentClass key = {className.c_str(), NULL, 0, 0};
+    
+    OEComponentClass *componentClass = lower_bound(componentClasses,
+                                                   componentClasses + COMPONENTCLASS_NUM,
+                                                   key, compareComponentClasses);
+    
+    if ((componentClass == componentClasses + COMPONENTCLASS_NUM) ||
+        (className != componentClass->className))
+        return NULL;
+    
+    OELong startTime = getMicroseconds();
+    
+    OEComponent *component = componentClass->constructor();
+    
+    componentClass->count++;
+    componentClass->time += getMicroseconds() - startTime;
+    
+    return component;
+}
+
+OEComponentStatisticsMap OEComponentFactory::getStatistics()
+{
+    OEComponentStatisticsMap statisticsMap;
+    
+    for (OEInt i = 0; i < COMPONENTCLASS_NUM; i++)
+    {
+        if (!componentClasses[i].count)
+            continue;
+        
+        OEComponentStatistics statistics;
+        
+        statistics.count = componentClasses[i].count;
+        statistics.time = componentClasses[i].time;
+        
+        statisticsMap[componentClasses[i].className] = statistics;
+    }
+    
+    return statisticsMap;
+}
+
+void OEComponentFactory::resetStatistics()
+{
+    for (OEInt i = 0; i < COMPONENTCLASS_NUM; i++)
+    {
+        componentClasses[i].count = 0;
+        componentClasses[i].time = 0;
+    }
+}
+
+void OEComponentFactory::logStatistics()
+{
+    OEComponentStatisticsMap statisticsMap = getStatistics();
     
-    return NULL;
+    for (OEComponentStatisticsMap::iterator i = statisticsMap.begin();
+         i != statisticsMap.end();
+         i++)
+        logMessage(i->first + ": " + getString(i->second.count) +
+                   " constructed in " + getString(i->second.time) + " us");
 }
@@ -13,10 +13,22 @@
 
 #include "OEComponent.h"
 
+typedef struct
+{
+    OEInt count;
+    OELong time;
+} OEComponentStatistics;
+
+typedef map<string, OEComponentStatistics> OEComponentStatisticsMap;
+
 class OEComponentFactory
 {
 public:
     static OEComponent *construct(const string& className);
+    
+    static OEComponentStatisticsMap getStatistics();
+    static void resetStatistics();
+    static void logStatistics();
 };
 
 #endif
@@ -17,6 +17,8 @@
 OEDevice::OEDevice(OEEmulation *emulation)
 {
     this->emulation = emulation;
+    
+    progress = -1;
 }
 
 bool OEDevice::postMessage(OEComponent *sender, int message, void *data)
@@ -68,6 +70,18 @@ bool OEDevice::postMessage(OEComponent *sender, int message, void *data)
         case DEVICE_GET_STATELABEL:
             if (data)
                 *((string *)data) = stateLabel;
+                
+            return true;
+            
+        case DEVICE_SET_PROGRESS:
+            if (data)
+                progress = *((float *)data);
+                
+            return true;
+            
+        case DEVICE_GET_PROGRESS:
+            if (data)
+                *((float *)data) = progress;
             
             return true;
             
@@ -151,6 +165,12 @@ bool OEDevice::postMessage(OEComponent *sender, int message, void *data)
             
         case DEVICE_UPDATE:
             return emulation->postMessage(sender, EMULATION_UPDATE, data);
+            
+        case DEVICE_FILTER_INPUT:
+            return emulation->postMessage(sender, EMULATION_FILTER_INPUT, data);
+            
+        case DEVICE_GET_RANDOM:
+            return emulation->postMessage(sender, EMULATION_GET_RANDOM, data);
     }
     
     return false;
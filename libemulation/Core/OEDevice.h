@@ -31,6 +31,7 @@ private:
     string imagePath;
     string locationLabel;
     string stateLabel;
+    float progress;
     
     DeviceSettings settings;
     
@@ -10,6 +10,9 @@
 
 #include "OEDocument.h"
 
+#define OE_COMPILED_SIGNATURE   "EDLC"
+#define OE_COMPILED_VERSION     1
+
 string OESetDeviceId(string id, string deviceId)
 {
     size_t dotIndex = id.find_first_of('.');
@@ -30,6 +33,51 @@ string OEGetDeviceId(string id)
     return id.substr(0, dotIndex);
 }
 
+static bool getCompiledInt(OEData& data, size_t& offset, OEInt& value)
+{
+    if ((offset + 4) > data.size())
+        return false;
+    
+    value = ((OEInt) data[offset + 0] |
+             ((OEInt) data[offset + 1] << 8) |
+             ((OEInt) data[offset + 2] << 16) |
+             ((OEInt) data[offset + 3] << 24));
+    
+    offset += 4;
+    
+    return true;
+}
+
+static bool getCompiledString(OEData& data, size_t& offset, string& value)
+{
+    OEInt size;
+    
+    if (!getCompiledInt(data, offset, size) ||
+        ((offset + size) > data.size()))
+        return false;
+    
+    value.assign((char *) &data.front() + offset, size);
+    
+    offset += size;
+    
+    return true;
+}
+
+static void setCompiledInt(OEData& data, OEInt value)
+{
+    data.push_back(value & 0xff);
+    data.push_back((value >> 8) & 0xff);
+    data.push_back((value >> 16) & 0xff);
+    data.push_back((value >> 24) & 0xff);
+}
+
+static void setCompiledString(OEData& data, const string& value)
+{
+    setCompiledInt(data, (OEInt) value.size());
+    
+    data.insert(data.end(), value.begin(), value.end());
+}
+
 OEDocument::OEDocument()
 {
     is_open = false;
@@ -46,6 +94,11 @@ OEDocument::~OEDocument()
         xmlFreeDoc(doc);
 }
 
+void OEDocument::setCachePath(string path)
+{
+    cachePath = path;
+}
+
 bool OEDocument::open(string path)
 {
     close();
@@ -76,15 +129,22 @@ bool OEDocument::open(string path)
     else
         logMessage("could not identify type of '" + path + "'");
     
+    // A compiled document defers parsing the EDL until it is needed
+    OEComponentInfos componentInfos;
+    string compiledPath;
+    bool isCompiled = false;
+    OELong documentHash = 0;
+    
     if (is_open)
     {
-        doc = xmlReadMemory((char *) &data.front(),
-                            (int) data.size(),
-                            OE_PACKAGE_EDL_PATH,
-                            NULL,
-                            0);
+        documentHash = getOEHash(data);
+        compiledPath = getCompiledPath(data);
+        
+        isCompiled = readCompiledDocument(compiledPath, componentInfos);
         
-        if (!doc)
+        if (isCompiled)
+            docData.swap(data);
+        else if (!parseDocument(data))
         {
             is_open = false;
             logMessage("could not parse document '" + path + "'");
@@ -109,14 +169,26 @@ bool OEDocument::open(string path)
      xmlFreeValidCtxt(validCtxt);
      }*/
     
-    if (is_open && !validateDocument())
+    if (is_open && !isCompiled)
     {
-        is_open = false;
-        logMessage("invalid EDL version");
+        if (validateDocument())
+        {
+            compileDocument(doc, componentInfos);
+            
+            writeCompiledDocument(compiledPath, componentInfos);
+        }
+        else
+        {
+            is_open = false;
+            logMessage("invalid EDL version");
+        }
     }
     
     if (is_open)
-        is_open = constructDocument(doc);
+        is_open = constructDocument(componentInfos);
+    
+    if (is_open)
+        restoreState(documentHash);
     
     if (!is_open)
         close();
@@ -137,7 +209,7 @@ bool OEDocument::save(string path)
     string pathExtension = strtolower(getPathExtension(path));
     if (pathExtension == OE_FILE_PATH_EXTENSION)
     {
-        if (reconfigureDocument(doc))
+        if (reconfigureDocument(getXMLDoc()))
         {
             if (dumpDocument(data))
             {
@@ -157,11 +229,13 @@ bool OEDocument::save(string path)
         package = new OEPackage();
         if (package && package->open(path))
         {
-            if (reconfigureDocument(doc))
+            if (reconfigureDocument(getXMLDoc()))
             {
                 if (dumpDocument(data))
                 {
-                    is_open = package->write(OE_PACKAGE_EDL_PATH, &data);
+                    is_open = (package->write(OE_PACKAGE_EDL_PATH, &data) &&
+                               saveState(getOEHash(data)) &&
+                               package->flush());
                     if (!is_open)
                         logMessage("could not write '" OE_PACKAGE_EDL_PATH
                                    "' in '" + path + "'");
@@ -187,6 +261,17 @@ bool OEDocument::save(string path)
     return is_open;
 }
 
+// Emulation state is stored in packages only, and is bound to the
+// document it was saved with
+bool OEDocument::saveState(OELong documentHash)
+{
+    return true;
+}
+
+void OEDocument::restoreState(OELong documentHash)
+{
+}
+
 void OEDocument::close()
 {
     is_open = false;
@@ -201,7 +286,7 @@ OEHeaderInfo OEDocument::getHeaderInfo()
 {
     OEHeaderInfo headerInfo;
     
-    if (doc)
+    if (getXMLDoc())
     {
         xmlNodePtr rootNode = xmlDocGetRootElement(doc);
         
@@ -217,7 +302,7 @@ OEPortInfos OEDocument::getPortInfos()
 {
     OEPortInfos portsInfo;
     
-    if (doc)
+    if (getXMLDoc())
     {
         xmlNodePtr rootNode = xmlDocGetRootElement(doc);
         
@@ -248,7 +333,7 @@ OEConnectorInfos OEDocument::getFreeConnectorInfos()
     OEIds portRefs;
     OEConnectorInfos freeConnectorInfos;
     
-    if (doc)
+    if (getXMLDoc())
     {
         xmlNodePtr rootNode = xmlDocGetRootElement(doc);
         
@@ -293,11 +378,11 @@ OEConnectorInfos OEDocument::getFreeConnectorInfos()
 
 bool OEDocument::addDocument(string path, OEIdMap connections)
 {
-    if (!doc)
+    if (!getXMLDoc())
         return false;
     
     OEDocument document;
-    if (!document.open(path))
+    if (!document.open(path) || !document.getXMLDoc())
         return false;
     
     // Remap ids
@@ -333,7 +418,10 @@ bool OEDocument::addDocument(string path, OEIdMap connections)
     }
     
     // Construct new document
-    if (!constructDocument(document.getXMLDoc()))
+    OEComponentInfos componentInfos;
+    compileDocument(document.getXMLDoc(), componentInfos);
+    
+    if (!constructDocument(componentInfos))
         return false;
     
     // Configure port inlets
@@ -345,7 +433,7 @@ bool OEDocument::addDocument(string path, OEIdMap connections)
 
 bool OEDocument::removeDevice(string deviceId)
 {
-    if (!doc)
+    if (!getXMLDoc())
         return false;
     
     // Get document ports
@@ -421,7 +509,7 @@ OEIds OEDocument::getDeviceIds()
 {
     OEIds deviceIds;
     
-    if (doc)
+    if (getXMLDoc())
     {
         xmlNodePtr rootNode = xmlDocGetRootElement(doc);
         
@@ -441,6 +529,17 @@ OEIds OEDocument::getDeviceIds()
     return deviceIds;
 }
 
+bool OEDocument::parseDocument(OEData& data)
+{
+    doc = xmlReadMemory((char *) &data.front(),
+                        (int) data.size(),
+                        OE_PACKAGE_EDL_PATH,
+                        NULL,
+                        0);
+    
+    return (doc != NULL);
+}
+
 bool OEDocument::validateDocument()
 {
     xmlNodePtr rootNode = xmlDocGetRootElement(doc);
@@ -470,7 +569,7 @@ bool OEDocument::dumpDocument(OEData& data)
     return false;
 }
 
-bool OEDocument::constructDocument(xmlDocPtr doc)
+bool OEDocument::constructDocument(OEComponentInfos& componentInfos)
 {
     return true;
 }
@@ -499,9 +598,263 @@ void OEDocument::destroyDevice(string deviceIds)
 
 xmlDocPtr OEDocument::getXMLDoc()
 {
+    // Parse the EDL of a compiled document on first use
+    if (!doc && docData.size())
+    {
+        if (!parseDocument(docData))
+            logMessage("could not parse document");
+        
+        docData.clear();
+    }
+    
     return doc;
 }
 
+string OEDocument::getCachePath()
+{
+    return cachePath;
+}
+
+// Compile the devices and components of a document, in document order
+void OEDocument::compileDocument(xmlDocPtr doc, OEComponentInfos& componentInfos)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        OEComponentInfo componentInfo;
+        
+        if (getNodeName(node) == "device")
+        {
+            componentInfo.isDevice = true;
+            componentInfo.id = getNodeProperty(node, "id");
+            componentInfo.label = getNodeProperty(node, "label");
+            componentInfo.image = getNodeProperty(node, "image");
+            componentInfo.locationLabel = getLocationLabel(componentInfo.id);
+            
+            for(xmlNodePtr settingNode = node->children;
+                settingNode;
+                settingNode = settingNode->next)
+            {
+                if (getNodeName(settingNode) == "setting")
+                {
+                    OESettingInfo settingInfo;
+                    
+                    settingInfo.ref = getNodeProperty(settingNode, "ref");
+                    settingInfo.name = getNodeProperty(settingNode, "name");
+                    settingInfo.type = getNodeProperty(settingNode, "type");
+                    settingInfo.options = getNodeProperty(settingNode, "options");
+                    settingInfo.label = getNodeProperty(settingNode, "label");
+                    
+                    componentInfo.settingInfos.push_back(settingInfo);
+                }
+            }
+        }
+        else if (getNodeName(node) == "component")
+        {
+            componentInfo.isDevice = false;
+            componentInfo.id = getNodeProperty(node, "id");
+            componentInfo.className = getNodeProperty(node, "class");
+            
+            for(xmlNodePtr propertyNode = node->children;
+                propertyNode;
+                propertyNode = propertyNode->next)
+            {
+                if (getNodeName(propertyNode) == "property")
+                {
+                    OEPropertyInfo propertyInfo;
+                    
+                    propertyInfo.name = getNodeProperty(propertyNode, "name");
+                    
+                    if (hasNodeProperty(propertyNode, "value"))
+                    {
+                        propertyInfo.type = OEPROPERTY_VALUE;
+                        propertyInfo.value = getNodeProperty(propertyNode, "value");
+                    }
+                    else if (hasNodeProperty(propertyNode, "ref"))
+                    {
+                        propertyInfo.type = OEPROPERTY_REF;
+                        propertyInfo.value = getNodeProperty(propertyNode, "ref");
+                    }
+                    else if (hasNodeProperty(propertyNode, "data"))
+                    {
+                        propertyInfo.type = OEPROPERTY_DATA;
+                        propertyInfo.value = getNodeProperty(propertyNode, "data");
+                    }
+                    else
+                        propertyInfo.type = OEPROPERTY_UNKNOWN;
+                    
+                    componentInfo.propertyInfos.push_back(propertyInfo);
+                }
+            }
+        }
+        else
+            continue;
+        
+        componentInfos.push_back(componentInfo);
+    }
+}
+
+// Compiled documents are cached by a hash of the EDL
+string OEDocument::getCompiledPath(OEData& data)
+{
+    if (cachePath == "")
+        return "";
+    
+    string hashString = getHexString(getOEHash(data)).substr(2);
+    
+    return (cachePath + "/" + hashString + "." OE_COMPILED_PATH_EXTENSION);
+}
+
+bool OEDocument::readCompiledDocument(string path, OEComponentInfos& componentInfos)
+{
+    if (path == "")
+        return false;
+    
+    OEData data;
+    
+    if (!readFile(path, &data))
+        return false;
+    
+    size_t offset = sizeof(OE_COMPILED_SIGNATURE) - 1;
+    
+    if ((data.size() < offset) ||
+        memcmp(&data.front(), OE_COMPILED_SIGNATURE, offset))
+        return false;
+    
+    OEInt version;
+    OEInt componentNum;
+    
+    if (!getCompiledInt(data, offset, version) ||
+        (version != OE_COMPILED_VERSION) ||
+        !getCompiledInt(data, offset, componentNum))
+        return false;
+    
+    componentInfos.resize(componentNum);
+    
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        OEInt isDevice;
+        OEInt num;
+        
+        if (!getCompiledInt(data, offset, isDevice) ||
+            !getCompiledString(data, offset, i->id))
+            return false;
+        
+        i->isDevice = isDevice;
+        
+        if (i->isDevice)
+        {
+            if (!getCompiledString(data, offset, i->label) ||
+                !getCompiledString(data, offset, i->image) ||
+                !getCompiledString(data, offset, i->locationLabel) ||
+                !getCompiledInt(data, offset, num))
+                return false;
+            
+            i->settingInfos.resize(num);
+            
+            for (OESettingInfos::iterator j = i->settingInfos.begin();
+                 j != i->settingInfos.end();
+                 j++)
+            {
+                if (!getCompiledString(data, offset, j->ref) ||
+                    !getCompiledString(data, offset, j->name) ||
+                    !getCompiledString(data, offset, j->type) ||
+                    !getCompiledString(data, offset, j->options) ||
+                    !getCompiledString(data, offset, j->label))
+                    return false;
+            }
+        }
+        else
+        {
+            if (!getCompiledString(data, offset, i->className) ||
+                !getCompiledInt(data, offset, num))
+                return false;
+            
+            i->propertyInfos.resize(num);
+            
+            for (OEPropertyInfos::iterator j = i->propertyInfos.begin();
+                 j != i->propertyInfos.end();
+                 j++)
+            {
+                OEInt type;
+                
+                if (!getCompiledInt(data, offset, type) ||
+                    (type > OEPROPERTY_UNKNOWN) ||
+                    !getCompiledString(data, offset, j->name) ||
+                    !getCompiledString(data, offset, j->value))
+                    return false;
+                
+                j->type = (OEPropertyType) type;
+            }
+        }
+    }
+    
+    return (offset == data.size());
+}
+
+bool OEDocument::writeCompiledDocument(string path, OEComponentInfos& componentInfos)
+{
+    if (path == "")
+        return false;
+    
+    if (!isPathValid(cachePath) && !createDirectory(cachePath))
+        return false;
+    
+    OEData data(OE_COMPILED_SIGNATURE,
+                OE_COMPILED_SIGNATURE + sizeof(OE_COMPILED_SIGNATURE) - 1);
+    
+    setCompiledInt(data, OE_COMPILED_VERSION);
+    setCompiledInt(data, (OEInt) componentInfos.size());
+    
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        setCompiledInt(data, i->isDevice);
+        setCompiledString(data, i->id);
+        
+        if (i->isDevice)
+        {
+            setCompiledString(data, i->label);
+            setCompiledString(data, i->image);
+            setCompiledString(data, i->locationLabel);
+            setCompiledInt(data, (OEInt) i->settingInfos.size());
+            
+            for (OESettingInfos::iterator j = i->settingInfos.begin();
+                 j != i->settingInfos.end();
+                 j++)
+            {
+                setCompiledString(data, j->ref);
+                setCompiledString(data, j->name);
+                setCompiledString(data, j->type);
+                setCompiledString(data, j->options);
+                setCompiledString(data, j->label);
+            }
+        }
+        else
+        {
+            setCompiledString(data, i->className);
+            setCompiledInt(data, (OEInt) i->propertyInfos.size());
+            
+            for (OEPropertyInfos::iterator j = i->propertyInfos.begin();
+                 j != i->propertyInfos.end();
+                 j++)
+            {
+                setCompiledInt(data, j->type);
+                setCompiledString(data, j->name);
+                setCompiledString(data, j->value);
+            }
+        }
+    }
+    
+    return writeFile(path, &data);
+}
+
 // Make an id map so a new document, when inserted in the
 // current document, has unique names
 OEIdMap OEDocument::makeIdMap(OEIds& deviceIds)
@@ -904,7 +1257,7 @@ void OEDocument::deleteDevice(string deviceId)
 
 string OEDocument::getLocationLabel(string deviceId, vector<string>& visitedIds)
 {
-    if (!doc)
+    if (!getXMLDoc())
         return "";
     
     // Avoid circularity
@@ -955,7 +1308,7 @@ string OEDocument::getLocationLabel(string deviceId, vector<string>& visitedIds)
 
 string OEDocument::getLocationLabel(string id)
 {
-    if (!doc)
+    if (!getXMLDoc())
         return "";
     
     vector<string> visitedIds;
@@ -19,6 +19,7 @@
 #define OE_FILE_PATH_EXTENSION "xml"
 #define OE_PACKAGE_PATH_EXTENSION "emulation"
 #define OE_PACKAGE_EDL_PATH "info.xml"
+#define OE_COMPILED_PATH_EXTENSION "edlc"
 
 typedef struct
 {
@@ -43,8 +44,48 @@ typedef struct
     string type;
 } OEConnectorInfo;
 
+typedef enum
+{
+    OEPROPERTY_VALUE,
+    OEPROPERTY_REF,
+    OEPROPERTY_DATA,
+    OEPROPERTY_UNKNOWN,
+} OEPropertyType;
+
+typedef struct
+{
+    OEPropertyType type;
+    string name;
+    string value;
+} OEPropertyInfo;
+
+typedef struct
+{
+    string ref;
+    string name;
+    string type;
+    string options;
+    string label;
+} OESettingInfo;
+
+typedef vector<OEPropertyInfo> OEPropertyInfos;
+typedef vector<OESettingInfo> OESettingInfos;
+
+typedef struct
+{
+    bool isDevice;
+    string id;
+    string className;
+    string label;
+    string image;
+    string locationLabel;
+    OESettingInfos settingInfos;
+    OEPropertyInfos propertyInfos;
+} OEComponentInfo;
+
 typedef vector<OEPortInfo> OEPortInfos;
 typedef vector<OEConnectorInfo> OEConnectorInfos;
+typedef vector<OEComponentInfo> OEComponentInfos;
 
 typedef vector<string> OEIds;
 typedef map<string, string> OEIdMap;
@@ -59,6 +100,8 @@ public:
     OEDocument();
     ~OEDocument();
     
+    void setCachePath(string path);
+    
     bool open(string path);
     bool isOpen();
     bool save(string path);
@@ -78,9 +121,14 @@ protected:
     OEPackage *package;
     xmlDocPtr doc;
     
-    virtual bool constructDocument(xmlDocPtr doc);
+    xmlDocPtr getXMLDoc();
+    string getCachePath();
+    
+    virtual bool constructDocument(OEComponentInfos& componentInfos);
     virtual bool configureInlets(OEInletMap& inletMap);
     virtual bool reconfigureDocument(xmlDocPtr doc);
+    virtual bool saveState(OELong documentHash);
+    virtual void restoreState(OELong documentHash);
     virtual void disposeDevice(string deviceId);
     virtual void deconfigureDevice(string deviceId);
     virtual void destroyDevice(string deviceId);
@@ -94,10 +142,18 @@ protected:
     void setNodeProperty(xmlNodePtr node, string name, string value);
     
 private:
+    string cachePath;
+    OEData docData;
+    
+    bool parseDocument(OEData& data);
     bool validateDocument();
     bool dumpDocument(OEData& data);
     
-    xmlDocPtr getXMLDoc();
+    void compileDocument(xmlDocPtr doc, OEComponentInfos& componentInfos);
+    string getCompiledPath(OEData& data);
+    bool readCompiledDocument(string path, OEComponentInfos& componentInfos);
+    bool writeCompiledDocument(string path, OEComponentInfos& componentInfos);
+    
     OEIdMap makeIdMap(OEIds& deviceIds);
     void remapNodeProperty(OEIdMap& deviceIdMap, xmlNodePtr node, string property);
     void remapDocument(OEIdMap& deviceIdMap);
@@ -8,9 +8,13 @@
  * Controls an emulation
  */
 
+#include <stdio.h>
 #include <fstream>
 #include <sstream>
 #include <set>
+#include <algorithm>
+
+#include <sys/stat.h>
 
 #include <libxml/parser.h>
 
@@ -18,9 +22,15 @@
 #include "OEDevice.h"
 
 #include "OEComponentFactory.h"
+#include "OESound.h"
+#include "OEImage.h"
 
 #include "EmulationInterface.h"
 #include "CanvasInterface.h"
+#include "ControlBusInterface.h"
+#include "CPUInterface.h"
+#include "DeviceInterface.h"
+#include "StorageInterface.h"
 
 OEEmulation::OEEmulation() : OEDocument()
 {
@@ -29,6 +39,34 @@ OEEmulation::OEEmulation() : OEDocument()
     didUpdate = NULL;
     
     activityCount = 0;
+    hibernationCount = 0;
+    
+    prefetchIndex = 0;
+    pthread_mutex_init(&prefetchMutex, NULL);
+    pthread_mutex_init(&packageMutex, NULL);
+    
+    rewindInterval = 0;
+    rewindSnapshotNum = 0;
+    rewindFrameCount = 0;
+    
+    hasState = false;
+    
+    isBootCache = false;
+    isBootPending = false;
+    bootResourcesHash = 0;
+    bootKey = 0;
+    
+    isProfile = false;
+    
+    runAheadFrameNum = 0;
+    isRunningAhead = false;
+    
+    randomState = OE_RANDOM_SEED;
+    
+    journalMode = OEJOURNAL_OFF;
+    journalClock = NULL;
+    journalIndex = 0;
+    isJournalInjecting = false;
     
     addComponent("emulation", this);
 }
@@ -39,6 +77,8 @@ OEEmulation::~OEEmulation()
     
     didUpdate = NULL;
     
+    // A compiled document that was never edited is torn down from its
+    // records, so its EDL is not parsed just to be disposed
     if (doc)
     {
         disposeDocument(doc);
@@ -47,6 +87,17 @@ OEEmulation::~OEEmulation()
         
         destroyDocument(doc);
     }
+    else
+    {
+        disposeDocument(compiledInfos);
+        
+        deconfigureDocument(compiledInfos);
+        
+        destroyDocument(compiledInfos);
+    }
+    
+    pthread_mutex_destroy(&prefetchMutex);
+    pthread_mutex_destroy(&packageMutex);
 }
 
 void OEEmulation::setResourcePath(string path)
@@ -123,334 +174,668 @@ bool OEEmulation::isActive()
     return (activityCount != 0);
 }
 
-
-
-bool OEEmulation::constructDocument(xmlDocPtr doc)
+// A snapshot holds the state of every component, in id order. Snapshots
+// should be taken and loaded between audio buffers, with the emulations
+// locked. Both start at the snapshot's current position
+bool OEEmulation::saveSnapshot(OESnapshot *snapshot)
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    updateSnapshotComponents();
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
-    {
-        if (getNodeName(node) == "device")
-        {
-            string deviceId = getNodeProperty(node, "id");
-            
-            if (!constructDevice(deviceId))
-                return false;
-        }
-        else if (getNodeName(node) == "component")
-        {
-            string id = getNodeProperty(node, "id");
-            string className = getNodeProperty(node, "class");
-            
-            if (!constructComponent(id, className))
-                return false;
-        }
-    }
+    snapshot->setComponents(&snapshotComponents);
     
-    if (configureDocument(doc))
-        if (initDocument(doc))
-            return true;
+    OEInt magic = OE_SNAPSHOT_MAGIC;
+    OEInt componentNum = (OEInt) componentsMap.size();
     
-    return false;
-}
-
-bool OEEmulation::constructDevice(string deviceId)
-{
-    if (!getComponent(deviceId))
-    {
-        OEComponent *component;
-        component = new OEDevice(this);
-        
-        if (component && addComponent(deviceId, component))
-            return true;
-        else
-            logMessage("could not construct '" + deviceId + "'");
-    }
-    else
-        logMessage("redefinition of '" + deviceId + "'");
+    snapshot->write(magic);
+    snapshot->write(componentNum);
     
-    return false;
-}
-
-bool OEEmulation::constructComponent(string id, string className)
-{
-    if (!getComponent(id))
+    for (OEComponentsMap::iterator i = componentsMap.begin();
+         i != componentsMap.end();
+         i++)
     {
-        OEComponent *component;
-        component = OEComponentFactory::construct(className);
+        snapshot->write(i->first);
         
-        if (component)
-            return addComponent(id, component);
-        else
-            logMessage("could not construct '" + id +
-                       "', class '" + className + "' is not defined");
-    }
-    else
-        logMessage("redefinition of '" + id + "'");
-    
-    return false;
-}
-
-bool OEEmulation::configureDocument(xmlDocPtr doc)
-{
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
-    
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
-    {
-        if (getNodeName(node) == "device")
-        {
-            string deviceId = getNodeProperty(node, "id");
-            string label = getNodeProperty(node, "label");
-            string image = getNodeProperty(node, "image");
-            
-            if (!configureDevice(deviceId, label, image, node->children))
-                return false;
-        }
-        else if (getNodeName(node) == "component")
+        // The state size is patched in once it is known
+        OEInt size = 0;
+        size_t sizePosition = snapshot->getPosition();
+        
+        snapshot->write(size);
+        
+        if (!i->second->serialize(snapshot))
         {
-            string id = getNodeProperty(node, "id");
+            logMessage("could not save state of '" + i->first + "'");
             
-            if (!configureComponent(id, node->children))
-                return false;
+            return false;
         }
+        
+        size = (OEInt) (snapshot->getPosition() - sizePosition - sizeof(size));
+        
+        snapshot->patch(sizePosition, &size, sizeof(size));
     }
     
     return true;
 }
 
-bool OEEmulation::configureDevice(string deviceId,
-                                  string label, string image,
-                                  xmlNodePtr children)
+bool OEEmulation::loadSnapshot(OESnapshot *snapshot)
 {
-    OEComponent *device = getComponent(deviceId);
-    string locationLabel = getLocationLabel(deviceId);
+    updateSnapshotComponents();
     
-    // Parse settings
-    DeviceSettings settings;
-    for(xmlNodePtr node = children;
-        node;
-        node = node->next)
+    snapshot->setComponents(&snapshotComponents);
+    
+    // The records are checked first, so a snapshot of another emulation,
+    // or a truncated one, is refused before any component is loaded. A
+    // component that fails to deserialize leaves the emulation partially
+    // loaded
+    size_t start = snapshot->getPosition();
+    
+    for (int pass = 0; pass < 2; pass++)
     {
-        if (getNodeName(node) == "setting")
+        OEInt magic;
+        OEInt componentNum;
+        
+        if (!snapshot->read(magic) ||
+            !snapshot->read(componentNum) ||
+            (magic != OE_SNAPSHOT_MAGIC) ||
+            (componentNum != componentsMap.size()))
         {
-            string ref = getNodeProperty(node, "ref");
-            
-            OEComponent *component = getComponent(ref);
-            
-            if (!component)
-            {
-                logMessage("'" + ref + "' was not declared");
-                
-                return false;
-            }
-            
-            DeviceSetting setting;
+            logMessage("snapshot does not match emulation");
             
-            setting.component = component;
-            setting.name = getNodeProperty(node, "name");
-            setting.type = getNodeProperty(node, "type");
-            setting.options = getNodeProperty(node, "options");
-            setting.label = getNodeProperty(node, "label");
-            
-            settings.push_back(setting);
+            return false;
         }
-    }
-    
-    device->postMessage(this, DEVICE_SET_LABEL, &label);
-    device->postMessage(this, DEVICE_SET_IMAGEPATH, &image);
-    device->postMessage(this, DEVICE_SET_LOCATIONLABEL, &locationLabel);
-    device->postMessage(this, DEVICE_SET_SETTINGS, &settings);
-    
-    return true;
-}
-
-bool OEEmulation::configureComponent(string id, xmlNodePtr children)
-{
-    OEComponent *component = getComponent(id);
-    if (!component)
-    {
-        logMessage("'" + id + "' was not declared");
         
-        return false;
-    }
-    
-    map<string, string> propertiesMap;
-    propertiesMap["id"] = id;
-    propertiesMap["deviceId"] = OEGetDeviceId(id);
-    propertiesMap["resourcePath"] = resourcePath;
-    
-    for(xmlNodePtr node = children;
-        node;
-        node = node->next)
-    {
-        if (getNodeName(node) == "property")
+        for (OEComponentsMap::iterator i = componentsMap.begin();
+             i != componentsMap.end();
+             i++)
         {
-            string name = getNodeProperty(node, "name");
+            string id;
+            OEInt size;
             
-            if (hasNodeProperty(node, "value"))
-            {
-                string value = getNodeProperty(node, "value");
-                value = parseValueProperties(value, propertiesMap);
-                
-                if (!component->setValue(name, value))
-                    logMessage("could not set value property '" + name + "' for '" + id + "'");
-            }
-            else if (hasNodeProperty(node, "ref"))
+            if (!snapshot->read(id) ||
+                !snapshot->read(size) ||
+                (id != i->first))
             {
-                string refId = getNodeProperty(node, "ref");
+                logMessage("snapshot does not match emulation");
                 
-                OEComponent *ref = getComponent(refId);
-                
-                if ((refId != "") && !ref)
-                    logMessage("'" + refId + "' was not declared");
-                
-                if (!component->setRef(name, ref))
-                    logMessage("could not set ref property '" + name + "' for '" + id + "'");
+                return false;
             }
-            else if (hasNodeProperty(node, "data"))
+            
+            size_t end = snapshot->getPosition() + size;
+            
+            if (!pass)
             {
-                string dataSrc = getNodeProperty(node, "data");
-                
-                OEData data;
-                
-                string parsedSrc = parseValueProperties(dataSrc, propertiesMap);
-                
-                bool dataRead = false;
-                
-                if (hasValueProperty(dataSrc, "packagePath"))
+                if (!snapshot->skip(size))
                 {
-                    if (package)
-                        dataRead = package->read(parsedSrc, &data);
+                    logMessage("snapshot is truncated");
+                    
+                    return false;
                 }
-                else
-                    dataRead = readFile(parsedSrc, &data);
+            }
+            else if (!i->second->deserialize(snapshot) ||
+                     (snapshot->getPosition() != end))
+            {
+                logMessage("could not load state of '" + i->first + "'");
                 
-                if (dataRead)
-                {
-                    if (!component->setData(name, &data))
-                        logMessage("could not set data property '" + name + "' for '" + id + "'");
-                }
+                return false;
             }
-            else
-                logMessage("could not recognize type of property '" + name + "' in '" + id + "'");
+        }
+        
+        if (!pass)
+        {
+            snapshot->rewind();
+            snapshot->skip(start);
         }
     }
     
     return true;
 }
 
-bool OEEmulation::configureInlets(OEInletMap& inletMap)
+// Rewind keeps the latest snapshot, and deltas back to older ones
+void OEEmulation::setRewind(OEInt interval, OEInt snapshotNum)
 {
-    set<OEComponent *> components;
+    rewindInterval = interval;
+    rewindSnapshotNum = snapshotNum;
+    rewindFrameCount = 0;
     
-    for (OEInletMap::iterator i = inletMap.begin();
-         i != inletMap.end();
-         i++)
+    rewindSnapshot.clear();
+    rewindNextSnapshot.clear();
+    rewindDeltas.clear();
+}
+
+OEInt OEEmulation::getRewindSnapshotNum()
+{
+    if (!rewindSnapshot.getSize())
+        return 0;
+    
+    return (OEInt) rewindDeltas.size() + 1;
+}
+
+bool OEEmulation::rewind(OEInt steps)
+{
+    if (!steps ||
+        !rewindSnapshot.getSize())
+        return false;
+    
+    for (; (steps > 1) && rewindDeltas.size(); steps--)
     {
-        string id = i->first;
-        OEIdMap& idMap = i->second;
-        
-        OEComponent *component = getComponent(id);
-        
-        if (!component)
-        {
-            logMessage("'" + id + "' was not declared");
-            
-            continue;
-        }
-        
-        for (OEIdMap::iterator j = idMap.begin();
-             j != idMap.end();
-             j++)
+        if (!rewindSnapshot.applyDelta(rewindDeltas.back()))
         {
-            string name = j->first;
-            string refId = j->second;
+            logMessage("could not rewind");
             
-            OEComponent *ref = getComponent(refId);
+            setRewind(rewindInterval, rewindSnapshotNum);
             
-            if (!component->setRef(name, ref))
-                logMessage("could not set ref property '" + name + "' for '" + id + "'");
-            else
-                components.insert(component);
+            return false;
         }
+        
+        rewindDeltas.pop_back();
     }
     
-    for (set<OEComponent *>::iterator i = components.begin();
-         i != components.end();
-         i++)
-        (*i)->update();
+    rewindFrameCount = 0;
     
-    return true;
+    // A journal does not survive a rewind
+    stopJournal();
+    
+    rewindSnapshot.rewind();
+    
+    return loadSnapshot(&rewindSnapshot);
 }
 
-bool OEEmulation::initDocument(xmlDocPtr doc)
+void OEEmulation::setRunAhead(OEInt frameNum)
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    runAheadFrameNum = frameNum;
+}
+
+OEInt OEEmulation::getRunAhead()
+{
+    return runAheadFrameNum;
+}
+
+void OEEmulation::setRandomSeed(OELong seed)
+{
+    randomState = seed ? seed : OE_RANDOM_SEED;
+}
+
+void OEEmulation::setBootCache(bool value)
+{
+    isBootCache = value;
+}
+
+// Logs the component construction statistics when a document is constructed
+void OEEmulation::setProfile(bool value)
+{
+    isProfile = value;
+}
+
+// A journal holds a snapshot of the emulation when recording started, and
+// the host input relayed since, stamped with the cycles of the first
+// control bus. Replaying loads the snapshot and delivers the input at the
+// same cycles, independently of the audio buffer size
+bool OEEmulation::startRecording()
+{
+    stopJournal();
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
+    if (!controlBuses.size())
     {
-        if (getNodeName(node) == "component")
-        {
-            string id = getNodeProperty(node, "id");
-            
-            if (!initComponent(id))
-                return false;
-        }
+        logMessage("could not record journal, no control bus");
+        
+        return false;
     }
     
+    journalSnapshot.clear();
+    
+    if (!saveSnapshot(&journalSnapshot))
+        return false;
+    
+    journal.clear();
+    
+    journalClock = controlBuses.front();
+    journalClockId = getId(journalClock);
+    journalMode = OEJOURNAL_RECORD;
+    
     return true;
 }
 
-bool OEEmulation::initComponent(string id)
+bool OEEmulation::startReplay()
 {
-    OEComponent *component = getComponent(id);
+    stopJournal();
     
-    if (!component)
+    journalClock = getComponent(journalClockId);
+    
+    if (!journalClock ||
+        !journalSnapshot.getSize())
     {
-        logMessage("'" + id + "' was not declared");
+        logMessage("could not replay journal");
         
         return false;
     }
     
-    if (!component->init())
-    {
-        logMessage("could not init '" + id + "'");
-        
+    journalSnapshot.rewind();
+    
+    if (!loadSnapshot(&journalSnapshot))
         return false;
-    }
+    
+    journalIndex = 0;
+    journalMode = OEJOURNAL_REPLAY;
+    
+    replayInput();
     
     return true;
 }
 
-bool OEEmulation::reconfigureDocument(xmlDocPtr doc)
+void OEEmulation::stopJournal()
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    if ((journalMode == OEJOURNAL_REPLAY) && journalClock)
+    {
+        OEInt id = 0;
+        
+        journalClock->postMessage(this, CONTROLBUS_INVALIDATE_TIMERS, &id);
+    }
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
-        if (getNodeName(node) == "component")
+    journalMode = OEJOURNAL_OFF;
+}
+
+OEJournalMode OEEmulation::getJournalMode()
+{
+    return journalMode;
+}
+
+bool OEEmulation::saveJournal(string path)
+{
+    OESnapshot snapshot;
+    
+    OEInt magic = OE_JOURNAL_MAGIC;
+    OEInt snapshotSize = (OEInt) journalSnapshot.getSize();
+    OEInt entryNum = (OEInt) journal.size();
+    
+    snapshot.write(magic);
+    snapshot.write(journalClockId);
+    snapshot.write(snapshotSize);
+    snapshot.write(journalSnapshot.getData(), snapshotSize);
+    snapshot.write(entryNum);
+    
+    for (OEJournal::iterator i = journal.begin();
+         i != journal.end();
+         i++)
+    {
+        snapshot.write(i->cycles);
+        snapshot.write(i->relayId);
+        snapshot.write(i->senderId);
+        snapshot.write(i->notification);
+        snapshot.write(i->type);
+        snapshot.write(i->data);
+    }
+    
+    OEData data;
+    
+    snapshot.swap(data);
+    
+    if (!writeFile(path, &data))
+    {
+        logMessage("could not write '" + path + "'");
+        
+        return false;
+    }
+    
+    return true;
+}
+
+bool OEEmulation::loadJournal(string path)
+{
+    stopJournal();
+    
+    OEData data;
+    
+    if (!readFile(path, &data))
+    {
+        logMessage("could not read '" + path + "'");
+        
+        return false;
+    }
+    
+    OESnapshot snapshot;
+    
+    snapshot.swap(data);
+    
+    OEInt magic;
+    string clockId;
+    OEData snapshotData;
+    OEInt entryNum;
+    OEJournal theJournal;
+    
+    bool success = (snapshot.read(magic) &&
+                    (magic == OE_JOURNAL_MAGIC) &&
+                    snapshot.read(clockId) &&
+                    snapshot.read(snapshotData) &&
+                    snapshot.read(entryNum));
+    
+    for (OEInt i = 0; success && (i < entryNum); i++)
+    {
+        OEJournalEntry entry;
+        
+        success = (snapshot.read(entry.cycles) &&
+                   snapshot.read(entry.relayId) &&
+                   snapshot.read(entry.senderId) &&
+                   snapshot.read(entry.notification) &&
+                   snapshot.read(entry.type) &&
+                   snapshot.read(entry.data));
+        
+        theJournal.push_back(entry);
+    }
+    
+    if (!success)
+    {
+        logMessage("'" + path + "' is not a valid journal");
+        
+        return false;
+    }
+    
+    journalClockId = clockId;
+    journalSnapshot.clear();
+    journalSnapshot.swap(snapshotData);
+    journal.swap(theJournal);
+    
+    return true;
+}
+
+// Writes a program straight into the 64 KiB memory bus of a CPU, and
+// optionally jumps to it. A negative address selects the address in the
+// header
+bool OEEmulation::loadProgram(string cpuId, string path, OEProgramFormat format,
+                              OESLong address, bool start)
+{
+    // Journals replay input only, so they would miss the program
+    if (journalMode != OEJOURNAL_OFF)
+    {
+        logMessage("cannot load a program while a journal is active");
+        
+        return false;
+    }
+    
+    OEComponent *cpu = getComponent(cpuId);
+    OEComponent *memoryBus = NULL;
+    
+    if (!cpu ||
+        !cpu->postMessage(this, CPU_GET_MEMORYBUS, &memoryBus) ||
+        !memoryBus)
+    {
+        logMessage("'" + cpuId + "' is not a CPU with a memory bus");
+        
+        return false;
+    }
+    
+    OEData data;
+    
+    if (!readFile(path, &data))
+    {
+        logMessage("could not read '" + path + "'");
+        
+        return false;
+    }
+    
+    if (!decodeProgram(data, format, address))
+    {
+        logMessage("'" + path + "' is not a valid program");
+        
+        return false;
+    }
+    
+    if (address < 0)
+    {
+        logMessage("no load address for '" + path + "'");
+        
+        return false;
+    }
+    
+    if ((address + (OESLong) data.size()) > OE_PROGRAM_ADDRESSSPACE)
+    {
+        logMessage("'" + path + "' does not fit in memory at " + getHexString(address));
+        
+        return false;
+    }
+    
+    if (data.size())
+        memoryBus->writeBlock(address, &data.front(), data.size());
+    
+    if (start &&
+        !cpu->setValue("pc", getHexString(address)))
+    {
+        logMessage("could not set the program counter of '" + cpuId + "'");
+        
+        return false;
+    }
+    
+    // A loaded program must not end up in the boot cache
+    isBootPending = false;
+    
+    return true;
+}
+
+static OEInt getProgramInt(OEChar *p, OEInt byteNum, bool isBigEndian)
+{
+    OEInt value = 0;
+    
+    for (OEInt i = 0; i < byteNum; i++)
+        value |= (OEInt) p[i] << (8 * (isBigEndian ? (byteNum - 1 - i) : i));
+    
+    return value;
+}
+
+// Strips the header of a program. The header's load address is used
+// unless an address was given
+bool OEEmulation::decodeProgram(OEData& data, OEProgramFormat format, OESLong& address)
+{
+    switch (format)
+    {
+        case OEPROGRAM_BINARY:
+            return true;
+            
+        case OEPROGRAM_DOS33BINARY:
         {
-            string id = getNodeProperty(node, "id");
+            // Load address and length, little-endian
+            if (data.size() < 4)
+                return false;
             
-            if (!reconfigureComponent(id, node->children))
+            OEInt start = getProgramInt(&data[0], 2, false);
+            OEInt length = getProgramInt(&data[2], 2, false);
+            
+            if ((4 + length) > data.size())
+                return false;
+            
+            if (address < 0)
+                address = start;
+            
+            OEData(data.begin() + 4, data.begin() + 4 + length).swap(data);
+            
+            return true;
+        }
+            
+        case OEPROGRAM_APPLESINGLE:
+        {
+            // Big-endian header, followed by an entry table
+            if ((data.size() < 26) ||
+                (getProgramInt(&data[0], 4, true) != OE_APPLESINGLE_MAGIC))
+                return false;
+            
+            OEInt entryNum = getProgramInt(&data[24], 2, true);
+            
+            if ((26 + 12 * entryNum) > data.size())
+                return false;
+            
+            OEData dataFork;
+            bool hasDataFork = false;
+            
+            for (OEInt i = 0; i < entryNum; i++)
+            {
+                OEChar *entry = &data[26 + 12 * i];
+                
+                OEInt id = getProgramInt(entry + 0, 4, true);
+                OEInt offset = getProgramInt(entry + 4, 4, true);
+                OEInt length = getProgramInt(entry + 8, 4, true);
+                
+                if (((OELong) offset + length) > data.size())
+                    return false;
+                
+                if (id == OE_APPLESINGLE_DATAFORK)
+                {
+                    dataFork.assign(data.begin() + offset, data.begin() + offset + length);
+                    
+                    hasDataFork = true;
+                }
+                // The ProDOS aux type holds the load address
+                else if ((id == OE_APPLESINGLE_PRODOSINFO) &&
+                         (length >= 8) &&
+                         (address < 0))
+                    address = getProgramInt(&data[offset + 4], 4, true);
+            }
+            
+            if (!hasDataFork)
+                return false;
+            
+            data.swap(dataFork);
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool OEEmulation::constructDocument(OEComponentInfos& componentInfos)
+{
+    if (isProfile)
+        OEComponentFactory::resetStatistics();
+    
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        if (i->isDevice)
+        {
+            if (!constructDevice(i->id))
+                return false;
+        }
+        else if (!constructComponent(i->id, i->className))
+            return false;
+    }
+    
+    if (isProfile)
+        OEComponentFactory::logStatistics();
+    
+    compiledInfos.insert(compiledInfos.end(),
+                         componentInfos.begin(), componentInfos.end());
+    
+    prefetchResources(componentInfos);
+    
+    bool success = false;
+    
+    if (configureDocument(componentInfos))
+        success = initDocument(componentInfos);
+    
+    if (isBootCache)
+        bootResourcesHash = getResourcesHash();
+    
+    clearResources();
+    
+    return success;
+}
+
+bool OEEmulation::constructDevice(string deviceId)
+{
+    if (!getComponent(deviceId))
+    {
+        OEComponent *component;
+        component = new OEDevice(this);
+        
+        if (component && addComponent(deviceId, component))
+            return true;
+        else
+            logMessage("could not construct '" + deviceId + "'");
+    }
+    else
+        logMessage("redefinition of '" + deviceId + "'");
+    
+    return false;
+}
+
+bool OEEmulation::constructComponent(string id, string className)
+{
+    if (!getComponent(id))
+    {
+        OEComponent *component;
+        component = OEComponentFactory::construct(className);
+        
+        if (component)
+            return addComponent(id, component);
+        else
+            logMessage("could not construct '" + id +
+                       "', class '" + className + "' is not defined");
+    }
+    else
+        logMessage("redefinition of '" + id + "'");
+    
+    return false;
+}
+
+bool OEEmulation::configureDocument(OEComponentInfos& componentInfos)
+{
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        if (i->isDevice)
+        {
+            if (!configureDevice(*i))
                 return false;
         }
+        else if (!configureComponent(*i))
+            return false;
+    }
     
     return true;
 }
 
-bool OEEmulation::reconfigureComponent(string id, xmlNodePtr children)
+bool OEEmulation::configureDevice(OEComponentInfo& componentInfo)
 {
-    OEComponent *component = getComponent(id);
+    OEComponent *device = getComponent(componentInfo.id);
+    
+    // Parse settings
+    DeviceSettings settings;
+    for (OESettingInfos::iterator i = componentInfo.settingInfos.begin();
+         i != componentInfo.settingInfos.end();
+         i++)
+    {
+        OEComponent *component = getComponent(i->ref);
+        
+        if (!component)
+        {
+            logMessage("'" + i->ref + "' was not declared");
+            
+            return false;
+        }
+        
+        DeviceSetting setting;
+        
+        setting.component = component;
+        setting.name = i->name;
+        setting.type = i->type;
+        setting.options = i->options;
+        setting.label = i->label;
+        
+        settings.push_back(setting);
+    }
     
+    device->postMessage(this, DEVICE_SET_LABEL, &componentInfo.label);
+    device->postMessage(this, DEVICE_SET_IMAGEPATH, &componentInfo.image);
+    device->postMessage(this, DEVICE_SET_LOCATIONLABEL, &componentInfo.locationLabel);
+    device->postMessage(this, DEVICE_SET_SETTINGS, &settings);
+    
+    return true;
+}
+
+bool OEEmulation::configureComponent(OEComponentInfo& componentInfo)
+{
+    string id = componentInfo.id;
+    
+    OEComponent *component = getComponent(id);
     if (!component)
     {
         logMessage("'" + id + "' was not declared");
@@ -458,29 +843,231 @@ bool OEEmulation::reconfigureComponent(string id, xmlNodePtr children)
         return false;
     }
     
-    map<string, string> propertiesMap;
-    propertiesMap["id"] = id;
-    propertiesMap["deviceId"] = OEGetDeviceId(id);
-    propertiesMap["resourcePath"] = resourcePath;
+    map<string, string> propertiesMap = getPropertiesMap(id);
     
-    for(xmlNodePtr node = children;
-        node;
-        node = node->next)
+    for (OEPropertyInfos::iterator i = componentInfo.propertyInfos.begin();
+         i != componentInfo.propertyInfos.end();
+         i++)
     {
-        if (getNodeName(node) == "property")
+        string name = i->name;
+        
+        if (i->type == OEPROPERTY_VALUE)
         {
-            string name = getNodeProperty(node, "name");
+            string value = parseValueProperties(i->value, propertiesMap);
             
-            if (hasNodeProperty(node, "value"))
+            if (!component->setValue(name, value))
+                logMessage("could not set value property '" + name + "' for '" + id + "'");
+        }
+        else if (i->type == OEPROPERTY_REF)
+        {
+            string refId = i->value;
+            
+            OEComponent *ref = getComponent(refId);
+            
+            if ((refId != "") && !ref)
+                logMessage("'" + refId + "' was not declared");
+            
+            if (!component->setRef(name, ref))
+                logMessage("could not set ref property '" + name + "' for '" + id + "'");
+        }
+        else if (i->type == OEPROPERTY_DATA)
+        {
+            string dataSrc = i->value;
+            
+            // Data is usually prefetched by prefetchResources()
+            OEResource resource;
+            string key = id + "." + name;
+            
+            if (resources.count(key))
+                resource = resources[key];
+            else
             {
-                string value;
+                resource.type = OERESOURCE_DATA;
+                resource.src = parseValueProperties(dataSrc, propertiesMap);
+                resource.isPackagePath = hasValueProperty(dataSrc, "packagePath");
                 
-                if (component->getValue(name, value))
-                    setNodeProperty(node, "value", value);
+                loadResource(resource);
+                
+                resources[key] = resource;
             }
-            else if (hasNodeProperty(node, "data"))
+            
+            if (resource.isMapped)
             {
-                string dataSrc = getNodeProperty(node, "data");
+                if (!component->setMappedData(name, resource.mappedData))
+                    logMessage("could not set data property '" + name + "' for '" + id + "'");
+            }
+            else if (resource.isRead)
+            {
+                if (!component->setData(name, resource.data))
+                    logMessage("could not set data property '" + name + "' for '" + id + "'");
+            }
+        }
+        else
+            logMessage("could not recognize type of property '" + name + "' in '" + id + "'");
+    }
+    
+    return true;
+}
+
+bool OEEmulation::configureInlets(OEInletMap& inletMap)
+{
+    set<OEComponent *> components;
+    
+    for (OEInletMap::iterator i = inletMap.begin();
+         i != inletMap.end();
+         i++)
+    {
+        string id = i->first;
+        OEIdMap& idMap = i->second;
+        
+        OEComponent *component = getComponent(id);
+        
+        if (!component)
+        {
+            logMessage("'" + id + "' was not declared");
+            
+            continue;
+        }
+        
+        for (OEIdMap::iterator j = idMap.begin();
+             j != idMap.end();
+             j++)
+        {
+            string name = j->first;
+            string refId = j->second;
+            
+            OEComponent *ref = getComponent(refId);
+            
+            if (!component->setRef(name, ref))
+                logMessage("could not set ref property '" + name + "' for '" + id + "'");
+            else
+                components.insert(component);
+        }
+    }
+    
+    for (set<OEComponent *>::iterator i = components.begin();
+         i != components.end();
+         i++)
+        (*i)->update();
+    
+    return true;
+}
+
+bool OEEmulation::initDocument(OEComponentInfos& componentInfos)
+{
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        if (!i->isDevice)
+        {
+            if (!initComponent(i->id))
+                return false;
+        }
+    }
+    
+    return true;
+}
+
+bool OEEmulation::initComponent(string id)
+{
+    OEComponent *component = getComponent(id);
+    
+    if (!component)
+    {
+        logMessage("'" + id + "' was not declared");
+        
+        return false;
+    }
+    
+    if (!component->init())
+    {
+        logMessage("could not init '" + id + "'");
+        
+        return false;
+    }
+    
+    return true;
+}
+
+bool OEEmulation::reconfigureDocument(xmlDocPtr doc)
+{
+    flushStorages();
+    
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+        if (getNodeName(node) == "component")
+        {
+            string id = getNodeProperty(node, "id");
+            
+            if (!reconfigureComponent(id, node->children))
+                return false;
+        }
+    
+    return true;
+}
+
+// Write back cached storage data before the document is saved
+void OEEmulation::flushStorages()
+{
+    OEIds deviceIds = getDeviceIds();
+    
+    for (OEIds::iterator i = deviceIds.begin();
+         i != deviceIds.end();
+         i++)
+    {
+        OEComponent *device = getComponent(*i);
+        OEComponents storages;
+        
+        if (!device)
+            continue;
+        
+        device->postMessage(this, DEVICE_GET_STORAGES, &storages);
+        
+        for (OEComponents::iterator j = storages.begin();
+             j != storages.end();
+             j++)
+            (*j)->postMessage(this, STORAGE_FLUSH, NULL);
+    }
+}
+
+bool OEEmulation::reconfigureComponent(string id, xmlNodePtr children)
+{
+    OEComponent *component = getComponent(id);
+    
+    if (!component)
+    {
+        logMessage("'" + id + "' was not declared");
+        
+        return false;
+    }
+    
+    map<string, string> propertiesMap;
+    propertiesMap["id"] = id;
+    propertiesMap["deviceId"] = OEGetDeviceId(id);
+    propertiesMap["resourcePath"] = resourcePath;
+    
+    for(xmlNodePtr node = children;
+        node;
+        node = node->next)
+    {
+        if (getNodeName(node) == "property")
+        {
+            string name = getNodeProperty(node, "name");
+            
+            if (hasNodeProperty(node, "value"))
+            {
+                string value;
+                
+                if (component->getValue(name, value))
+                    setNodeProperty(node, "value", value);
+            }
+            else if (hasNodeProperty(node, "data"))
+            {
+                string dataSrc = getNodeProperty(node, "data");
                 
                 if (!hasValueProperty(dataSrc, "packagePath") || !package)
                     continue;
@@ -498,228 +1085,1005 @@ bool OEEmulation::reconfigureComponent(string id, xmlNodePtr children)
         }
     }
     
-    return true;
+    return true;
+}
+
+void OEEmulation::disposeDocument(xmlDocPtr doc)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if ((getNodeName(node) == "component") ||
+            (getNodeName(node) == "device"))
+        {
+            string id = getNodeProperty(node, "id");
+            
+            disposeComponent(id);
+        }
+    }
+}
+
+void OEEmulation::disposeDocument(OEComponentInfos& componentInfos)
+{
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+        disposeComponent(i->id);
+}
+
+void OEEmulation::disposeDevice(string deviceId)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if ((getNodeName(node) == "component") ||
+            (getNodeName(node) == "device"))
+        {
+            string componentId = getNodeProperty(node, "id");
+            
+            if (OEGetDeviceId(componentId) == deviceId)
+                disposeComponent(componentId);
+        }
+    }
+}
+
+void OEEmulation::disposeComponent(string id)
+{
+    OEComponent *component = getComponent(id);
+    
+    if (component)
+        component->dispose();
+}
+
+void OEEmulation::deconfigureDocument(xmlDocPtr doc)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if (getNodeName(node) == "component")
+        {
+            string id = getNodeProperty(node, "id");
+            
+            deconfigureComponent(id, node->children);
+        }
+    }
+}
+
+void OEEmulation::deconfigureDocument(OEComponentInfos& componentInfos)
+{
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        OEComponent *component = getComponent(i->id);
+        
+        if (i->isDevice || !component)
+            continue;
+        
+        for (OEPropertyInfos::iterator j = i->propertyInfos.begin();
+             j != i->propertyInfos.end();
+             j++)
+        {
+            if (j->type == OEPROPERTY_REF)
+                component->setRef(j->name, NULL);
+        }
+    }
+}
+
+void OEEmulation::deconfigureDevice(string deviceId)
+{
+    set<OEComponent *> components;
+    
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if (getNodeName(node) == "component")
+        {
+            string componentId = getNodeProperty(node, "id");
+            
+            for(xmlNodePtr propertyNode = node->children;
+                propertyNode;
+                propertyNode = propertyNode->next)
+            {
+                if (getNodeName(propertyNode) == "property")
+                {
+                    string ref = getNodeProperty(propertyNode, "ref");
+                    
+                    if (ref == "")
+                        continue;
+                    
+                    if ((OEGetDeviceId(componentId) == deviceId) ||
+                        (OEGetDeviceId(ref) == deviceId))
+                    {
+                        OEComponent *component = getComponent(componentId);
+                        if (component)
+                        {
+                            string name = getNodeProperty(propertyNode, "name");
+                            
+                            component->setRef(name, NULL);
+                            
+                            if ((OEGetDeviceId(componentId) != deviceId) &&
+                                (OEGetDeviceId(ref) == deviceId))
+                                components.insert(component);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    for (set<OEComponent *>::iterator i = components.begin();
+         i != components.end();
+         i++)
+        (*i)->update();
+}
+
+void OEEmulation::deconfigureComponent(string id, xmlNodePtr children)
+{
+    OEComponent *component = getComponent(id);
+    
+    if (!component)
+        return;
+    
+    for(xmlNodePtr node = children;
+        node;
+        node = node->next)
+    {
+        if (getNodeName(node) == "property")
+        {
+            string name = getNodeProperty(node, "name");
+            
+            if (hasNodeProperty(node, "ref"))
+                component->setRef(name, NULL);
+        }
+    }
+}
+
+void OEEmulation::destroyDocument(xmlDocPtr doc)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if ((getNodeName(node) == "component") ||
+            (getNodeName(node) == "device"))
+        {
+            string componentId = getNodeProperty(node, "id");
+            
+            destroyComponent(componentId, node->children);
+        }
+    }
+}
+
+void OEEmulation::destroyDocument(OEComponentInfos& componentInfos)
+{
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+        destroyComponent(i->id, NULL);
+}
+
+void OEEmulation::destroyDevice(string deviceId)
+{
+    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    
+    for(xmlNodePtr node = rootNode->children;
+        node;
+        node = node->next)
+    {
+        if ((getNodeName(node) == "component") ||
+            (getNodeName(node) == "device"))
+        {
+            string componentId = getNodeProperty(node, "id");
+            
+            if (OEGetDeviceId(componentId) == deviceId)
+                destroyComponent(componentId, node->children);
+        }
+    }
+}
+
+void OEEmulation::destroyComponent(string id, xmlNodePtr children)
+{
+    OEComponent *component = getComponent(id);
+    
+    if (!component)
+        return;
+    
+    delete component;
+    
+    removeComponent(id);
+}
+
+// Loads the document's data properties, and decodes the sounds and images
+// its value properties name, on a pool of threads. Data is keyed by
+// "id.name", sounds and images by their path
+void OEEmulation::prefetchResources(OEComponentInfos& componentInfos)
+{
+    set<string> paths;
+    
+    for (OEComponentInfos::iterator i = componentInfos.begin();
+         i != componentInfos.end();
+         i++)
+    {
+        if (i->isDevice)
+            continue;
+        
+        map<string, string> propertiesMap = getPropertiesMap(i->id);
+        
+        for (OEPropertyInfos::iterator j = i->propertyInfos.begin();
+             j != i->propertyInfos.end();
+             j++)
+        {
+            OEResource resource;
+            
+            resource.src = parseValueProperties(j->value, propertiesMap);
+            resource.isPackagePath = hasValueProperty(j->value, "packagePath");
+            resource.mappedData = NULL;
+            resource.data = NULL;
+            resource.isMapped = false;
+            resource.isRead = false;
+            
+            if (j->type == OEPROPERTY_DATA)
+            {
+                resource.type = OERESOURCE_DATA;
+                
+                resources[i->id + "." + j->name] = resource;
+            }
+            else if ((j->type == OEPROPERTY_VALUE) &&
+                     hasValueProperty(j->value, "resourcePath"))
+            {
+                string pathExtension = strtolower(getPathExtension(resource.src));
+                
+                if ((pathExtension == "ogg") ||
+                    (pathExtension == "wav") ||
+                    (pathExtension == "aif") ||
+                    (pathExtension == "aiff") ||
+                    (pathExtension == "flac"))
+                    resource.type = OERESOURCE_SOUND;
+                else if (pathExtension == "png")
+                    resource.type = OERESOURCE_IMAGE;
+                else
+                    continue;
+                
+                // Shared sounds and images are decoded once
+                if (paths.count(resource.src))
+                    continue;
+                
+                paths.insert(resource.src);
+                
+                resources[resource.src] = resource;
+            }
+        }
+    }
+    
+    prefetchQueue.clear();
+    
+    for (OEResources::iterator i = resources.begin();
+         i != resources.end();
+         i++)
+        prefetchQueue.push_back(&i->second);
+    
+    prefetchIndex = 0;
+    
+    pthread_t threads[OE_PREFETCH_THREADNUM];
+    size_t threadNum = 0;
+    
+    while ((threadNum < OE_PREFETCH_THREADNUM) &&
+           ((threadNum + 1) < prefetchQueue.size()))
+    {
+        if (pthread_create(&threads[threadNum], NULL, prefetchResource, this))
+            break;
+        
+        threadNum++;
+    }
+    
+    prefetchResource(this);
+    
+    for (size_t i = 0; i < threadNum; i++)
+        pthread_join(threads[i], NULL);
+    
+    prefetchQueue.clear();
+}
+
+void *OEEmulation::prefetchResource(void *context)
+{
+    OEEmulation *emulation = (OEEmulation *) context;
+    
+    while (true)
+    {
+        pthread_mutex_lock(&emulation->prefetchMutex);
+        
+        size_t index = emulation->prefetchIndex++;
+        
+        pthread_mutex_unlock(&emulation->prefetchMutex);
+        
+        if (index >= emulation->prefetchQueue.size())
+            break;
+        
+        emulation->loadResource(*emulation->prefetchQueue[index]);
+    }
+    
+    return NULL;
+}
+
+void OEEmulation::loadResource(OEResource& resource)
+{
+    switch (resource.type)
+    {
+        case OERESOURCE_DATA:
+            resource.mappedData = new OEMappedData();
+            resource.data = new OEData();
+            resource.isMapped = false;
+            resource.isRead = false;
+            
+            // Data is mapped lazily where possible, and its pages are
+            // faulted in by the components that read them; compressed zip
+            // entries are read. libzip is not thread-safe
+            if (resource.isPackagePath)
+            {
+                pthread_mutex_lock(&packageMutex);
+                
+                if (package)
+                {
+                    resource.isMapped = package->readMapped(resource.src,
+                                                            resource.mappedData);
+                    
+                    if (!resource.isMapped)
+                        resource.isRead = package->read(resource.src,
+                                                        resource.data);
+                }
+                
+                pthread_mutex_unlock(&packageMutex);
+            }
+            else
+            {
+                resource.isMapped = resource.mappedData->open(resource.src);
+                
+                if (!resource.isMapped)
+                    resource.isRead = readFile(resource.src, resource.data);
+            }
+            
+            break;
+            
+        case OERESOURCE_SOUND:
+            OESound::prefetch(resource.src);
+            
+            break;
+            
+        case OERESOURCE_IMAGE:
+            OEImage::prefetch(resource.src);
+            
+            break;
+    }
+}
+
+void OEEmulation::clearResources()
+{
+    for (OEResources::iterator i = resources.begin();
+         i != resources.end();
+         i++)
+    {
+        delete i->second.mappedData;
+        delete i->second.data;
+    }
+    
+    resources.clear();
+    
+    OESound::clearPrefetched();
+    OEImage::clearPrefetched();
+}
+
+map<string, string> OEEmulation::getPropertiesMap(string id)
+{
+    map<string, string> propertiesMap;
+    
+    propertiesMap["id"] = id;
+    propertiesMap["deviceId"] = OEGetDeviceId(id);
+    propertiesMap["resourcePath"] = resourcePath;
+    
+    return propertiesMap;
+}
+
+bool OEEmulation::hasValueProperty(string value, string propertyName)
+{
+    return (value.find("${" + propertyName + "}") != string::npos);
+}
+
+string OEEmulation::parseValueProperties(string value, map<string, string>& propertiesMap)
+{
+    size_t startIndex;
+    
+    while ((startIndex = value.find("${")) != string::npos)
+    {
+        size_t endIndex = value.find("}", startIndex);
+        if (endIndex == string::npos)
+        {
+            value = value.substr(0, startIndex);
+            break;
+        }
+        
+        string propertyName = value.substr(startIndex + 2,
+                                           endIndex - startIndex - 2);
+        string replacement;
+        
+        for (map<string, string>::iterator i = propertiesMap.begin();
+             i != propertiesMap.end();
+             i++)
+        {
+            if (i->first == propertyName)
+                replacement = i->second;
+        }
+        
+        value = value.replace(startIndex,
+                              endIndex - startIndex + 1,
+                              replacement);
+    }
+    
+    return value;
+}
+
+void OEEmulation::updateSnapshotComponents()
+{
+    snapshotComponents.clear();
+    
+    for (OEComponentsMap::iterator i = componentsMap.begin();
+         i != componentsMap.end();
+         i++)
+        snapshotComponents.push_back(i->second);
+}
+
+void OEEmulation::updateRewind()
+{
+    if (!rewindInterval ||
+        !rewindSnapshotNum)
+        return;
+    
+    if (++rewindFrameCount < rewindInterval)
+        return;
+    
+    rewindFrameCount = 0;
+    
+    rewindNextSnapshot.clear();
+    
+    if (!saveSnapshot(&rewindNextSnapshot))
+        return;
+    
+    if (rewindSnapshot.getSize() && (rewindSnapshotNum > 1))
+    {
+        // The oldest delta's storage is reused
+        OEData delta;
+        
+        if (rewindDeltas.size() >= (rewindSnapshotNum - 1))
+        {
+            delta.swap(rewindDeltas.front());
+            rewindDeltas.pop_front();
+        }
+        
+        rewindNextSnapshot.getDelta(rewindSnapshot, &delta);
+        
+        rewindDeltas.push_back(OEData());
+        rewindDeltas.back().swap(delta);
+    }
+    
+    rewindSnapshot.swap(rewindNextSnapshot);
+}
+
+// The state of a hibernated emulation is saved with the package. It starts
+// with the hash of the document it belongs to, so a document saved later
+// without hibernating invalidates it
+bool OEEmulation::saveState(OELong documentHash)
+{
+    pthread_mutex_lock(&packageMutex);
+    
+    bool success = true;
+    
+    if (hibernationCount)
+    {
+        OEInt magic = OE_STATE_MAGIC;
+        
+        stateSnapshot.clear();
+        
+        if (stateSnapshot.write(magic) &&
+            stateSnapshot.write(documentHash) &&
+            saveSnapshot(&stateSnapshot))
+        {
+            // The data must stay valid until the package is flushed
+            stateSnapshot.swap(stateData);
+            
+            success = package->write(OE_PACKAGE_STATE_PATH, &stateData);
+            
+            hasState = true;
+        }
+        else
+        {
+            logMessage("could not save state");
+            
+            stateData.clear();
+            
+            success = package->write(OE_PACKAGE_STATE_PATH, &stateData);
+        }
+        
+        stateSnapshot.clear();
+    }
+    else if (hasState)
+    {
+        stateData.clear();
+        
+        success = package->write(OE_PACKAGE_STATE_PATH, &stateData);
+    }
+    
+    pthread_mutex_unlock(&packageMutex);
+    
+    if (!success)
+        logMessage("could not write '" OE_PACKAGE_STATE_PATH "'");
+    
+    return success;
+}
+
+// Large blocks in the state are mapped, so resuming only reads the pages
+// that are touched. An emulation that does not resume starts from the
+// cached boot state, if there is one
+void OEEmulation::restoreState(OELong documentHash)
+{
+    if (package)
+    {
+        pthread_mutex_lock(&packageMutex);
+        
+        OEMappedData mappedData;
+        OEData data;
+        
+        if (package->readMapped(OE_PACKAGE_STATE_PATH, &mappedData))
+            stateSnapshot.swap(mappedData);
+        else if (package->read(OE_PACKAGE_STATE_PATH, &data))
+            stateSnapshot.swap(data);
+        
+        pthread_mutex_unlock(&packageMutex);
+    }
+    
+    hasState = (stateSnapshot.getSize() != 0);
+    
+    bool isResumed = false;
+    OEInt magic;
+    OELong hash;
+    
+    if (hasState &&
+        stateSnapshot.read(magic) &&
+        stateSnapshot.read(hash) &&
+        (magic == OE_STATE_MAGIC) &&
+        (hash == documentHash))
+    {
+        if (loadSnapshot(&stateSnapshot))
+        {
+            postNotification(this, EMULATION_DID_RESUME, NULL);
+            
+            isResumed = true;
+        }
+        else
+            logMessage("could not restore state");
+    }
+    
+    stateSnapshot.clear();
+    
+    isBootPending = false;
+    
+    if (isBootCache && !isResumed)
+    {
+        bootKey = getBootKey(documentHash);
+        
+        isBootPending = !restoreBootState();
+    }
+}
+
+// The boot state depends on the contents of the data resources, hashed
+// here as they are freed after construction. Mapped resources are keyed
+// on their file's path and modification time, and their offset and size,
+// so their pages are not faulted in
+OELong OEEmulation::getResourcesHash()
+{
+    OEData hashes;
+    
+    for (OEResources::iterator i = resources.begin();
+         i != resources.end();
+         i++)
+    {
+        OEResource& resource = i->second;
+        
+        if (resource.type != OERESOURCE_DATA)
+            continue;
+        
+        OELong hash = getOEHash(getCharVector(i->first));
+        
+        if (resource.isMapped)
+        {
+            OEMappedData *mappedData = resource.mappedData;
+            string key = (mappedData->getPath() +
+                          ":" + getString(mappedData->getOffset()) +
+                          ":" + getString(mappedData->getSize()));
+            struct stat st;
+            
+            if (!stat(mappedData->getPath().c_str(), &st))
+                key += ":" + getString((OELong) st.st_mtime);
+            
+            hash ^= getOEHash(getCharVector(key));
+        }
+        else if (resource.isRead)
+            hash ^= getOEHash(*resource.data);
+        
+        hashes.insert(hashes.end(), (OEChar *) &hash, (OEChar *) (&hash + 1));
+    }
+    
+    return getOEHash(hashes);
+}
+
+// The boot key covers the document, its data resources and the disk
+// images that are mounted. Images are keyed on their path, size and
+// modification time, so large images are not read
+OELong OEEmulation::getBootKey(OELong documentHash)
+{
+    OEData hashes;
+    
+    hashes.insert(hashes.end(), (OEChar *) &documentHash, (OEChar *) (&documentHash + 1));
+    hashes.insert(hashes.end(), (OEChar *) &bootResourcesHash, (OEChar *) (&bootResourcesHash + 1));
+    
+    const char *propertyNames[] = { "diskImage", "overlayPath" };
+    
+    for (OEComponentsMap::iterator i = componentsMap.begin();
+         i != componentsMap.end();
+         i++)
+    {
+        for (size_t j = 0; j < sizeof(propertyNames) / sizeof(propertyNames[0]); j++)
+        {
+            string path;
+            
+            if ((i->second == this) ||
+                !i->second->getValue(propertyNames[j], path) ||
+                (path == ""))
+                continue;
+            
+            string key = i->first + ":" + path;
+            struct stat st;
+            
+            if (!stat(path.c_str(), &st))
+                key += (":" + getString((OELong) st.st_size) +
+                        ":" + getString((OELong) st.st_mtime));
+            
+            OELong hash = getOEHash(getCharVector(key));
+            
+            hashes.insert(hashes.end(), (OEChar *) &hash, (OEChar *) (&hash + 1));
+        }
+    }
+    
+    return getOEHash(hashes);
+}
+
+string OEEmulation::getBootPath()
+{
+    string cachePath = getCachePath();
+    
+    if (cachePath == "")
+        return "";
+    
+    string hashString = getHexString(bootKey).substr(2);
+    
+    return (cachePath + "/" + hashString + "." OE_BOOT_PATH_EXTENSION);
+}
+
+bool OEEmulation::restoreBootState()
+{
+    string path = getBootPath();
+    
+    if (path == "")
+        return false;
+    
+    OEMappedData mappedData;
+    OEData data;
+    
+    if (mappedData.open(path))
+        stateSnapshot.swap(mappedData);
+    else if (readFile(path, &data))
+        stateSnapshot.swap(data);
+    else
+        return false;
+    
+    OEInt magic;
+    OELong key;
+    
+    bool success = (stateSnapshot.read(magic) &&
+                    stateSnapshot.read(key) &&
+                    (magic == OE_BOOT_MAGIC) &&
+                    (key == bootKey) &&
+                    loadSnapshot(&stateSnapshot));
+    
+    stateSnapshot.clear();
+    
+    return success;
+}
+
+// The boot state is written to a temporary file and renamed, as other
+// emulations may have the cached file mapped
+void OEEmulation::saveBootState()
+{
+    isBootPending = false;
+    
+    string cachePath = getCachePath();
+    string path = getBootPath();
+    string tempPath = path + ".tmp";
+    
+    OESnapshot snapshot;
+    OEInt magic = OE_BOOT_MAGIC;
+    OEData data;
+    
+    if (!snapshot.write(magic) ||
+        !snapshot.write(bootKey) ||
+        !saveSnapshot(&snapshot))
+    {
+        logMessage("could not save boot state");
+        
+        return;
+    }
+    
+    snapshot.swap(data);
+    
+    if ((!isPathValid(cachePath) && !createDirectory(cachePath)) ||
+        !writeFile(tempPath, &data) ||
+        rename(tempPath.c_str(), path.c_str()))
+        logMessage("could not write '" + path + "'");
+}
+
+// xorshift64*
+OEInt OEEmulation::getRandom()
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    
+    return (OEInt) ((randomState * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+// Canvases are host components, so the journal names them after the
+// device that constructed them
+void OEEmulation::addCanvas(OEComponent *device, OEComponent *canvas)
+{
+    if (!canvas)
+        return;
+    
+    string prefix = getId(device) + ".canvas";
+    OEInt index = 0;
+    
+    while (canvasesMap.count(prefix + getString(index)))
+        index++;
+    
+    canvasesMap[prefix + getString(index)] = canvas;
 }
 
-void OEEmulation::disposeDocument(xmlDocPtr doc)
+void OEEmulation::removeCanvas(OEComponent *canvas)
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    OEComponents::iterator first = paperCanvases.begin();
+    OEComponents::iterator last = paperCanvases.end();
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
+    paperCanvases.erase(remove(first, last, canvas), last);
+    
+    for (OEComponentsMap::iterator i = canvasesMap.begin();
+         i != canvasesMap.end();
+         i++)
     {
-        if ((getNodeName(node) == "component") ||
-            (getNodeName(node) == "device"))
+        if (i->second == canvas)
         {
-            string id = getNodeProperty(node, "id");
+            canvasesMap.erase(i);
             
-            disposeComponent(id);
+            return;
         }
     }
 }
 
-void OEEmulation::disposeDevice(string deviceId)
+string OEEmulation::getInputId(OEComponent *component)
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
-    
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
+    for (OEComponentsMap::iterator i = canvasesMap.begin();
+         i != canvasesMap.end();
+         i++)
     {
-        if ((getNodeName(node) == "component") ||
-            (getNodeName(node) == "device"))
-        {
-            string componentId = getNodeProperty(node, "id");
-            
-            if (OEGetDeviceId(componentId) == deviceId)
-                disposeComponent(componentId);
-        }
+        if (i->second == component)
+            return i->first;
     }
-}
-
-void OEEmulation::disposeComponent(string id)
-{
-    OEComponent *component = getComponent(id);
     
-    if (component)
-        component->dispose();
+    return getId(component);
 }
 
-void OEEmulation::deconfigureDocument(xmlDocPtr doc)
+OEComponent *OEEmulation::getInputComponent(string id)
 {
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
+    if (canvasesMap.count(id))
+        return canvasesMap[id];
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
-    {
-        if (getNodeName(node) == "component")
-        {
-            string id = getNodeProperty(node, "id");
-            
-            deconfigureComponent(id, node->children);
-        }
-    }
+    return getComponent(id);
 }
 
-void OEEmulation::deconfigureDevice(string deviceId)
+// Returns true when the input must be dropped
+bool OEEmulation::filterInput(OEComponent *relay, EmulationInput *input)
 {
-    set<OEComponent *> components;
+    // A boot that received input is not cached
+    isBootPending = false;
     
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
-    
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
+    switch (journalMode)
     {
-        if (getNodeName(node) == "component")
+        case OEJOURNAL_RECORD:
         {
-            string componentId = getNodeProperty(node, "id");
+            OEJournalEntry entry;
             
-            for(xmlNodePtr propertyNode = node->children;
-                propertyNode;
-                propertyNode = propertyNode->next)
+            entry.cycles = 0;
+            journalClock->postMessage(this, CONTROLBUS_GET_CYCLES, &entry.cycles);
+            
+            entry.relayId = getId(relay);
+            entry.senderId = getInputId(input->sender);
+            entry.notification = input->notification;
+            entry.type = input->type;
+            
+            if (input->type == EMULATION_INPUT_STRING)
             {
-                if (getNodeName(propertyNode) == "property")
-                {
-                    string ref = getNodeProperty(propertyNode, "ref");
-                    
-                    if (ref == "")
-                        continue;
-                    
-                    if ((OEGetDeviceId(componentId) == deviceId) ||
-                        (OEGetDeviceId(ref) == deviceId))
-                    {
-                        OEComponent *component = getComponent(componentId);
-                        if (component)
-                        {
-                            string name = getNodeProperty(propertyNode, "name");
-                            
-                            component->setRef(name, NULL);
-                            
-                            if ((OEGetDeviceId(componentId) != deviceId) &&
-                                (OEGetDeviceId(ref) == deviceId))
-                                components.insert(component);
-                        }
-                    }
-                }
+                wstring *value = (wstring *)input->data;
+                OEChar *p = (OEChar *)value->data();
+                
+                entry.data.assign(p, p + value->size() * sizeof(wchar_t));
             }
+            else
+            {
+                OEChar *p = (OEChar *)input->data;
+                
+                entry.data.assign(p, p + input->size);
+            }
+            
+            journal.push_back(entry);
+            
+            return false;
         }
+        case OEJOURNAL_REPLAY:
+            return !isJournalInjecting;
+            
+        default:
+            return false;
     }
-    
-    for (set<OEComponent *>::iterator i = components.begin();
-         i != components.end();
-         i++)
-        (*i)->update();
 }
 
-void OEEmulation::deconfigureComponent(string id, xmlNodePtr children)
+// Delivers the input that is due, and schedules a timer for the next
+void OEEmulation::replayInput()
 {
-    OEComponent *component = getComponent(id);
+    OELong cycles = 0;
     
-    if (!component)
-        return;
+    journalClock->postMessage(this, CONTROLBUS_GET_CYCLES, &cycles);
     
-    for(xmlNodePtr node = children;
-        node;
-        node = node->next)
+    while ((journalIndex < journal.size()) &&
+           (journal[journalIndex].cycles <= cycles))
     {
-        if (getNodeName(node) == "property")
+        OEJournalEntry& entry = journal[journalIndex++];
+        
+        OEComponent *relay = getComponent(entry.relayId);
+        OEComponent *sender = getInputComponent(entry.senderId);
+        
+        if (!relay || !sender)
         {
-            string name = getNodeProperty(node, "name");
+            logMessage("could not replay input for '" + entry.relayId + "'");
             
-            if (hasNodeProperty(node, "ref"))
-                component->setRef(name, NULL);
+            continue;
         }
-    }
-}
-
-void OEEmulation::destroyDocument(xmlDocPtr doc)
-{
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
-    
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
-    {
-        if ((getNodeName(node) == "component") ||
-            (getNodeName(node) == "device"))
+        
+        isJournalInjecting = true;
+        
+        if (entry.type == EMULATION_INPUT_STRING)
         {
-            string componentId = getNodeProperty(node, "id");
+            wstring value;
             
-            destroyComponent(componentId, node->children);
+            if (entry.data.size())
+                value.assign((wchar_t *)&entry.data.front(),
+                             entry.data.size() / sizeof(wchar_t));
+            
+            relay->notify(sender, entry.notification, &value);
         }
+        else
+            relay->notify(sender, entry.notification,
+                          entry.data.size() ? &entry.data.front() : NULL);
+        
+        isJournalInjecting = false;
     }
-}
-
-void OEEmulation::destroyDevice(string deviceId)
-{
-    xmlNodePtr rootNode = xmlDocGetRootElement(doc);
     
-    for(xmlNodePtr node = rootNode->children;
-        node;
-        node = node->next)
+    if (journalIndex < journal.size())
     {
-        if ((getNodeName(node) == "component") ||
-            (getNodeName(node) == "device"))
-        {
-            string componentId = getNodeProperty(node, "id");
-            
-            if (OEGetDeviceId(componentId) == deviceId)
-                destroyComponent(componentId, node->children);
-        }
+        ControlBusTimer timer = { (OESLong) (journal[journalIndex].cycles - cycles), 0 };
+        
+        journalClock->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
     }
+    else
+        journalMode = OEJOURNAL_OFF;
 }
 
-void OEEmulation::destroyComponent(string id, xmlNodePtr children)
+// After the last control bus ends a frame, the emulation runs ahead with
+// the current input, so the canvases show a later image, and is restored.
+// Audio stays on the real timeline, as components roll back their samples
+void OEEmulation::runAhead(AudioBuffer *buffer)
 {
-    OEComponent *component = getComponent(id);
+    if (!isRunAheadSafe())
+        return;
     
-    if (!component)
+    runAheadSnapshot.clear();
+    
+    if (!saveSnapshot(&runAheadSnapshot))
+    {
+        logMessage("could not run ahead");
+        
+        runAheadFrameNum = 0;
+        
         return;
+    }
     
-    delete component;
+    isRunningAhead = true;
     
-    removeComponent(id);
-}
-
-bool OEEmulation::hasValueProperty(string value, string propertyName)
-{
-    return (value.find("${" + propertyName + "}") != string::npos);
+    for (OEInt i = 0; i < runAheadFrameNum; i++)
+    {
+        for (OEComponents::iterator j = controlBuses.begin();
+             j != controlBuses.end();
+             j++)
+            (*j)->postMessage(this, CONTROLBUS_RUN_FRAME, buffer);
+    }
+    
+    isRunningAhead = false;
+    
+    runAheadSnapshot.rewind();
+    
+    if (!loadSnapshot(&runAheadSnapshot))
+    {
+        logMessage("could not restore emulation after running ahead");
+        
+        runAheadFrameNum = 0;
+    }
 }
 
-string OEEmulation::parseValueProperties(string value, map<string, string>& propertiesMap)
+// Speculative frames can't take back what reached the host, such as
+// writes to a mounted image or printed paper. Run-ahead is suspended
+// while any such device is attached
+bool OEEmulation::isRunAheadSafe()
 {
-    size_t startIndex;
+    if (paperCanvases.size())
+        return false;
     
-    while ((startIndex = value.find("${")) != string::npos)
+    OEIds deviceIds = getDeviceIds();
+    
+    for (OEIds::iterator i = deviceIds.begin();
+         i != deviceIds.end();
+         i++)
     {
-        size_t endIndex = value.find("}", startIndex);
-        if (endIndex == string::npos)
-        {
-            value = value.substr(0, startIndex);
-            break;
-        }
+        OEComponent *device = getComponent(*i);
+        OEComponents storages;
         
-        string propertyName = value.substr(startIndex + 2,
-                                           endIndex - startIndex - 2);
-        string replacement;
+        if (!device)
+            continue;
         
-        for (map<string, string>::iterator i = propertiesMap.begin();
-             i != propertiesMap.end();
-             i++)
+        device->postMessage(this, DEVICE_GET_STORAGES, &storages);
+        
+        for (OEComponents::iterator j = storages.begin();
+             j != storages.end();
+             j++)
         {
-            if (i->first == propertyName)
-                replacement = i->second;
+            string path;
+            
+            if ((*j)->postMessage(this, STORAGE_GET_MOUNTPATH, &path) &&
+                (path != ""))
+                return false;
         }
-        
-        value = value.replace(startIndex,
-                              endIndex - startIndex + 1,
-                              replacement);
     }
     
-    return value;
+    return true;
 }
 
 bool OEEmulation::postMessage(OEComponent *sender, int message, void *data)
@@ -730,30 +2094,47 @@ bool OEEmulation::postMessage(OEComponent *sender, int message, void *data)
             if (!constructCanvas)
                 return false;
             
-            return (*((OEComponent **)data) = constructCanvas(userData,
-                                                              sender,
-                                                              OECANVAS_DISPLAY)) != NULL;
+            *((OEComponent **)data) = constructCanvas(userData,
+                                                      sender,
+                                                      OECANVAS_DISPLAY);
+            
+            addCanvas(sender, *((OEComponent **)data));
+            
+            return (*((OEComponent **)data) != NULL);
             
         case EMULATION_CONSTRUCT_PAPERCANVAS:
             if (!constructCanvas)
                 return false;
             
-            return (*((OEComponent **)data) = constructCanvas(userData,
-                                                              sender,
-                                                              OECANVAS_PAPER)) != NULL;
+            *((OEComponent **)data) = constructCanvas(userData,
+                                                      sender,
+                                                      OECANVAS_PAPER);
+            
+            addCanvas(sender, *((OEComponent **)data));
+            
+            if (*((OEComponent **)data))
+                paperCanvases.push_back(*((OEComponent **)data));
+            
+            return (*((OEComponent **)data) != NULL);
             
         case EMULATION_CONSTRUCT_OPENGLCANVAS:
             if (!constructCanvas)
                 return false;
             
-            return (*((OEComponent **)data) = constructCanvas(userData,
-                                                              sender,
-                                                              OECANVAS_OPENGL)) != NULL;
+            *((OEComponent **)data) = constructCanvas(userData,
+                                                      sender,
+                                                      OECANVAS_OPENGL);
+            
+            addCanvas(sender, *((OEComponent **)data));
+            
+            return (*((OEComponent **)data) != NULL);
             
         case EMULATION_DESTROY_CANVAS:
             if (!destroyCanvas)
                 return false;
             
+            removeCanvas(*((OEComponent **)data));
+            
             destroyCanvas(userData, *((OEComponent **)data));
             
             *((OEComponent **)data) = NULL;
@@ -779,8 +2160,85 @@ bool OEEmulation::postMessage(OEComponent *sender, int message, void *data)
             
             activityCount--;
             
+            return true;
+            
+        case EMULATION_ASSERT_HIBERNATION:
+            hibernationCount++;
+            
+            return true;
+            
+        case EMULATION_CLEAR_HIBERNATION:
+            if (hibernationCount <= 0)
+                return false;
+            
+            hibernationCount--;
+            
+            return true;
+            
+        case EMULATION_ADD_CONTROLBUS:
+            controlBuses.push_back(sender);
+            
+            return true;
+            
+        case EMULATION_REMOVE_CONTROLBUS:
+        {
+            if (sender == journalClock)
+            {
+                stopJournal();
+                
+                journalClock = NULL;
+            }
+            
+            OEComponents::iterator first = controlBuses.begin();
+            OEComponents::iterator last = controlBuses.end();
+            
+            controlBuses.erase(remove(first, last, sender), last);
+            
+            return true;
+        }
+        case EMULATION_END_FRAME:
+            updateRewind();
+            
+            if (runAheadFrameNum &&
+                controlBuses.size() &&
+                (sender == controlBuses.back()))
+                runAhead((AudioBuffer *)data);
+            
+            return true;
+            
+        case EMULATION_END_BOOT:
+            if (isBootPending)
+                saveBootState();
+            
+            return true;
+            
+        case EMULATION_FILTER_INPUT:
+            return filterInput(sender, (EmulationInput *)data);
+            
+        case EMULATION_GET_RANDOM:
+            *((OEInt *)data) = getRandom();
+            
             return true;
     }
     
     return false;
 }
+
+void OEEmulation::notify(OEComponent *sender, int notification, void *data)
+{
+    if ((sender == journalClock) &&
+        (notification == CONTROLBUS_TIMER_DID_FIRE) &&
+        (journalMode == OEJOURNAL_REPLAY) &&
+        !isRunningAhead)
+        replayInput();
+}
+
+bool OEEmulation::serialize(OESnapshot *snapshot)
+{
+    return snapshot->write(randomState);
+}
+
+bool OEEmulation::deserialize(OESnapshot *snapshot)
+{
+    return snapshot->read(randomState);
+}
@@ -12,11 +12,15 @@
 #define _OEEMULATION_H
 
 #include <vector>
+#include <deque>
+
+#include <pthread.h>
 
 #include "OEComponent.h"
 #include "OEDocument.h"
 
 #include "EmulationInterface.h"
+#include "AudioInterface.h"
 
 using namespace std;
 
@@ -35,6 +39,71 @@ typedef void (*EmulationDestroyCanvas)(void *userData, OEComponent *canvas);
 
 typedef map<string, OEComponent *> OEComponentsMap;
 
+#define OE_PREFETCH_THREADNUM 4
+
+typedef enum
+{
+    OERESOURCE_DATA,
+    OERESOURCE_SOUND,
+    OERESOURCE_IMAGE,
+} OEResourceType;
+
+typedef struct
+{
+    OEResourceType type;
+    string src;
+    bool isPackagePath;
+    OEMappedData *mappedData;
+    OEData *data;
+    bool isMapped;
+    bool isRead;
+} OEResource;
+
+typedef map<string, OEResource> OEResources;
+
+#define OE_SNAPSHOT_MAGIC 0x4f45534e
+#define OE_STATE_MAGIC 0x4f455354
+
+#define OE_PACKAGE_STATE_PATH "state.bin"
+
+#define OE_BOOT_MAGIC 0x4f45424f
+#define OE_BOOT_PATH_EXTENSION "oeboot"
+
+#define OE_JOURNAL_MAGIC 0x4f454a4e
+#define OE_RANDOM_SEED 0x9e3779b97f4a7c15ULL
+
+typedef enum
+{
+    OEJOURNAL_OFF,
+    OEJOURNAL_RECORD,
+    OEJOURNAL_REPLAY,
+} OEJournalMode;
+
+typedef struct
+{
+    OELong cycles;
+    string relayId;
+    string senderId;
+    OEInt notification;
+    OEInt type;
+    OEData data;
+} OEJournalEntry;
+
+typedef vector<OEJournalEntry> OEJournal;
+
+#define OE_APPLESINGLE_MAGIC 0x00051600
+#define OE_APPLESINGLE_DATAFORK 1
+#define OE_APPLESINGLE_PRODOSINFO 11
+
+#define OE_PROGRAM_ADDRESSSPACE 0x10000
+
+typedef enum
+{
+    OEPROGRAM_BINARY,
+    OEPROGRAM_APPLESINGLE,
+    OEPROGRAM_DOS33BINARY,
+} OEProgramFormat;
+
 class OEEmulation : public OEComponent, public OEDocument
 {
 public:
@@ -54,11 +123,43 @@ public:
     
     bool isActive();
     
+    bool saveSnapshot(OESnapshot *snapshot);
+    bool loadSnapshot(OESnapshot *snapshot);
+    
+    void setRewind(OEInt interval, OEInt snapshotNum);
+    OEInt getRewindSnapshotNum();
+    bool rewind(OEInt steps);
+    
+    void setRunAhead(OEInt frameNum);
+    OEInt getRunAhead();
+    
+    void setRandomSeed(OELong seed);
+    
+    void setBootCache(bool value);
+    
+    void setProfile(bool value);
+    
+    bool startRecording();
+    bool startReplay();
+    void stopJournal();
+    OEJournalMode getJournalMode();
+    bool saveJournal(string path);
+    bool loadJournal(string path);
+    
+    bool loadProgram(string cpuId, string path, OEProgramFormat format,
+                     OESLong address, bool start);
+    
     bool postMessage(OEComponent *sender, int message, void *data);
     
+    void notify(OEComponent *sender, int notification, void *data);
+    
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 private:
     string resourcePath;
     OEComponentsMap componentsMap;
+    OEComponentInfos compiledInfos;
     
     EmulationDidUpdate didUpdate;
     EmulationConstructCanvas constructCanvas;
@@ -66,32 +167,110 @@ private:
     void *userData;
     
     OEInt activityCount;
+    OEInt hibernationCount;
+    
+    OEResources resources;
+    vector<OEResource *> prefetchQueue;
+    size_t prefetchIndex;
+    pthread_mutex_t prefetchMutex;
+    pthread_mutex_t packageMutex;
+    
+    OEComponents snapshotComponents;
+    
+    OEInt rewindInterval;
+    OEInt rewindSnapshotNum;
+    OEInt rewindFrameCount;
+    OESnapshot rewindSnapshot;
+    OESnapshot rewindNextSnapshot;
+    deque<OEData> rewindDeltas;
+    
+    bool hasState;
+    OESnapshot stateSnapshot;
+    OEData stateData;
+    
+    bool isBootCache;
+    bool isBootPending;
+    OELong bootResourcesHash;
+    OELong bootKey;
     
-    bool constructDocument(xmlDocPtr doc);
+    bool isProfile;
+    
+    OEInt runAheadFrameNum;
+    bool isRunningAhead;
+    OESnapshot runAheadSnapshot;
+    
+    OELong randomState;
+    
+    OEComponents controlBuses;
+    OEComponentsMap canvasesMap;
+    OEComponents paperCanvases;
+    
+    OEJournalMode journalMode;
+    OEComponent *journalClock;
+    string journalClockId;
+    OESnapshot journalSnapshot;
+    OEJournal journal;
+    size_t journalIndex;
+    bool isJournalInjecting;
+    
+    bool constructDocument(OEComponentInfos& componentInfos);
     bool constructDevice(string deviceId);
     bool constructComponent(string id, string className);
-    bool configureDocument(xmlDocPtr doc);
-    bool configureDevice(string deviceId,
-                         string label, string image,
-                         xmlNodePtr children);
+    bool configureDocument(OEComponentInfos& componentInfos);
+    bool configureDevice(OEComponentInfo& componentInfo);
     bool configureInlets(OEInletMap& inletMap);
-    bool configureComponent(string id, xmlNodePtr children);
-    bool initDocument(xmlDocPtr doc);
+    bool configureComponent(OEComponentInfo& componentInfo);
+    bool initDocument(OEComponentInfos& componentInfos);
     bool initComponent(string id);
     bool reconfigureDocument(xmlDocPtr doc);
     bool reconfigureComponent(string id, xmlNodePtr children);
+    void flushStorages();
     void disposeDocument(xmlDocPtr doc);
+    void disposeDocument(OEComponentInfos& componentInfos);
     void disposeDevice(string deviceId);
     void disposeComponent(string id);
     void deconfigureDocument(xmlDocPtr doc);
+    void deconfigureDocument(OEComponentInfos& componentInfos);
     void deconfigureDevice(string deviceId);
     void deconfigureComponent(string id, xmlNodePtr children);
     void destroyDocument(xmlDocPtr doc);
+    void destroyDocument(OEComponentInfos& componentInfos);
     void destroyDevice(string deviceId);
     void destroyComponent(string id, xmlNodePtr children);
     
+    void prefetchResources(OEComponentInfos& componentInfos);
+    static void *prefetchResource(void *context);
+    void loadResource(OEResource& resource);
+    void clearResources();
+    
+    map<string, string> getPropertiesMap(string id);
     bool hasValueProperty(string value, string propertyName);
     string parseValueProperties(string value, map<string, string>& propertiesMap);
+    
+    void updateSnapshotComponents();
+    void updateRewind();
+    void runAhead(AudioBuffer *buffer);
+    bool isRunAheadSafe();
+    
+    bool saveState(OELong documentHash);
+    void restoreState(OELong documentHash);
+    
+    OELong getResourcesHash();
+    OELong getBootKey(OELong documentHash);
+    string getBootPath();
+    bool restoreBootState();
+    void saveBootState();
+    
+    OEInt getRandom();
+    
+    void addCanvas(OEComponent *device, OEComponent *canvas);
+    void removeCanvas(OEComponent *canvas);
+    string getInputId(OEComponent *component);
+    OEComponent *getInputComponent(string id);
+    bool filterInput(OEComponent *relay, EmulationInput *input);
+    void replayInput();
+    
+    bool decodeProgram(OEData& data, OEProgramFormat format, OESLong& address);
 };
 
 #endif
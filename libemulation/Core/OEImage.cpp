@@ -8,12 +8,19 @@
  * Implements an image type
  */
 
+#include <map>
+
 #include <png.h>
+#include <pthread.h>
 
 #include "OEImage.h"
 
 #define PNGSIG_BYTENUM 4
 
+// Images decoded ahead of time by prefetch(), keyed by path
+static pthread_mutex_t oeImagePrefetchMutex = PTHREAD_MUTEX_INITIALIZER;
+static map<string, OEImage> oeImagePrefetched;
+
 OEImage::OEImage()
 {
     init();
@@ -406,6 +413,56 @@ void OEImage::blend(OEImage& image, OEPoint origin, OEBlendMode mode)
 }
 
 bool OEImage::load(string path)
+{
+    bool prefetched = false;
+    
+    pthread_mutex_lock(&oeImagePrefetchMutex);
+    
+    map<string, OEImage>::iterator i = oeImagePrefetched.find(path);
+    
+    if (i != oeImagePrefetched.end())
+    {
+        *this = i->second;
+        
+        prefetched = true;
+    }
+    
+    pthread_mutex_unlock(&oeImagePrefetchMutex);
+    
+    if (prefetched)
+        return true;
+    
+    return loadFile(path);
+}
+
+// Decodes an image so a later load() of the same path only copies it.
+// Safe to call from several threads
+bool OEImage::prefetch(string path)
+{
+    OEImage image;
+    
+    if (!image.loadFile(path))
+        return false;
+    
+    pthread_mutex_lock(&oeImagePrefetchMutex);
+    
+    oeImagePrefetched[path] = image;
+    
+    pthread_mutex_unlock(&oeImagePrefetchMutex);
+    
+    return true;
+}
+
+void OEImage::clearPrefetched()
+{
+    pthread_mutex_lock(&oeImagePrefetchMutex);
+    
+    oeImagePrefetched.clear();
+    
+    pthread_mutex_unlock(&oeImagePrefetchMutex);
+}
+
+bool OEImage::loadFile(string path)
 {
     bool success = false;
     
@@ -312,6 +312,9 @@ public:
     bool load(string path);
     bool load(OEData& data);
     
+    static bool prefetch(string path);
+    static void clearPrefetched();
+    
 private:
     OEImageFormat format;
     OESize size;
@@ -326,6 +329,7 @@ private:
     vector<bool> phaseAlternation;
     
     void init();
+    bool loadFile(string path);
     bool validatePNGHeader(FILE *fp);
 };
 
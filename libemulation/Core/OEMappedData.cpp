@@ -0,0 +1,154 @@
+/**
+ * libemulation
+ * OEMappedData
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a lazily loaded, memory-mapped data view
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "OEMappedData.h"
+
+OEMappedData::OEMappedData()
+{
+    mapData = NULL;
+    mapSize = 0;
+    
+    data = NULL;
+    size = 0;
+    
+    offset = 0;
+}
+
+OEMappedData::~OEMappedData()
+{
+    close();
+}
+
+bool OEMappedData::open(const string& path)
+{
+    return open(path, 0, 0);
+}
+
+bool OEMappedData::open(const string& path, OELong offset, OELong size)
+{
+    close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    
+    if (fd < 0)
+        return false;
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) ||
+        (offset > (OELong) st.st_size))
+    {
+        ::close(fd);
+        
+        return false;
+    }
+    
+    // A size of zero maps up to the end of the file
+    if (!size)
+        size = (OELong) st.st_size - offset;
+    
+    if (!size ||
+        ((offset + size) > (OELong) st.st_size))
+    {
+        ::close(fd);
+        
+        return false;
+    }
+    
+    // mmap offsets must be page aligned
+    OELong pageSize = (OELong) sysconf(_SC_PAGESIZE);
+    OELong mapOffset = offset - (offset % pageSize);
+    size_t theMapSize = (size_t) (offset - mapOffset + size);
+    
+    void *theMapData = mmap(NULL, theMapSize,
+                            PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                            fd, (off_t) mapOffset);
+    
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    
+    if (theMapData == MAP_FAILED)
+        return false;
+    
+    mapData = theMapData;
+    mapSize = theMapSize;
+    
+    data = (OEChar *) mapData + (offset - mapOffset);
+    this->size = size;
+    
+    this->path = path;
+    this->offset = offset;
+    
+    return true;
+}
+
+bool OEMappedData::isOpen()
+{
+    return (mapData != NULL);
+}
+
+void OEMappedData::close()
+{
+    if (mapData)
+        munmap(mapData, mapSize);
+    
+    mapData = NULL;
+    mapSize = 0;
+    
+    data = NULL;
+    size = 0;
+    
+    path.clear();
+    offset = 0;
+}
+
+OEChar *OEMappedData::getData()
+{
+    return data;
+}
+
+OELong OEMappedData::getSize()
+{
+    return size;
+}
+
+string OEMappedData::getPath()
+{
+    return path;
+}
+
+OELong OEMappedData::getOffset()
+{
+    return offset;
+}
+
+bool OEMappedData::read(OEData *data)
+{
+    if (!mapData)
+        return false;
+    
+    data->assign(this->data, this->data + size);
+    
+    return true;
+}
+
+void OEMappedData::swap(OEMappedData& other)
+{
+    std::swap(mapData, other.mapData);
+    std::swap(mapSize, other.mapSize);
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    path.swap(other.path);
+    std::swap(offset, other.offset);
+}
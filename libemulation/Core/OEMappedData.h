@@ -0,0 +1,56 @@
+/**
+ * libemulation
+ * OEMappedData
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a lazily loaded, memory-mapped data view
+ */
+
+#ifndef _OEMAPPEDDATA_H
+#define _OEMAPPEDDATA_H
+
+#include "OECommon.h"
+
+// Notes:
+// * The view is mapped copy-on-write: it may be written through getData(),
+//   but the file is never modified.
+// * read() materializes the view into an OEData vector.
+// * swap() transfers the view, like OEData::swap().
+// * getPath() and getOffset() locate the view in its file, so parts of it
+//   can be mapped on their own.
+
+class OEMappedData
+{
+public:
+    OEMappedData();
+    ~OEMappedData();
+    
+    bool open(const string& path);
+    bool open(const string& path, OELong offset, OELong size);
+    bool isOpen();
+    void close();
+    
+    OEChar *getData();
+    OELong getSize();
+    string getPath();
+    OELong getOffset();
+    
+    bool read(OEData *data);
+    void swap(OEMappedData& other);
+    
+private:
+    void *mapData;
+    size_t mapSize;
+    
+    OEChar *data;
+    OELong size;
+    
+    string path;
+    OELong offset;
+    
+    OEMappedData(const OEMappedData&);
+    OEMappedData& operator=(const OEMappedData&);
+};
+
+#endif
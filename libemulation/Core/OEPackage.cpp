@@ -9,19 +9,42 @@
  */
 
 #include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
 
 #include "OEPackage.h"
 
+static OEShort getOEShortLE(const OEChar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static OEInt getOEIntLE(const OEChar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((OEInt) p[3] << 24);
+}
+
 OEPackage::OEPackage()
 {
     is_open = false;
     
     zip = NULL;
+    
+    zipModified = false;
+    zipIndexed = false;
+    
+    hashesModified = false;
+    
+    pendingWriteIndex = 0;
+    pthread_mutex_init(&pendingWriteMutex, NULL);
 }
 
 OEPackage::~OEPackage()
 {
     close();
+    
+    pthread_mutex_destroy(&pendingWriteMutex);
 }
 
 bool OEPackage::open(const string& path)
@@ -48,6 +71,9 @@ bool OEPackage::open(const string& path)
         is_open = (zip != NULL);
     }
     
+    if (is_open)
+        readHashes();
+    
     return is_open;
 }
 
@@ -58,12 +84,23 @@ bool OEPackage::isOpen()
 
 void OEPackage::close()
 {
+    if (is_open)
+        flush();
+    
     is_open = false;
     
     if (zip)
         zip_close(zip);
     
     zip = NULL;
+    
+    zipModified = false;
+    zipIndexed = false;
+    zipEntries.clear();
+    
+    hashes.clear();
+    hashesModified = false;
+    hashesData.clear();
 }
 
 bool OEPackage::read(const string& packagePath, OEData *data)
@@ -100,39 +137,383 @@ bool OEPackage::read(const string& packagePath, OEData *data)
     return !error;
 }
 
-bool OEPackage::write(const string& packagePath, OEData *data)
+bool OEPackage::readMapped(const string& packagePath, OEMappedData *data)
 {
-    bool error = true;
+    if (!is_open)
+        return false;
     
+    if (zip)
+    {
+        // Pending changes are only in libzip's memory until the zip is closed
+        if (zipModified)
+            return false;
+        
+        if (!zipIndexed)
+            indexZip();
+        
+        if (!zipEntries.count(packagePath))
+            return false;
+        
+        OEPackageEntry& entry = zipEntries[packagePath];
+        
+        return data->open(path, entry.offset, entry.size);
+    }
+    else
+    {
+        string filePath = path + PATH_SEPARATOR + packagePath;
+        
+        return data->open(filePath);
+    }
+}
+
+bool OEPackage::write(const string& packagePath, OEData *data)
+{
     if (!is_open)
         return false;
     
+    OEPackageHash entryHash;
+    entryHash.hash = getOEHash(*data);
+    entryHash.size = data->size();
+    
+    // Skip unchanged data
+    if (hashes.count(packagePath))
+    {
+        OEPackageHash& storedHash = hashes[packagePath];
+        
+        if ((storedHash.hash == entryHash.hash) &&
+            (storedHash.size == entryHash.size) &&
+            hasEntry(packagePath, entryHash.size))
+            return true;
+    }
+    
     if (zip)
     {
-        struct zip_source *zipSource = NULL;
+        if (!writeZipEntry(packagePath, data))
+            return false;
+    }
+    else
+    {
+        OEPackageWrite pendingWrite;
         
-        if ((zipSource = zip_source_buffer(zip,
-                                           &data->front(), data->size(),
-                                           0)) != NULL)
+        pendingWrite.packagePath = packagePath;
+        pendingWrite.data = data;
+        pendingWrite.error = false;
+        
+        pendingWrites.push_back(pendingWrite);
+    }
+    
+    hashes[packagePath] = entryHash;
+    hashesModified = true;
+    
+    return true;
+}
+
+bool OEPackage::flush()
+{
+    if (!is_open)
+        return false;
+    
+    bool error = false;
+    
+    if (pendingWrites.size())
+    {
+        pendingWriteIndex = 0;
+        
+        pthread_t threads[OE_PACKAGE_WRITE_THREADNUM];
+        size_t threadNum = 0;
+        
+        while ((threadNum < OE_PACKAGE_WRITE_THREADNUM) &&
+               (threadNum < pendingWrites.size() - 1))
         {
-            int index;
+            if (pthread_create(&threads[threadNum], NULL, writePending, this))
+                break;
             
-            if ((index = zip_name_locate(zip, packagePath.c_str(), 0)) == -1)
-                error = (zip_add(zip, packagePath.c_str(), zipSource) == -1);
-            else
-                error = (zip_replace(zip, index, zipSource) == -1);
-            
-            zip_source_free(zipSource);
+            threadNum++;
+        }
+        
+        writePending(this);
+        
+        for (size_t i = 0; i < threadNum; i++)
+            pthread_join(threads[i], NULL);
+        
+        for (vector<OEPackageWrite>::iterator i = pendingWrites.begin();
+             i != pendingWrites.end();
+             i++)
+        {
+            if (i->error)
+            {
+                hashes.erase(i->packagePath);
+                
+                error = true;
+            }
         }
+        
+        pendingWrites.clear();
+    }
+    
+    if (hashesModified)
+        error |= !writeHashes();
+    
+    return !error;
+}
+
+// Reads the zip central directory, recording where the data of each
+// stored (uncompressed, unencrypted) entry begins in the archive file
+void OEPackage::indexZip()
+{
+    zipIndexed = true;
+    
+    ifstream file(path.c_str(), ios::binary);
+    
+    if (!file.is_open())
+        return;
+    
+    file.seekg(0, ios::end);
+    OELong fileSize = (OELong) file.tellg();
+    
+    // Find the end of central directory record, which is followed by
+    // an up to 64 kB comment
+    OELong tailSize = fileSize < 0x10000 + 22 ? fileSize : 0x10000 + 22;
+    
+    if (tailSize < 22)
+        return;
+    
+    OEData tail((size_t) tailSize);
+    
+    file.seekg((streamoff) (fileSize - tailSize), ios::beg);
+    file.read((char *) &tail.front(), tail.size());
+    
+    if (!file.good())
+        return;
+    
+    OELong eocd = tailSize - 22;
+    
+    while (getOEIntLE(&tail[(size_t) eocd]) != 0x06054b50)
+    {
+        if (!eocd)
+            return;
+        
+        eocd--;
+    }
+    
+    OEInt entryNum = getOEShortLE(&tail[(size_t) eocd + 10]);
+    OELong directorySize = getOEIntLE(&tail[(size_t) eocd + 12]);
+    OELong directoryOffset = getOEIntLE(&tail[(size_t) eocd + 16]);
+    
+    if ((directoryOffset + directorySize) > fileSize)
+        return;
+    
+    if (!directorySize)
+        return;
+    
+    OEData directory((size_t) directorySize);
+    
+    file.seekg((streamoff) directoryOffset, ios::beg);
+    file.read((char *) &directory.front(), directory.size());
+    
+    if (!file.good())
+        return;
+    
+    size_t pos = 0;
+    
+    for (OEInt i = 0; i < entryNum; i++)
+    {
+        if (((pos + 46) > directory.size()) ||
+            (getOEIntLE(&directory[pos]) != 0x02014b50))
+            break;
+        
+        OEShort flags = getOEShortLE(&directory[pos + 8]);
+        OEShort method = getOEShortLE(&directory[pos + 10]);
+        OELong compressedSize = getOEIntLE(&directory[pos + 20]);
+        OELong size = getOEIntLE(&directory[pos + 24]);
+        OEShort nameSize = getOEShortLE(&directory[pos + 28]);
+        OEShort extraSize = getOEShortLE(&directory[pos + 30]);
+        OEShort commentSize = getOEShortLE(&directory[pos + 32]);
+        OELong headerOffset = getOEIntLE(&directory[pos + 42]);
+        
+        if ((pos + 46 + nameSize) > directory.size())
+            break;
+        
+        string name((char *) &directory[pos + 46], nameSize);
+        
+        pos += 46 + nameSize + extraSize + commentSize;
+        
+        // Skip compressed, encrypted and ZIP64 entries
+        if ((method != ZIP_CM_STORE) ||
+            (flags & 0x1) ||
+            (compressedSize != size) ||
+            (size == 0xffffffff) ||
+            (headerOffset == 0xffffffff))
+            continue;
+        
+        // The local header's extra field may differ from the central one
+        OEChar header[30];
+        
+        file.seekg((streamoff) headerOffset, ios::beg);
+        file.read((char *) header, sizeof(header));
+        
+        if (!file.good() ||
+            (getOEIntLE(header) != 0x04034b50))
+            continue;
+        
+        OEPackageEntry entry;
+        
+        entry.offset = (headerOffset + sizeof(header) +
+                        getOEShortLE(header + 26) + getOEShortLE(header + 28));
+        entry.size = size;
+        
+        if ((entry.offset + entry.size) <= fileSize)
+            zipEntries[name] = entry;
+    }
+}
+
+void OEPackage::readHashes()
+{
+    OEData data;
+    
+    if (!read(OE_PACKAGE_HASHES_PATH, &data))
+        return;
+    
+    string line;
+    stringstream ss(string(data.begin(), data.end()));
+    
+    // Each line holds the hash, the size and the path of an entry
+    while (getline(ss, line))
+    {
+        stringstream lineStream(line);
+        
+        string hash;
+        OEPackageHash entryHash;
+        string packagePath;
+        
+        lineStream >> hash >> entryHash.size;
+        lineStream.ignore(1);
+        getline(lineStream, packagePath);
+        
+        if (lineStream.fail() || (packagePath == ""))
+            continue;
+        
+        entryHash.hash = getOELong("0x" + hash);
+        
+        hashes[packagePath] = entryHash;
+    }
+}
+
+bool OEPackage::writeHashes()
+{
+    stringstream ss;
+    
+    for (map<string, OEPackageHash>::iterator i = hashes.begin();
+         i != hashes.end();
+         i++)
+        ss << getHexString(i->second.hash).substr(2) << " "
+        << i->second.size << " "
+        << i->first << endl;
+    
+    string value = ss.str();
+    
+    // libzip reads the buffer when the zip is closed
+    hashesData.assign(value.begin(), value.end());
+    hashesModified = false;
+    
+    if (zip)
+        return writeZipEntry(OE_PACKAGE_HASHES_PATH, &hashesData);
+    else
+        return writeFileEntry(OE_PACKAGE_HASHES_PATH, &hashesData);
+}
+
+bool OEPackage::hasEntry(const string& packagePath, OELong size)
+{
+    if (zip)
+    {
+        struct zip_stat zipStat;
+        
+        return ((zip_stat(zip, packagePath.c_str(), 0, &zipStat) == 0) &&
+                (zipStat.size == size));
     }
     else
     {
         string filePath = path + PATH_SEPARATOR + packagePath;
         
-        error = !writeFile(filePath, data);
+        struct stat st;
+        
+        return ((stat(filePath.c_str(), &st) == 0) &&
+                ((OELong) st.st_size == size));
     }
+}
+
+bool OEPackage::writeZipEntry(const string& packagePath, OEData *data)
+{
+    struct zip_source *zipSource;
     
-    return !error;
+    if ((zipSource = zip_source_buffer(zip,
+                                       data->size() ? &data->front() : NULL,
+                                       data->size(),
+                                       0)) == NULL)
+        return false;
+    
+    int index;
+    
+    if ((index = zip_name_locate(zip, packagePath.c_str(), 0)) == -1)
+        index = zip_add(zip, packagePath.c_str(), zipSource);
+    else if (zip_replace(zip, index, zipSource) == -1)
+        index = -1;
+    
+    // libzip owns the source once it was added
+    if (index == -1)
+    {
+        zip_source_free(zipSource);
+        
+        return false;
+    }
+    
+    zipModified = true;
+    
+#if defined(LIBZIP_VERSION_MAJOR) && \
+    ((LIBZIP_VERSION_MAJOR > 0) || (LIBZIP_VERSION_MINOR >= 11))
+    // Large entries are stored, so they save quickly and can be mapped
+    if (data->size() >= OE_PACKAGE_STORE_SIZE)
+        zip_set_file_compression(zip, index, ZIP_CM_STORE, 0);
+#endif
+    
+    return true;
+}
+
+bool OEPackage::writeFileEntry(const string& packagePath, OEData *data)
+{
+    string filePath = path + PATH_SEPARATOR + packagePath;
+    string tempPath = filePath + ".tmp";
+    
+    // The file is replaced rather than truncated, so views mapped
+    // from it stay valid
+    if (!writeFile(tempPath, data))
+        return false;
+    
+    return (rename(tempPath.c_str(), filePath.c_str()) == 0);
+}
+
+void *OEPackage::writePending(void *context)
+{
+    OEPackage *package = (OEPackage *) context;
+    
+    while (true)
+    {
+        pthread_mutex_lock(&package->pendingWriteMutex);
+        
+        size_t index = package->pendingWriteIndex++;
+        
+        pthread_mutex_unlock(&package->pendingWriteMutex);
+        
+        if (index >= package->pendingWrites.size())
+            break;
+        
+        OEPackageWrite& pendingWrite = package->pendingWrites[index];
+        
+        pendingWrite.error = !package->writeFileEntry(pendingWrite.packagePath,
+                                                      pendingWrite.data);
+    }
+    
+    return NULL;
 }
 
 bool OEPackage::remove()
@@ -11,12 +11,48 @@
 #ifndef _OEPACKAGE_H
 #define _OEPACKAGE_H
 
+#include <map>
+
+#include <pthread.h>
 #include <zip.h>
 
 #include "OECommon.h"
+#include "OEMappedData.h"
 
 using namespace std;
 
+#define OE_PACKAGE_HASHES_PATH "hashes.txt"
+#define OE_PACKAGE_STORE_SIZE 0x10000
+#define OE_PACKAGE_WRITE_THREADNUM 4
+
+// Notes:
+// * write() skips data whose content hash matches the one stored in the
+//   package.
+// * Written data must stay valid until the package is flushed or closed.
+//   Directory entries are written in parallel on flush, zip entries when
+//   the zip is closed.
+// * Zip entries of OE_PACKAGE_STORE_SIZE bytes or more are stored
+//   uncompressed.
+
+typedef struct
+{
+    OELong offset;
+    OELong size;
+} OEPackageEntry;
+
+typedef struct
+{
+    OELong hash;
+    OELong size;
+} OEPackageHash;
+
+typedef struct
+{
+    string packagePath;
+    OEData *data;
+    bool error;
+} OEPackageWrite;
+
 class OEPackage
 {
 public:
@@ -28,7 +64,9 @@ public:
     void close();
     
     bool read(const string& packagePath, OEData *data);
+    bool readMapped(const string& packagePath, OEMappedData *data);
     bool write(const string& packagePath, OEData *data);
+    bool flush();
     
     bool remove();
     
@@ -37,6 +75,28 @@ private:
     
     string path;
     struct zip *zip;
+    
+    bool zipModified;
+    bool zipIndexed;
+    map<string, OEPackageEntry> zipEntries;
+    
+    map<string, OEPackageHash> hashes;
+    bool hashesModified;
+    OEData hashesData;
+    
+    vector<OEPackageWrite> pendingWrites;
+    size_t pendingWriteIndex;
+    pthread_mutex_t pendingWriteMutex;
+    
+    void indexZip();
+    
+    void readHashes();
+    bool writeHashes();
+    bool hasEntry(const string& packagePath, OELong size);
+    bool writeZipEntry(const string& packagePath, OEData *data);
+    bool writeFileEntry(const string& packagePath, OEData *data);
+    
+    static void *writePending(void *context);
 };
 
 #endif
@@ -0,0 +1,112 @@
+/**
+ * libemulation
+ * OESharedData
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a process-wide pool of shared, read-only data
+ */
+
+#include <map>
+
+#include <pthread.h>
+
+#include "OESharedData.h"
+
+typedef struct
+{
+    OEData *data;
+    OEInt refCount;
+} OESharedDataEntry;
+
+static pthread_mutex_t oeSharedDataMutex = PTHREAD_MUTEX_INITIALIZER;
+static map<string, OESharedDataEntry> oeSharedDataEntries;
+static map<const OEData *, string> oeSharedDataKeys;
+
+const OEData *OESharedData::retain(string key)
+{
+    const OEData *data = NULL;
+    
+    pthread_mutex_lock(&oeSharedDataMutex);
+    
+    map<string, OESharedDataEntry>::iterator i = oeSharedDataEntries.find(key);
+    
+    if (i != oeSharedDataEntries.end())
+    {
+        i->second.refCount++;
+        
+        data = i->second.data;
+    }
+    
+    pthread_mutex_unlock(&oeSharedDataMutex);
+    
+    return data;
+}
+
+const OEData *OESharedData::retain(string key, OEData *data)
+{
+    const OEData *sharedData = NULL;
+    
+    pthread_mutex_lock(&oeSharedDataMutex);
+    
+    map<string, OESharedDataEntry>::iterator i = oeSharedDataEntries.find(key);
+    
+    if (i != oeSharedDataEntries.end())
+    {
+        if (*i->second.data == *data)
+        {
+            i->second.refCount++;
+            
+            sharedData = i->second.data;
+        }
+    }
+    else
+    {
+        OESharedDataEntry entry;
+        
+        entry.data = new OEData();
+        entry.data->swap(*data);
+        entry.refCount = 1;
+        
+        oeSharedDataEntries[key] = entry;
+        oeSharedDataKeys[entry.data] = key;
+        
+        sharedData = entry.data;
+    }
+    
+    pthread_mutex_unlock(&oeSharedDataMutex);
+    
+    return sharedData;
+}
+
+void OESharedData::release(const OEData *data)
+{
+    if (!data)
+        return;
+    
+    pthread_mutex_lock(&oeSharedDataMutex);
+    
+    map<const OEData *, string>::iterator i = oeSharedDataKeys.find(data);
+    
+    if (i != oeSharedDataKeys.end())
+    {
+        OESharedDataEntry& entry = oeSharedDataEntries[i->second];
+        
+        if (!--entry.refCount)
+        {
+            delete entry.data;
+            
+            oeSharedDataEntries.erase(i->second);
+            oeSharedDataKeys.erase(i);
+        }
+    }
+    
+    pthread_mutex_unlock(&oeSharedDataMutex);
+}
+
+string OESharedData::getKey(string name, const OEData& data)
+{
+    return (name + ":" +
+            getHexString(getOEHash(data)).substr(2) + ":" +
+            getString((OELong) data.size()));
+}
@@ -0,0 +1,36 @@
+/**
+ * libemulation
+ * OESharedData
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a process-wide pool of shared, read-only data
+ */
+
+#ifndef _OESHAREDDATA_H
+#define _OESHAREDDATA_H
+
+#include "OECommon.h"
+
+// Notes:
+// * Shared data is immutable, and reference counted: every successful
+//   retain() must be balanced by a release().
+// * retain(key) returns the data stored under key, or NULL if there is none.
+// * retain(key, data) stores data under key, swapping it out of the caller's
+//   vector. If data is already stored under key, the stored copy is returned
+//   instead and the caller's vector is left untouched; NULL is returned if
+//   that copy differs.
+// * getKey() derives a content key from a name and the data it was built
+//   from.
+
+class OESharedData
+{
+public:
+    static const OEData *retain(string key);
+    static const OEData *retain(string key, OEData *data);
+    static void release(const OEData *data);
+    
+    static string getKey(string name, const OEData& data);
+};
+
+#endif
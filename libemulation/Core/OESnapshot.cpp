@@ -0,0 +1,416 @@
+/**
+ * libemulation
+ * OESnapshot
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a binary emulation state snapshot
+ */
+
+#include <string.h>
+
+#include "OESnapshot.h"
+
+#define OE_SNAPSHOT_NOREF       0xffffffff
+#define OE_SNAPSHOT_ZERORUN     8
+
+OESnapshot::OESnapshot()
+{
+    size = 0;
+    position = 0;
+    
+    components = NULL;
+}
+
+void OESnapshot::clear()
+{
+    mappedData.close();
+    
+    size = 0;
+    position = 0;
+}
+
+void OESnapshot::rewind()
+{
+    position = 0;
+}
+
+void OESnapshot::reserve(size_t size)
+{
+    if (data.size() < size)
+        data.resize(size);
+}
+
+OEChar *OESnapshot::getData()
+{
+    if (mappedData.isOpen())
+        return mappedData.getData();
+    
+    return data.size() ? &data.front() : NULL;
+}
+
+size_t OESnapshot::getSize()
+{
+    return size;
+}
+
+size_t OESnapshot::getPosition()
+{
+    return position;
+}
+
+bool OESnapshot::write(const void *data, size_t size)
+{
+    if (mappedData.isOpen())
+        return false;
+    
+    if ((position + size) > this->data.size())
+        reserve(max(2 * this->data.size(), position + size));
+    
+    if (size)
+        memcpy(&this->data[position], data, size);
+    
+    position += size;
+    
+    if (this->size < position)
+        this->size = position;
+    
+    return true;
+}
+
+bool OESnapshot::write(const string& value)
+{
+    OEInt length = (OEInt) value.size();
+    
+    return (write(length) &&
+            write(value.c_str(), length));
+}
+
+bool OESnapshot::write(const OEData& value)
+{
+    OEInt length = (OEInt) value.size();
+    
+    return (write(length) &&
+            write(length ? &value.front() : NULL, length));
+}
+
+bool OESnapshot::read(void *data, size_t size)
+{
+    if ((position + size) > this->size)
+        return false;
+    
+    if (size)
+        memcpy(data, getData() + position, size);
+    
+    position += size;
+    
+    return true;
+}
+
+bool OESnapshot::read(string& value)
+{
+    OEInt length;
+    
+    if (!read(length) ||
+        ((position + length) > size))
+        return false;
+    
+    value.assign((const char *) getData() + position, length);
+    
+    position += length;
+    
+    return true;
+}
+
+bool OESnapshot::read(OEData& value)
+{
+    OEInt length;
+    
+    if (!read(length) ||
+        ((position + length) > size))
+        return false;
+    
+    value.resize(length);
+    
+    return read(length ? &value.front() : NULL, length);
+}
+
+bool OESnapshot::patch(size_t position, const void *data, size_t size)
+{
+    if (mappedData.isOpen() ||
+        ((position + size) > this->size))
+        return false;
+    
+    memcpy(&this->data[position], data, size);
+    
+    return true;
+}
+
+bool OESnapshot::skip(size_t size)
+{
+    if ((position + size) > this->size)
+        return false;
+    
+    position += size;
+    
+    return true;
+}
+
+bool OESnapshot::writeBlock(const void *data, size_t size)
+{
+    static const OEChar padding[OE_SNAPSHOT_BLOCKALIGN] = { 0 };
+    size_t paddingSize = getPaddingSize();
+    
+    return (write(padding, paddingSize) &&
+            write(data, size));
+}
+
+bool OESnapshot::readBlock(void *data, size_t size)
+{
+    size_t paddingSize = getPaddingSize();
+    
+    return (skip(paddingSize) &&
+            read(data, size));
+}
+
+// Fails if the snapshot is not mapped, or the block cannot be mapped
+bool OESnapshot::readBlock(OEMappedData *data, size_t size)
+{
+    size_t paddingSize = getPaddingSize();
+    size_t blockPosition = position + paddingSize;
+    
+    if (!mappedData.isOpen() ||
+        ((blockPosition + size) > this->size))
+        return false;
+    
+    OEMappedData blockData;
+    
+    if (!blockData.open(mappedData.getPath(),
+                        mappedData.getOffset() + blockPosition,
+                        size))
+        return false;
+    
+    data->swap(blockData);
+    
+    position = blockPosition + size;
+    
+    return true;
+}
+
+size_t OESnapshot::getPaddingSize()
+{
+    return (OE_SNAPSHOT_BLOCKALIGN - position % OE_SNAPSHOT_BLOCKALIGN) % OE_SNAPSHOT_BLOCKALIGN;
+}
+
+void OESnapshot::setComponents(vector<OEComponent *> *components)
+{
+    this->components = components;
+}
+
+bool OESnapshot::writeRef(OEComponent *ref)
+{
+    OEInt index = OE_SNAPSHOT_NOREF;
+    
+    if (ref)
+    {
+        if (!components)
+            return false;
+        
+        vector<OEComponent *>::iterator i = find(components->begin(),
+                                                 components->end(),
+                                                 ref);
+        
+        if (i == components->end())
+            return false;
+        
+        index = (OEInt) (i - components->begin());
+    }
+    
+    return write(index);
+}
+
+bool OESnapshot::readRef(OEComponent **ref)
+{
+    OEInt index;
+    
+    if (!read(index))
+        return false;
+    
+    if (index == OE_SNAPSHOT_NOREF)
+        *ref = NULL;
+    else if (components && (index < components->size()))
+        *ref = (*components)[index];
+    else
+        return false;
+    
+    return true;
+}
+
+// The delta holds both sizes, followed by runs of unchanged bytes and
+// XORed literals. Short unchanged runs are kept inside literals
+void OESnapshot::getDelta(OESnapshot& reference, OEData *delta)
+{
+    OELong sizes[2] = { size, reference.size };
+    size_t commonSize = min(size, reference.size);
+    size_t deltaSize = max(size, reference.size);
+    
+    OEChar *a = getData();
+    OEChar *b = reference.getData();
+    
+    delta->resize(sizeof(sizes));
+    memcpy(&delta->front(), sizes, sizeof(sizes));
+    
+    size_t i = 0;
+    
+    while (i < deltaSize)
+    {
+        size_t start = i;
+        
+        while (((i + sizeof(OELong)) <= commonSize) &&
+               !memcmp(a + i, b + i, sizeof(OELong)))
+            i += sizeof(OELong);
+        
+        while ((i < commonSize) && (a[i] == b[i]))
+            i++;
+        
+        if (i >= commonSize)
+        {
+            OEChar *tail = (size > commonSize) ? a : b;
+            
+            while ((i < deltaSize) && !tail[i])
+                i++;
+        }
+        
+        size_t literalStart = i;
+        size_t literalEnd = i;
+        
+        for (size_t j = i; j < deltaSize; )
+        {
+            OEChar value = ((j < size) ? a[j] : 0) ^ ((j < reference.size) ? b[j] : 0);
+            
+            j++;
+            
+            if (value)
+                literalEnd = j;
+            else if ((j - literalEnd) >= OE_SNAPSHOT_ZERORUN)
+                break;
+        }
+        
+        OEInt run[2] = { (OEInt) (literalStart - start), (OEInt) (literalEnd - literalStart) };
+        
+        size_t offset = delta->size();
+        delta->resize(offset + sizeof(run) + run[1]);
+        memcpy(&(*delta)[offset], run, sizeof(run));
+        
+        OEChar *p = &(*delta)[offset + sizeof(run)];
+        
+        for (size_t j = literalStart; j < literalEnd; j++)
+            *p++ = ((j < size) ? a[j] : 0) ^ ((j < reference.size) ? b[j] : 0);
+        
+        i = literalEnd;
+        
+        if (!run[1])
+            break;
+    }
+}
+
+bool OESnapshot::applyDelta(const OEData& delta)
+{
+    OELong sizes[2];
+    
+    if (mappedData.isOpen() ||
+        (delta.size() < sizeof(sizes)))
+        return false;
+    
+    memcpy(sizes, &delta.front(), sizeof(sizes));
+    
+    size_t targetSize;
+    
+    if (size == sizes[0])
+        targetSize = (size_t) sizes[1];
+    else if (size == sizes[1])
+        targetSize = (size_t) sizes[0];
+    else
+        return false;
+    
+    size_t deltaSize = max(size, targetSize);
+
+    // Validate first, so a corrupt delta leaves the snapshot untouched
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass)
+        {
+            reserve(deltaSize);
+
+            if (deltaSize > size)
+                memset(&data[size], 0, deltaSize - size);
+        }
+
+        size_t p = sizeof(sizes);
+        size_t i = 0;
+
+        while (p < delta.size())
+        {
+            OEInt run[2];
+
+            if ((p + sizeof(run)) > delta.size())
+                return false;
+
+            memcpy(run, &delta[p], sizeof(run));
+            p += sizeof(run);
+
+            i += run[0];
+
+            if (((i + run[1]) > deltaSize) ||
+                ((p + run[1]) > delta.size()))
+                return false;
+
+            if (!pass)
+            {
+                i += run[1];
+                p += run[1];
+            }
+            else
+                for (OEInt j = 0; j < run[1]; j++)
+                    data[i++] ^= delta[p++];
+        }
+    }
+
+    size = targetSize;
+    position = 0;
+    
+    return true;
+}
+
+void OESnapshot::swap(OESnapshot& other)
+{
+    data.swap(other.data);
+    std::swap(size, other.size);
+    std::swap(position, other.position);
+    std::swap(components, other.components);
+    mappedData.swap(other.mappedData);
+}
+
+// Exchanges the contents with a vector, which holds exactly the snapshot
+void OESnapshot::swap(OEData& data)
+{
+    if (mappedData.isOpen())
+        mappedData.read(&this->data);
+    else
+        this->data.resize(size);
+    
+    mappedData.close();
+    
+    this->data.swap(data);
+    
+    size = this->data.size();
+    position = 0;
+}
+
+void OESnapshot::swap(OEMappedData& data)
+{
+    mappedData.swap(data);
+    
+    size = mappedData.isOpen() ? (size_t) mappedData.getSize() : 0;
+    position = 0;
+}
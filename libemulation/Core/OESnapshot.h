@@ -0,0 +1,93 @@
+/**
+ * libemulation
+ * OESnapshot
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Implements a binary emulation state snapshot
+ */
+
+#ifndef _OESNAPSHOT_H
+#define _OESNAPSHOT_H
+
+#include "OECommon.h"
+#include "OEMappedData.h"
+
+// Notes:
+// * A snapshot is an arena that keeps its storage across clear(), so
+//   snapshots taken every frame do not allocate.
+// * Values are stored in host byte order: snapshots are not portable.
+// * The template write() and read() copy plain values only. Strings and
+//   OEData are stored with their size.
+// * Component references are stored as indices into the component list
+//   set with setComponents().
+// * Blocks are aligned to OE_SNAPSHOT_BLOCKALIGN bytes. When a snapshot is
+//   read from a memory-mapped file, a block can be mapped copy-on-write in
+//   place of being copied, so only the pages that are touched are read.
+// * A mapped snapshot is read-only until it is cleared.
+// * getDelta() computes a run-length coded XOR of two snapshots. Applying
+//   it to either snapshot gives the other.
+
+#define OE_SNAPSHOT_BLOCKALIGN 0x4000
+
+class OEComponent;
+
+class OESnapshot
+{
+public:
+    OESnapshot();
+    
+    void clear();
+    void rewind();
+    void reserve(size_t size);
+    
+    OEChar *getData();
+    size_t getSize();
+    size_t getPosition();
+    
+    bool write(const void *data, size_t size);
+    bool write(const string& value);
+    bool write(const OEData& value);
+    bool read(void *data, size_t size);
+    bool read(string& value);
+    bool read(OEData& value);
+    bool patch(size_t position, const void *data, size_t size);
+    bool skip(size_t size);
+    
+    bool writeBlock(const void *data, size_t size);
+    bool readBlock(void *data, size_t size);
+    bool readBlock(OEMappedData *data, size_t size);
+    
+    template<class T> bool write(const T& value)
+    {
+        return write(&value, sizeof(T));
+    }
+    
+    template<class T> bool read(T& value)
+    {
+        return read(&value, sizeof(T));
+    }
+    
+    void setComponents(vector<OEComponent *> *components);
+    bool writeRef(OEComponent *ref);
+    bool readRef(OEComponent **ref);
+    
+    void getDelta(OESnapshot& reference, OEData *delta);
+    bool applyDelta(const OEData& delta);
+    void swap(OESnapshot& other);
+    void swap(OEData& data);
+    void swap(OEMappedData& data);
+    
+private:
+    OEData data;
+    size_t size;
+    size_t position;
+    
+    OEMappedData mappedData;
+    
+    vector<OEComponent *> *components;
+    
+    size_t getPaddingSize();
+};
+
+#endif
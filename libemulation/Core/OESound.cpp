@@ -8,10 +8,100 @@
  * Implements a sound type
  */
 
+#include <map>
+
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "OESound.h"
 
 #include "sndfile.h"
 
+// The process-wide pool of shared sounds. Sounds loaded from a file are
+// keyed by path, size and modification time, sounds decoded from data by
+// a hash of the data
+typedef struct
+{
+    OESound *sound;
+    OEInt refCount;
+} OESoundPoolEntry;
+
+static pthread_mutex_t oeSoundPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static map<string, OESoundPoolEntry> oeSoundPool;
+static map<OESound *, string> oeSoundPoolKeys;
+static vector<OESound *> oeSoundPrefetched;
+
+static string getSoundPathKey(string path)
+{
+    struct stat st;
+    
+    if (stat(path.c_str(), &st))
+        return "";
+    
+    return ("path:" + path + ":" +
+            getString((OELong) st.st_size) + ":" +
+            getString((OELong) st.st_mtime));
+}
+
+static string getSoundDataKey(OEData& data)
+{
+    return ("data:" +
+            getHexString(getOEHash(data)).substr(2) + ":" +
+            getString((OELong) data.size()));
+}
+
+static OESound *retainPooledSound(string key)
+{
+    OESound *sound = NULL;
+    
+    pthread_mutex_lock(&oeSoundPoolMutex);
+    
+    map<string, OESoundPoolEntry>::iterator i = oeSoundPool.find(key);
+    
+    if (i != oeSoundPool.end())
+    {
+        i->second.refCount++;
+        
+        sound = i->second.sound;
+    }
+    
+    pthread_mutex_unlock(&oeSoundPoolMutex);
+    
+    return sound;
+}
+
+// Sounds are decoded outside the lock, so two threads may decode the same
+// sound; the first one to finish is kept
+static OESound *addPooledSound(string key, OESound *sound)
+{
+    pthread_mutex_lock(&oeSoundPoolMutex);
+    
+    map<string, OESoundPoolEntry>::iterator i = oeSoundPool.find(key);
+    
+    if (i != oeSoundPool.end())
+    {
+        delete sound;
+        
+        i->second.refCount++;
+        
+        sound = i->second.sound;
+    }
+    else
+    {
+        OESoundPoolEntry entry;
+        
+        entry.sound = sound;
+        entry.refCount = 1;
+        
+        oeSoundPool[key] = entry;
+        oeSoundPoolKeys[sound] = key;
+    }
+    
+    pthread_mutex_unlock(&oeSoundPoolMutex);
+    
+    return sound;
+}
+
 typedef struct
 {
     OEData *data;
@@ -122,6 +212,126 @@ float *OESound::getSamples()
 }
 
 bool OESound::load(string path)
+{
+    OESound *sound = retain(path);
+    
+    if (!sound)
+        return false;
+    
+    *this = *sound;
+    
+    release(sound);
+    
+    return true;
+}
+
+// Returns a shared, read-only sound. Must be balanced by release()
+OESound *OESound::retain(string path)
+{
+    string key = getSoundPathKey(path);
+    
+    if (key == "")
+        return NULL;
+    
+    OESound *sound = retainPooledSound(key);
+    
+    if (sound)
+        return sound;
+    
+    sound = new OESound();
+    
+    if (!sound->loadFile(path))
+    {
+        delete sound;
+        
+        return NULL;
+    }
+    
+    return addPooledSound(key, sound);
+}
+
+OESound *OESound::retain(OEData& data)
+{
+    string key = getSoundDataKey(data);
+    
+    OESound *sound = retainPooledSound(key);
+    
+    if (sound)
+        return sound;
+    
+    sound = new OESound();
+    
+    if (!sound->load(data))
+    {
+        delete sound;
+        
+        return NULL;
+    }
+    
+    return addPooledSound(key, sound);
+}
+
+void OESound::release(OESound *sound)
+{
+    if (!sound)
+        return;
+    
+    pthread_mutex_lock(&oeSoundPoolMutex);
+    
+    map<OESound *, string>::iterator i = oeSoundPoolKeys.find(sound);
+    
+    if (i != oeSoundPoolKeys.end())
+    {
+        OESoundPoolEntry& entry = oeSoundPool[i->second];
+        
+        if (!--entry.refCount)
+        {
+            delete entry.sound;
+            
+            oeSoundPool.erase(i->second);
+            oeSoundPoolKeys.erase(i);
+        }
+    }
+    
+    pthread_mutex_unlock(&oeSoundPoolMutex);
+}
+
+// Decodes a sound into the pool and holds it until clearPrefetched(), so
+// later loads of the same path only share or copy it.
+// Safe to call from several threads
+bool OESound::prefetch(string path)
+{
+    OESound *sound = retain(path);
+    
+    if (!sound)
+        return false;
+    
+    pthread_mutex_lock(&oeSoundPoolMutex);
+    
+    oeSoundPrefetched.push_back(sound);
+    
+    pthread_mutex_unlock(&oeSoundPoolMutex);
+    
+    return true;
+}
+
+void OESound::clearPrefetched()
+{
+    vector<OESound *> sounds;
+    
+    pthread_mutex_lock(&oeSoundPoolMutex);
+    
+    sounds.swap(oeSoundPrefetched);
+    
+    pthread_mutex_unlock(&oeSoundPoolMutex);
+    
+    for (vector<OESound *>::iterator i = sounds.begin();
+         i != sounds.end();
+         i++)
+        release(*i);
+}
+
+bool OESound::loadFile(string path)
 {
     bool success = false;
     SNDFILE *sndFile;
@@ -28,6 +28,13 @@ public:
     bool load(string path);
     bool load(OEData& data);
     
+    static OESound *retain(string path);
+    static OESound *retain(OEData& data);
+    static void release(OESound *sound);
+    
+    static bool prefetch(string path);
+    static void clearPrefetched();
+    
 private:
 	float sampleRate;
 	OEInt channelNum;
@@ -35,6 +42,7 @@ private:
     vector<float> samples;
     
     void init();
+    bool loadFile(string path);
 };
 
 #endif
@@ -160,6 +160,20 @@ void Apple1IO::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+bool Apple1IO::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(terminalKey);
+    snapshot->write(terminalChar);
+    
+    return true;
+}
+
+bool Apple1IO::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(terminalKey) &&
+            snapshot->read(terminalChar));
+}
+
 OEChar Apple1IO::read(OEAddress address)
 {
     switch (address & 1)
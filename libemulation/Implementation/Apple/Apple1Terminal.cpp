@@ -11,6 +11,7 @@
 #include "Apple1Terminal.h"
 
 #include "EmulationInterface.h"
+#include "DeviceInterface.h"
 #include "RS232Interface.h"
 #include "MemoryInterface.h"
 
@@ -33,8 +34,17 @@
 #define BLINK_ON            20
 #define BLINK_OFF           10
 
+#define FRAME_TIMER         0
+#define CTS_TIMER           1
+
+#define FRAME_CYCLES        (262 * 61)
+#define FAST_CTS_CYCLES     8
+
+#define CELL_INVALID        0xff
+
 Apple1Terminal::Apple1Terminal()
 {
+    device = NULL;
     dte = NULL;
     emulation = NULL;
     controlBus = NULL;
@@ -45,16 +55,26 @@ Apple1Terminal::Apple1Terminal()
     cursorX = 0;
     cursorY = 0;
     clearScreenOnCtrlL = false;
+    fastOutput = false;
     splashScreen = false;
     splashScreenActive = false;
     
     updateCanvas = true;
     image.setFormat(OEIMAGE_LUMINANCE);
     image.setSize(OEMakeSize(SCREEN_WIDTH, SCREEN_HEIGHT));
+    imageCells.resize(BLOCK_WIDTH * BLOCK_HEIGHT, CELL_INVALID);
+    scrollCount = 0;
     cursorActive = false;
     cursorCount = 0;
     
     powerState = CONTROLBUS_POWERSTATE_ON;
+    warp = false;
+    
+    isCTSPending = false;
+    
+    pasteSize = 0;
+    pastePercent = -1;
+    pasteWarp = false;
 }
 
 bool Apple1Terminal::setValue(string name, string value)
@@ -65,6 +85,8 @@ bool Apple1Terminal::setValue(string name, string value)
         cursorY = getOEInt(value);
     else if (name == "clearScreenOnCtrlL")
         clearScreenOnCtrlL = getOEInt(value);
+    else if (name == "fastOutput")
+        fastOutput = getOEInt(value);
     else if (name == "splashScreen")
         splashScreen = getOEInt(value);
     else if (name == "splashScreenActive")
@@ -81,6 +103,8 @@ bool Apple1Terminal::getValue(string name, string& value)
         value = getString(cursorX);
     else if (name == "cursorY")
         value = getString(cursorY);
+    else if (name == "fastOutput")
+        value = getString(fastOutput);
     else if (name == "splashScreenActive")
         value = getString(splashScreenActive);
     else
@@ -91,7 +115,9 @@ bool Apple1Terminal::getValue(string name, string& value)
 
 bool Apple1Terminal::setRef(string name, OEComponent *ref)
 {
-    if (name == "dte")
+    if (name == "device")
+        device = ref;
+    else if (name == "dte")
         dte = ref;
     else if (name == "emulation")
     {
@@ -108,6 +134,7 @@ bool Apple1Terminal::setRef(string name, OEComponent *ref)
             controlBus->removeObserver(this, CONTROLBUS_POWERSTATE_DID_CHANGE);
             controlBus->removeObserver(this, CONTROLBUS_TIMER_DID_FIRE);
             controlBus->removeObserver(this, CONTROLBUS_RESET_DID_ASSERT);
+            controlBus->removeObserver(this, CONTROLBUS_WARP_DID_CHANGE);
         }
         controlBus = ref;
         if (controlBus)
@@ -115,6 +142,7 @@ bool Apple1Terminal::setRef(string name, OEComponent *ref)
             controlBus->addObserver(this, CONTROLBUS_POWERSTATE_DID_CHANGE);
             controlBus->addObserver(this, CONTROLBUS_TIMER_DID_FIRE);
             controlBus->addObserver(this, CONTROLBUS_RESET_DID_ASSERT);
+            controlBus->addObserver(this, CONTROLBUS_WARP_DID_CHANGE);
         }
     }
     else if (name == "vram")
@@ -188,6 +216,8 @@ bool Apple1Terminal::init()
 
 void Apple1Terminal::update()
 {
+    memset(&imageCells.front(), CELL_INVALID, imageCells.size());
+    
     updateCanvas = true;
 }
 
@@ -203,6 +233,15 @@ bool Apple1Terminal::postMessage(OEComponent *sender, int message, void *data)
         case RS232_TRANSMIT_DATA:
             putChar(*((OEChar *)data));
             
+            // In fast mode, the character is acknowledged right away
+            if (fastOutput && !isCTSPending)
+            {
+                isCTSPending = true;
+                
+                ControlBusTimer timer = { FAST_CTS_CYCLES, CTS_TIMER };
+                controlBus->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
+            }
+            
             return true;
             
         case RS232_SET_RTS:
@@ -247,7 +286,7 @@ void Apple1Terminal::notify(OEComponent *sender, int notification, void *data)
                         controlBus->postMessage(this, CONTROLBUS_ASSERT_RESET, NULL);
                     }
                     
-                    updateCanvas = true;
+                    update();
                 }
                 
                 powerState = *((ControlBusPowerState *)data);
@@ -267,10 +306,24 @@ void Apple1Terminal::notify(OEComponent *sender, int notification, void *data)
                 while (!pasteBuffer.empty())
                     pasteBuffer.pop();
                 
+                updatePaste();
+                
+                break;
+                
+            case CONTROLBUS_WARP_DID_CHANGE:
+                warp = *((bool *)data);
+                
                 break;
                 
             case CONTROLBUS_TIMER_DID_FIRE:
-                scheduleNextTimer(((ControlBusTimer *) data)->cycles);
+                if (((ControlBusTimer *) data)->id == CTS_TIMER)
+                {
+                    isCTSPending = false;
+                    
+                    pulseCTS();
+                }
+                else
+                    scheduleNextTimer(((ControlBusTimer *) data)->cycles);
                 
                 break;
         }
@@ -307,6 +360,37 @@ void Apple1Terminal::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+bool Apple1Terminal::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(cursorX);
+    snapshot->write(cursorY);
+    snapshot->write(cursorActive);
+    snapshot->write(cursorCount);
+    snapshot->write(splashScreenActive);
+    snapshot->write(isRTS);
+    
+    return true;
+}
+
+// The image is redrawn, as the restored VRAM does not match it
+bool Apple1Terminal::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(cursorX) ||
+        !snapshot->read(cursorY) ||
+        !snapshot->read(cursorActive) ||
+        !snapshot->read(cursorCount) ||
+        !snapshot->read(splashScreenActive) ||
+        !snapshot->read(isRTS))
+        return false;
+    
+    isCTSPending = false;
+    scrollCount = 0;
+    
+    update();
+    
+    return true;
+}
+
 void Apple1Terminal::loadFont(OEData *data)
 {
     if (data->size() < FONT_HEIGHT)
@@ -347,16 +431,21 @@ void Apple1Terminal::scheduleNextTimer(OESLong cycles)
         }
     }
     
+    pulseCTS();
+    
+    drawFrame();
+    
+    ControlBusTimer timer = { cycles + FRAME_CYCLES, FRAME_TIMER };
+    controlBus->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
+}
+
+void Apple1Terminal::pulseCTS()
+{
     bool cts = true;
     dte->postMessage(this, RS232_SET_CTS, &cts);
     
     cts = false;
     dte->postMessage(this, RS232_SET_CTS, &cts);
-    
-    drawFrame();
-    
-    ControlBusTimer timer = { cycles + 262 * 61, 0 };
-    controlBus->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
 }
 
 // Copy a 14-pixel segment
@@ -365,9 +454,38 @@ void Apple1Terminal::scheduleNextTimer(OESLong cycles)
 *((OEInt *)(p + x * SCREEN_WIDTH + 8)) = *((OEInt *)(f + x * FONT_WIDTH + 8));\
 *((OEShort *)(p + x * SCREEN_WIDTH + 12)) = *((OEShort *)(f + x * FONT_WIDTH + 12));
 
+// Moves the drawn rows up for the lines scrolled since the last frame
+void Apple1Terminal::scrollImage()
+{
+    if (!scrollCount)
+        return;
+    
+    OEChar *ip = (OEChar *)image.getPixels() + SCREEN_ORIGIN_Y * SCREEN_WIDTH;
+    OEChar *cp = &imageCells.front();
+    
+    if (scrollCount < BLOCK_HEIGHT)
+    {
+        OEInt rowNum = BLOCK_HEIGHT - scrollCount;
+        
+        memmove(ip,
+                ip + scrollCount * CHAR_HEIGHT * SCREEN_WIDTH,
+                rowNum * CHAR_HEIGHT * SCREEN_WIDTH);
+        memmove(cp,
+                cp + scrollCount * BLOCK_WIDTH,
+                rowNum * BLOCK_WIDTH);
+        memset(cp + rowNum * BLOCK_WIDTH, CELL_INVALID, scrollCount * BLOCK_WIDTH);
+    }
+    else
+        memset(cp, CELL_INVALID, BLOCK_HEIGHT * BLOCK_WIDTH);
+    
+    scrollCount = 0;
+}
+
+// Only cells that differ from the drawn image are drawn. Frames are not
+// presented while the bus is warped
 void Apple1Terminal::drawFrame()
 {
-    if (!updateCanvas)
+    if (!updateCanvas || warp)
         return;
     
     updateCanvas = false;
@@ -378,13 +496,15 @@ void Apple1Terminal::drawFrame()
     if (!vramp)
         return;
     
+    bool imageModified = (scrollCount != 0);
+    
+    scrollImage();
+    
     OEChar *fp = (OEChar *)&font.front();
     OEChar *ip = (OEChar *)image.getPixels();
+    OEChar *cp = &imageCells.front();
     
-    // Place cursor
-    OEChar cursorChar = vramp[cursorY * BLOCK_WIDTH + cursorX];
-    if (cursorActive)
-        vramp[cursorY * BLOCK_WIDTH + cursorX] = '@';
+    OEInt cursorIndex = cursorActive ? (cursorY * BLOCK_WIDTH + cursorX) : -1;
     
     for (OEInt y = 0; y < BLOCK_HEIGHT; y++)
     {
@@ -392,9 +512,17 @@ void Apple1Terminal::drawFrame()
                      SCREEN_ORIGIN_Y * SCREEN_WIDTH +
                      SCREEN_ORIGIN_X);
         
-        for (OEInt x = 0; x < BLOCK_WIDTH; x++)
+        for (OEInt x = 0; x < BLOCK_WIDTH; x++, p += CHAR_WIDTH)
         {
-            OEChar i = vramp[y * BLOCK_WIDTH + x] & FONT_SIZE_MASK;
+            OEInt index = y * BLOCK_WIDTH + x;
+            OEChar i = ((index == cursorIndex) ? '@' :
+                        (vramp[index] & FONT_SIZE_MASK));
+            
+            if (cp[index] == i)
+                continue;
+            
+            cp[index] = i;
+            
             OEChar *f = fp + i * FONT_HEIGHT * FONT_WIDTH;
             
             copySegment(0);
@@ -406,14 +534,12 @@ void Apple1Terminal::drawFrame()
             copySegment(6);
             copySegment(7);
             
-            p += CHAR_WIDTH;
+            imageModified = true;
         }
     }
     
-    monitor->postMessage(this, CANVAS_POST_IMAGE, &image);
-    
-    // Remove cursor
-    vramp[cursorY * BLOCK_WIDTH + cursorX] = cursorChar;
+    if (imageModified)
+        monitor->postMessage(this, CANVAS_POST_IMAGE, &image);
 }
 
 void Apple1Terminal::clearScreen()
@@ -462,6 +588,9 @@ void Apple1Terminal::putChar(OEChar c)
         memmove(vramp, vramp + BLOCK_WIDTH, (BLOCK_HEIGHT - 1) * BLOCK_WIDTH);
         memset(vramp + (BLOCK_HEIGHT - 1) * BLOCK_WIDTH, ' ', BLOCK_WIDTH);
         
+        if (scrollCount < BLOCK_HEIGHT)
+            scrollCount++;
+        
         updateCanvas = true;
     }
 }
@@ -500,7 +629,11 @@ void Apple1Terminal::paste(wstring *s)
     for (OEInt i = 0; i < s->size(); i++)
     {
         if (s->at(i) <= 0x80)
+        {
             pasteBuffer.push(s->at(i));
+            
+            pasteSize++;
+        }
     }
     
     emptyPasteBuffer();
@@ -515,10 +648,49 @@ void Apple1Terminal::emptyPasteBuffer()
         if (c == '\n')
             c = '\r';
         else if (c == '\r')
+        {
+            pasteBuffer.pop();
+            
             continue;
+        }
         
         sendKey(c);
         
         pasteBuffer.pop();
     }
+    
+    updatePaste();
+}
+
+// The bus is warped while the paste buffer drains
+void Apple1Terminal::updatePaste()
+{
+    bool value = !pasteBuffer.empty();
+    
+    if (pasteWarp != value)
+    {
+        pasteWarp = value;
+        
+        controlBus->postMessage(this, (pasteWarp ?
+                                       CONTROLBUS_ASSERT_WARP :
+                                       CONTROLBUS_CLEAR_WARP), NULL);
+    }
+    
+    if (!pasteWarp)
+        pasteSize = 0;
+    
+    OESInt percent = -1;
+    
+    if (pasteSize)
+        percent = 100 * (pasteSize - (OEInt) pasteBuffer.size()) / pasteSize;
+    
+    if (!device || (pastePercent == percent))
+        return;
+    
+    pastePercent = percent;
+    
+    float progress = (percent < 0) ? -1 : percent / 100.0F;
+    
+    device->postMessage(this, DEVICE_SET_PROGRESS, &progress);
+    device->postMessage(this, DEVICE_UPDATE, NULL);
 }
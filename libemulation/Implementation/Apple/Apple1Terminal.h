@@ -33,7 +33,11 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 private:
+    OEComponent *device;
     OEComponent *dte;
     OEComponent *emulation;
     OEComponent *controlBus;
@@ -43,6 +47,7 @@ private:
     // Settings
     OEInt cursorX, cursorY;
     bool clearScreenOnCtrlL;
+    bool fastOutput;
     bool splashScreen;
     bool splashScreenActive;
     
@@ -52,18 +57,27 @@ private:
     bool updateCanvas;
     
     OEImage image;
+    OEData imageCells;
+    OEInt scrollCount;
     
     bool cursorActive;
     OEInt cursorCount;
     
     ControlBusPowerState powerState;
+    bool warp;
     
     bool isRTS;
+    bool isCTSPending;
     queue<OEChar> pasteBuffer;
+    OEInt pasteSize;
+    OESInt pastePercent;
+    bool pasteWarp;
     
     void loadFont(OEData *data);
     
     void scheduleNextTimer(OESLong cycles);
+    void pulseCTS();
+    void scrollImage();
     void drawFrame();
     
     void clearScreen();
@@ -73,4 +87,5 @@ private:
     void copy(wstring *s);
     void paste(wstring *s);
     void emptyPasteBuffer();
+    void updatePaste();
 };
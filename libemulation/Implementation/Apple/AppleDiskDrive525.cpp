@@ -55,6 +55,14 @@ AppleDiskDrive525::AppleDiskDrive525()
     updateTrack(trackIndex);
 }
 
+AppleDiskDrive525::~AppleDiskDrive525()
+{
+    for (map<string, OESound *>::iterator i = sound.begin();
+         i != sound.end();
+         i++)
+        OESound::release(i->second);
+}
+
 bool AppleDiskDrive525::setValue(string name, string value)
 {
 	if (name == "diskImage")
@@ -63,6 +71,10 @@ bool AppleDiskDrive525::setValue(string name, string value)
         trackPhase = (trackIndex = getOEInt(value)) & 0x7;
 	else if (name == "forceWriteProtected")
 		diskStorage.setForceWriteProtected(getOEInt(value));
+    else if (name == "overlay")
+        setOverlay(getOEInt(value), diskStorage.getOverlayPath());
+    else if (name == "overlayPath")
+        setOverlay(diskStorage.getOverlay(), value);
     else if (name == "imageDriveOff")
         imageDriveOff = value;
     else if (name == "imageDriveInUse")
@@ -72,7 +84,18 @@ bool AppleDiskDrive525::setValue(string name, string value)
 	else if (name == "volume")
 		volume = getFloat(value);
     else if (name.substr(0, 5) == "sound")
-        sound[name.substr(5)] = OESound(value);
+    {
+        // Decoded sounds are shared between drives
+        OESound *theSound = OESound::retain(value);
+        
+        if (sound.count(name.substr(5)))
+            OESound::release(sound[name.substr(5)]);
+        
+        if (theSound)
+            sound[name.substr(5)] = theSound;
+        else
+            sound.erase(name.substr(5));
+    }
 	else
 		return false;
 	
@@ -87,6 +110,10 @@ bool AppleDiskDrive525::getValue(string name, string& value)
 		value = getString(trackIndex);
 	else if (name == "forceWriteProtected")
 		value = getString(diskStorage.getForceWriteProtected());
+    else if (name == "overlay")
+        value = getString(diskStorage.getOverlay());
+    else if (name == "overlayPath")
+        value = diskStorage.getOverlayPath();
 	else if (name == "mechanism")
 		value = mechanism;
 	else if (name == "volume")
@@ -161,6 +188,8 @@ bool AppleDiskDrive525::postMessage(OEComponent *sender, int message, void *data
         {
             DIApple525DiskStorage diskStorage;
             
+            diskStorage.setOverlay(this->diskStorage.getOverlay());
+            
             return diskStorage.open(*((string *)data));
         }
 		case STORAGE_MOUNT:
@@ -196,6 +225,12 @@ bool AppleDiskDrive525::postMessage(OEComponent *sender, int message, void *data
             
             return true;
             
+        case STORAGE_COMMIT_OVERLAY:
+            if (isModified)
+                updateTrack(trackIndex);
+            
+            return diskStorage.commitOverlay();
+            
         case APPLEII_CLEAR_DRIVEENABLE:
             if (drivePlayer)
                 drivePlayer->postMessage(this, AUDIOPLAYER_PAUSE, NULL);
@@ -354,6 +389,73 @@ void AppleDiskDrive525::notify(OEComponent *sender, int notification, void *data
     }
 }
 
+// The disk image is not stored, only the track under the head. Writes
+// already committed to the image are kept, and the track is reread if
+// another image was mounted since
+bool AppleDiskDrive525::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(diskStorage.getPath());
+    snapshot->write(phaseControl);
+    snapshot->write(phaseCycles);
+    snapshot->write(phaseDirection);
+    snapshot->write(phaseLastBump);
+    snapshot->write(phaseStop);
+    snapshot->write(phaseAlign);
+    snapshot->write(trackIndex);
+    snapshot->write(trackPhase);
+    snapshot->write(track);
+    snapshot->write(trackDataIndex);
+    snapshot->write(zeroCount);
+    snapshot->write(isModified);
+    
+    return true;
+}
+
+bool AppleDiskDrive525::deserialize(OESnapshot *snapshot)
+{
+    if (isModified)
+    {
+        diskStorage.writeTrack(trackIndex, track);
+        
+        isModified = false;
+    }
+    
+    string path;
+    
+    if (!snapshot->read(path) ||
+        !snapshot->read(phaseControl) ||
+        !snapshot->read(phaseCycles) ||
+        !snapshot->read(phaseDirection) ||
+        !snapshot->read(phaseLastBump) ||
+        !snapshot->read(phaseStop) ||
+        !snapshot->read(phaseAlign) ||
+        !snapshot->read(trackIndex) ||
+        !snapshot->read(trackPhase) ||
+        !snapshot->read(track) ||
+        !snapshot->read(trackDataIndex) ||
+        !snapshot->read(zeroCount) ||
+        !snapshot->read(isModified))
+        return false;
+    
+    if (path != diskStorage.getPath())
+    {
+        isModified = false;
+        
+        updateTrack(trackIndex);
+    }
+    else
+    {
+        if (!track.size())
+            track.resize(1);
+        
+        trackData = &track.front();
+        trackDataSize = (OEInt) track.size();
+        trackDataIndex %= trackDataSize;
+    }
+    
+    return true;
+}
+
 OEChar AppleDiskDrive525::read(OEAddress address)
 {
     OEChar value = trackData[trackDataIndex];
@@ -371,14 +473,14 @@ OEChar AppleDiskDrive525::read(OEAddress address)
         zeroCount = 0;
         
         // Weak bit support
-        value = ((random() & 0xff) > value);
+        value = ((getRandom() & 0xff) > value);
     }
     else
     {
         // MC3470 spurious bit behavior
         zeroCount++;
         if (zeroCount > 3)
-			value = ((random() & 0x1f) == 0x1f);
+			value = ((getRandom() & 0x1f) == 0x1f);
     }
     
     return value;
@@ -471,6 +573,16 @@ void AppleDiskDrive525::updateTrack(OEInt value)
     trackDataIndex %= trackDataSize;
 }
 
+// Random bits come from the emulation, so journal replays are exact
+OEInt AppleDiskDrive525::getRandom()
+{
+    OEInt value = 0;
+    
+    device->postMessage(this, DEVICE_GET_RANDOM, &value);
+    
+    return value;
+}
+
 void AppleDiskDrive525::updatePlayerSounds()
 {
     updatePlayerSound(doorPlayer, isOpenSound ? "Open" : "Close");
@@ -483,7 +595,7 @@ void AppleDiskDrive525::updatePlayerSound(OEComponent *component, string value)
     OESound *playerSound = NULL;
     
     if (sound.count(mechanism + value))
-        playerSound = &sound[mechanism + value];
+        playerSound = sound[mechanism + value];
     
     if (component)
         component->postMessage(this, AUDIOPLAYER_SET_SOUND, playerSound);
@@ -540,3 +652,26 @@ bool AppleDiskDrive525::closeDiskImage()
     
     return success;
 }
+
+void AppleDiskDrive525::setOverlay(bool value, string path)
+{
+    if ((value == diskStorage.getOverlay()) &&
+        (path == diskStorage.getOverlayPath()))
+        return;
+    
+    diskStorage.setOverlay(value);
+    diskStorage.setOverlayPath(path);
+    
+    // Reopen, so the overlay setting applies to the current image
+    string diskImagePath = diskStorage.getPath();
+    
+    if (diskImagePath != "")
+    {
+        if (isModified)
+            updateTrack(trackIndex);
+        
+        diskStorage.open(diskImagePath);
+        
+        updateTrack(trackIndex);
+    }
+}
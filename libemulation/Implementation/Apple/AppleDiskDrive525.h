@@ -18,6 +18,7 @@ class AppleDiskDrive525 : public OEComponent
 {
 public:
 	AppleDiskDrive525();
+    ~AppleDiskDrive525();
 	
 	bool setValue(string name, string value);
 	bool getValue(string name, string& value);
@@ -30,6 +31,9 @@ public:
 	
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
     
@@ -45,7 +49,7 @@ private:
     
     string mechanism;
     float volume;
-    map<string, OESound>sound;
+    map<string, OESound *>sound;
     
     OEInt phaseControl;
     OELong phaseCycles;
@@ -72,10 +76,12 @@ private:
     
     OESInt getStepperDelta(OESInt position, OEInt phaseControl);
     void updateTrack(OEInt value);
+    OEInt getRandom();
     
     void updatePlayerSounds();
     void updatePlayerSound(OEComponent *component, string value);
     
     bool openDiskImage(string path);
     bool closeDiskImage();
+    void setOverlay(bool value, string path);
 };
@@ -52,6 +52,8 @@ AppleDiskIIInterfaceCard::AppleDiskIIInterfaceCard()
     
     driveEnableControl = false;
     lastCycles = 0;
+    
+    bulkActivity = false;
 }
 
 bool AppleDiskIIInterfaceCard::setValue(string name, string value)
@@ -135,6 +137,14 @@ void AppleDiskIIInterfaceCard::update()
     updateDriveSelection(driveSel);
 }
 
+void AppleDiskIIInterfaceCard::dispose()
+{
+    if (bulkActivity)
+        controlBus->postMessage(this, CONTROLBUS_CLEAR_BULKACTIVITY, NULL);
+        
+    bulkActivity = false;
+}
+
 void AppleDiskIIInterfaceCard::notify(OEComponent *sender, int notification, void *data)
 {
     switch (notification)
@@ -176,6 +186,57 @@ void AppleDiskIIInterfaceCard::notify(OEComponent *sender, int notification, voi
     updateDriveEnableControl();
 }
 
+bool AppleDiskIIInterfaceCard::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(dataRegister);
+    snapshot->write(driveEnableControl);
+    snapshot->write(phaseControl);
+    snapshot->write(driveOn);
+    snapshot->write(driveSel);
+    snapshot->write(sequencerMode);
+    snapshot->write(sequencerState);
+    snapshot->write(timerOn);
+    snapshot->write(reset);
+    snapshot->write(lastCycles);
+    snapshot->write(bulkActivity);
+    
+    return true;
+}
+
+bool AppleDiskIIInterfaceCard::deserialize(OESnapshot *snapshot)
+{
+    bool lastDriveEnableControl = driveEnableControl;
+    OEComponent *lastDrive = currentDrive;
+    
+    if (!snapshot->read(dataRegister) ||
+        !snapshot->read(driveEnableControl) ||
+        !snapshot->read(phaseControl) ||
+        !snapshot->read(driveOn) ||
+        !snapshot->read(driveSel) ||
+        !snapshot->read(sequencerMode) ||
+        !snapshot->read(sequencerState) ||
+        !snapshot->read(timerOn) ||
+        !snapshot->read(reset) ||
+        !snapshot->read(lastCycles) ||
+        !snapshot->read(bulkActivity) ||
+        (driveSel >= 5))
+        return false;
+    
+    currentDrive = drive[driveSel];
+    
+    // Drive timers and the bulk activity count are restored by the control bus
+    if ((lastDrive != currentDrive) ||
+        (lastDriveEnableControl != driveEnableControl))
+    {
+        if (lastDriveEnableControl)
+            lastDrive->postMessage(this, APPLEII_CLEAR_DRIVEENABLE, NULL);
+        
+        updateDriveEnabled();
+    }
+    
+    return true;
+}
+
 OEChar AppleDiskIIInterfaceCard::read(OEAddress address)
 {
     updateSwitches(address);
@@ -305,6 +366,23 @@ void AppleDiskIIInterfaceCard::updateDriveEnabled()
     currentDrive->postMessage(this, driveEnableControl ?
                               APPLEII_ASSERT_DRIVEENABLE :
                               APPLEII_CLEAR_DRIVEENABLE, NULL);
+                              
+    updateBulkActivity();
+}
+
+// A spinning drive is bulk activity, so the bus may be warped
+void AppleDiskIIInterfaceCard::updateBulkActivity()
+{
+    bool value = driveEnableControl && (currentDrive != &dummyDrive);
+    
+    if (bulkActivity == value)
+        return;
+        
+    bulkActivity = value;
+    
+    controlBus->postMessage(this, (bulkActivity ?
+                                   CONTROLBUS_ASSERT_BULKACTIVITY :
+                                   CONTROLBUS_CLEAR_BULKACTIVITY), NULL);
 }
 
 void AppleDiskIIInterfaceCard::selectDrive(OEInt value)
@@ -23,9 +23,13 @@ public:
 	bool setRef(string name, OEComponent *ref);
     bool init();
 	void update();
+    void dispose();
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
     
@@ -61,11 +65,14 @@ private:
     
     OELong lastCycles;
     
+    bool bulkActivity;
+    
     void updateSwitches(OEAddress address);
     void updatePhaseControl();
     void updateDriveEnableControl();
     void updateDriveEnabled();
     void updateDriveSelection(OEInt value);
+    void updateBulkActivity();
 };
 
 #endif
@@ -11,6 +11,7 @@
 #include "AppleGraphicsTablet.h"
 
 #include "DeviceInterface.h"
+#include "EmulationInterface.h"
 #include "CanvasInterface.h"
 #include "AppleIIInterface.h"
 
@@ -81,5 +82,15 @@ bool AppleGraphicsTablet::init()
 
 void AppleGraphicsTablet::notify(OEComponent *sender, int notification, void *data)
 {
+    if (notification == CANVAS_POINTER_DID_CHANGE)
+    {
+        EmulationInput input = {
+            sender, notification, EMULATION_INPUT_VALUE, data, sizeof(CanvasHIDEvent)
+        };
+        
+        if (device->postMessage(this, DEVICE_FILTER_INPUT, &input))
+            return;
+    }
+    
     postNotification(sender, notification, data);
 }
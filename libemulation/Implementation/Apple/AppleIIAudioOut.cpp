@@ -66,6 +66,22 @@ bool AppleIIAudioOut::init()
     return true;
 }
 
+bool AppleIIAudioOut::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(cassetteOut);
+    snapshot->write(lastCycles);
+    snapshot->write(relaxationState);
+    
+    return true;
+}
+
+bool AppleIIAudioOut::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(cassetteOut) &&
+            snapshot->read(lastCycles) &&
+            snapshot->read(relaxationState));
+}
+
 OEChar AppleIIAudioOut::read(OEAddress address)
 {
     write(address, 0);
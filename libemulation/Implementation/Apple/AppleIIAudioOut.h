@@ -20,6 +20,9 @@ public:
 	bool setRef(string name, OEComponent *ref);
 	bool init();
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
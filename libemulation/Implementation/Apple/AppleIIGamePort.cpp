@@ -171,6 +171,33 @@ void AppleIIGamePort::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+bool AppleIIGamePort::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(pdl);
+    snapshot->write(pb);
+    snapshot->write(an);
+    snapshot->write(timerStart);
+    
+    return true;
+}
+
+// Annunciator observers follow the restored state
+bool AppleIIGamePort::deserialize(OESnapshot *snapshot)
+{
+    bool value[4];
+    
+    if (!snapshot->read(pdl) ||
+        !snapshot->read(pb) ||
+        !snapshot->read(value) ||
+        !snapshot->read(timerStart))
+        return false;
+    
+    for (OEInt i = 0; i < 4; i++)
+        setAN(i, value[i]);
+    
+    return true;
+}
+
 OEChar AppleIIGamePort::read(OEAddress address)
 {
     OEChar value = floatingBus->read(address);
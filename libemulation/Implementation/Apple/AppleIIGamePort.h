@@ -29,6 +29,9 @@ public:
 	bool postMessage(OEComponent *sender, int message, void *data);
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
@@ -70,6 +70,24 @@ void AppleIIIDiskIO::notify(OEComponent *sender, int notification, void *data)
         AppleDiskIIInterfaceCard::notify(sender, notification, data);
 }
 
+bool AppleIIIDiskIO::serialize(OESnapshot *snapshot)
+{
+    if (!AppleDiskIIInterfaceCard::serialize(snapshot))
+        return false;
+    
+    snapshot->write(appleIIMode);
+    snapshot->write(driveSelect);
+    
+    return true;
+}
+
+bool AppleIIIDiskIO::deserialize(OESnapshot *snapshot)
+{
+    return (AppleDiskIIInterfaceCard::deserialize(snapshot) &&
+            snapshot->read(appleIIMode) &&
+            snapshot->read(driveSelect));
+}
+
 OEChar AppleIIIDiskIO::read(OEAddress address)
 {
     updateSwitches(address);
@@ -18,6 +18,22 @@ AppleIIIGamePort::AppleIIIGamePort()
 {
 }
 
+bool AppleIIIGamePort::serialize(OESnapshot *snapshot)
+{
+    if (!AppleIIGamePort::serialize(snapshot))
+        return false;
+    
+    snapshot->write(channelSelect);
+    
+    return true;
+}
+
+bool AppleIIIGamePort::deserialize(OESnapshot *snapshot)
+{
+    return (AppleIIGamePort::deserialize(snapshot) &&
+            snapshot->read(channelSelect));
+}
+
 OEChar AppleIIIGamePort::read(OEAddress address)
 {
     OEChar value = floatingBus->read(address);
@@ -18,6 +18,9 @@ class AppleIIIGamePort : public AppleIIGamePort
 public:
     AppleIIIGamePort();
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
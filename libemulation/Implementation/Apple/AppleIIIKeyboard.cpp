@@ -24,6 +24,22 @@ AppleIIIKeyboard::AppleIIIKeyboard() : AppleIIKeyboard()
                         APPLEIII_KEYBOARD_CONNECTED);
 }
 
+bool AppleIIIKeyboard::serialize(OESnapshot *snapshot)
+{
+    if (!AppleIIKeyboard::serialize(snapshot))
+        return false;
+    
+    snapshot->write(appleIIIKeyFlags);
+    
+    return true;
+}
+
+bool AppleIIIKeyboard::deserialize(OESnapshot *snapshot)
+{
+    return (AppleIIKeyboard::deserialize(snapshot) &&
+            snapshot->read(appleIIIKeyFlags));
+}
+
 OEChar AppleIIIKeyboard::read(OEAddress address)
 {
     if (address & 0x10)
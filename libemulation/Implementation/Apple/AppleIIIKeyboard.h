@@ -18,6 +18,9 @@ class AppleIIIKeyboard : public AppleIIKeyboard
 public:
     AppleIIIKeyboard();
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	
 private:
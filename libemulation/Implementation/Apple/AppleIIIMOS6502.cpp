@@ -64,6 +64,26 @@ void AppleIIIMOS6502::notify(OEComponent *sender, int notification, void *data)
         setZeroPage(*((OEChar *)data));
 }
 
+bool AppleIIIMOS6502::serialize(OESnapshot *snapshot)
+{
+    if (!MOS6502::serialize(snapshot))
+        return false;
+    
+    snapshot->write(extendedMemoryEnabled);
+    snapshot->write(extendedPageAddress);
+    snapshot->write(extendedMemoryBank);
+    
+    return true;
+}
+
+bool AppleIIIMOS6502::deserialize(OESnapshot *snapshot)
+{
+    return (MOS6502::deserialize(snapshot) &&
+            snapshot->read(extendedMemoryEnabled) &&
+            snapshot->read(extendedPageAddress) &&
+            snapshot->read(extendedMemoryBank));
+}
+
 void AppleIIIMOS6502::execute()
 {
     if (powerState != CONTROLBUS_POWERSTATE_ON)
@@ -23,6 +23,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 private:
     OEComponent *extendedMemoryBus;
     OEComponent *systemControl;
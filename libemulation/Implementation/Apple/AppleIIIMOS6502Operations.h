@@ -33,14 +33,14 @@ if (extendedMemoryEnabled)                                  \
     }                                                       \
     else                                                    \
     {                                                       \
-        RDMEM((EAH << 8) | ((EAL + Y) & 0xff));             \
+        RDDUM((EAH << 8) | ((EAL + Y) & 0xff));             \
         EAW += Y;                                           \
         tmp = RDMEM_ID(EAA);                                \
     }                                                       \
 }                                                           \
 else                                                        \
 {                                                           \
-    RDMEM((EAH << 8) | ((EAL + Y) & 0xff));                 \
+    RDDUM((EAH << 8) | ((EAL + Y) & 0xff));                 \
     EAW += Y;                                               \
     tmp = RDMEM_ID(EAA);                                    \
 }
@@ -64,14 +64,14 @@ if (extendedMemoryEnabled)                                  \
     }                                                       \
     else                                                    \
     {                                                       \
-        RDMEM((EAH << 8) | ((EAL + Y) & 0xff));             \
+        RDDUM((EAH << 8) | ((EAL + Y) & 0xff));             \
         EAW += Y;                                           \
         WRMEM_ID(EAA, tmp);                                 \
     }                                                       \
 }                                                           \
 else                                                        \
 {                                                           \
-    RDMEM((EAH << 8) | ((EAL + Y) & 0xff));                 \
+    RDDUM((EAH << 8) | ((EAL + Y) & 0xff));                 \
     EAW += Y;                                               \
     WRMEM_ID(EAA, tmp);                                     \
 }
@@ -51,6 +51,16 @@ void AppleIIIRTC::notify(OEComponent *sender, int notification, void *data)
     zeroPage = *((OEChar *)data);
 }
 
+bool AppleIIIRTC::serialize(OESnapshot *snapshot)
+{
+    return snapshot->write(zeroPage);
+}
+
+bool AppleIIIRTC::deserialize(OESnapshot *snapshot)
+{
+    return snapshot->read(zeroPage);
+}
+
 OEChar AppleIIIRTC::read(OEAddress address)
 {
     return mm58167->read(zeroPage);
@@ -226,6 +226,42 @@ void AppleIIISystemControl::notify(OEComponent *sender, int notification, void *
     }
 }
 
+// The CPU clock multiplier is restored by the control bus
+bool AppleIIISystemControl::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(environment);
+    snapshot->write(zeroPage);
+    snapshot->write(ramBank);
+    snapshot->write(sound);
+    snapshot->write(extendedRAMBank);
+    snapshot->write(monitorRequested);
+    
+    return true;
+}
+
+bool AppleIIISystemControl::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(environment) ||
+        !snapshot->read(zeroPage) ||
+        !snapshot->read(ramBank) ||
+        !snapshot->read(sound) ||
+        !snapshot->read(extendedRAMBank) ||
+        !snapshot->read(monitorRequested))
+        return false;
+    
+    bool appleIIMode = !OEGetBit(ramBank, APPLEIII_NOT_APPLEIIMODE);
+    
+    postNotification(this, APPLEIII_ENVIRONMENT_DID_CHANGE, &environment);
+    postNotification(this, APPLEIII_APPLEIIMODE_DID_CHANGE, &appleIIMode);
+    
+    updateZeroPage();
+    updateAltStack();
+    updateRAMBank();
+    updateExtendedRAMBank();
+    
+    return true;
+}
+
 OEChar AppleIIISystemControl::read(OEAddress address)
 {
 //    logMessage("R " + getString(address));
@@ -72,6 +72,9 @@ AppleIIIVideo::AppleIIIVideo()
     videoEnabled = false;
     colorKiller = true;
     
+    hires40Font = NULL;
+    hires80Font = NULL;
+    
     buildLoresFont();
     buildHiresFont();
     
@@ -97,6 +100,12 @@ AppleIIIVideo::AppleIIIVideo()
     loadTextFont("", &characterSet);
 }
 
+AppleIIIVideo::~AppleIIIVideo()
+{
+    OESharedData::release(hires40Font);
+    OESharedData::release(hires80Font);
+}
+
 bool AppleIIIVideo::setValue(string name, string value)
 {
 	if (name == "flashFrameNum")
@@ -411,6 +420,49 @@ void AppleIIIVideo::notify(OEComponent *sender, int notification, void *data)
         refreshVideo();
 }
 
+// The framebuffer is not stored: it is redrawn over the next frame
+bool AppleIIIVideo::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(mode);
+    snapshot->write(characterSet);
+    snapshot->write(videoEnabled);
+    snapshot->write(frameStart);
+    snapshot->write(currentTimer);
+    snapshot->write(lastCycles);
+    snapshot->write(flash);
+    snapshot->write(flashCount);
+    snapshot->write(powerState);
+    snapshot->write(videoInhibitCount);
+    snapshot->write(appleIIMode);
+    
+    return true;
+}
+
+bool AppleIIIVideo::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(mode) ||
+        !snapshot->read(characterSet) ||
+        !snapshot->read(videoEnabled) ||
+        !snapshot->read(frameStart) ||
+        !snapshot->read(currentTimer) ||
+        !snapshot->read(lastCycles) ||
+        !snapshot->read(flash) ||
+        !snapshot->read(flashCount) ||
+        !snapshot->read(powerState) ||
+        !snapshot->read(videoInhibitCount) ||
+        !snapshot->read(appleIIMode))
+        return false;
+    
+    loadTextFont("", &characterSet);
+    
+    pendingCycles = frameCycleNum;
+    framebufferModified = true;
+    
+    configureDraw();
+    
+    return true;
+}
+
 OEChar AppleIIIVideo::read(OEAddress address)
 {
     write(address, 0);
@@ -486,8 +538,20 @@ bool AppleIIIVideo::updateCharacterSet()
 
 void AppleIIIVideo::buildHiresFont()
 {
-    hires40Font.resize(2 * FONT_CHARNUM * FONT_CHARWIDTH);
-    hires80Font.resize(FONT_CHARNUM * FONT_CHARWIDTH);
+    // The tables are shared by all Apple III video instances
+    hires40Font = OESharedData::retain("AppleIIIVideo.hires40Font");
+    hires80Font = OESharedData::retain("AppleIIIVideo.hires80Font");
+    
+    if (hires40Font && hires80Font)
+        return;
+    
+    OESharedData::release(hires40Font);
+    OESharedData::release(hires80Font);
+    
+    OEData font40;
+    OEData font80;
+    font40.resize(2 * FONT_CHARNUM * FONT_CHARWIDTH);
+    font80.resize(2 * FONT_CHARNUM * FONT_CHARWIDTH);
     
     for (OEInt i = 0; i < 2 * FONT_CHARNUM; i++)
     {
@@ -498,12 +562,15 @@ void AppleIIIVideo::buildHiresFont()
             bool bit;
             
             bit = (value >> ((x + 2) >> 1)) & 0x1;
-            hires40Font[i * FONT_CHARWIDTH + x] = bit ? 0xff : 0x00;
+            font40[i * FONT_CHARWIDTH + x] = bit ? 0xff : 0x00;
             
             bit = (value >> x) & 0x1;
-            hires80Font[i * FONT_CHARWIDTH + x] = bit ? 0xff : 0x00;
+            font80[i * FONT_CHARWIDTH + x] = bit ? 0xff : 0x00;
         }
     }
+    
+    hires40Font = OESharedData::retain("AppleIIIVideo.hires40Font", &font40);
+    hires80Font = OESharedData::retain("AppleIIIVideo.hires80Font", &font80);
 }
 
 void AppleIIIVideo::configureDraw()
@@ -536,7 +603,7 @@ void AppleIIIVideo::configureDraw()
         {
             draw = &AppleIIIVideo::drawHires40MLine;
             drawMemory1 = vramp + 0x2000 * page;
-            drawFont = (OEChar *)&hires40Font.front();
+            drawFont = (OEChar *)&hires40Font->front();
         }
     }
     else
@@ -585,7 +652,7 @@ void AppleIIIVideo::configureDraw()
                 
                 draw = &AppleIIIVideo::drawHires40MLine;
                 drawMemory1 = vramp + 0x2000 * page;
-                drawFont = (OEChar *)&hires40Font.front();
+                drawFont = (OEChar *)&hires40Font->front();
                 
                 break;
                 
@@ -596,7 +663,7 @@ void AppleIIIVideo::configureDraw()
                 draw = &AppleIIIVideo::drawHires40CLine;
                 drawMemory1 = vramp + 0x0000 + 0x4000 * page;
                 drawMemory1 = vramp + 0x2000 + 0x4000 * !page;
-                drawFont = (OEChar *)&hires40Font.front();
+                drawFont = (OEChar *)&hires40Font->front();
                 
                 break;
                 
@@ -607,7 +674,7 @@ void AppleIIIVideo::configureDraw()
                 draw = &AppleIIIVideo::drawHires80Line;
                 drawMemory1 = vramp + 0x0000 + 0x4000 * page;
                 drawMemory2 = vramp + 0x2000 + 0x4000 * !page;
-                drawFont = (OEChar *)&hires80Font.front();
+                drawFont = (OEChar *)&hires80Font->front();
                 
                 break;
                 
@@ -618,7 +685,7 @@ void AppleIIIVideo::configureDraw()
                 draw = &AppleIIIVideo::drawHires140Line;
                 drawMemory1 = vramp + 0x0000 + 0x4000 * page;
                 drawMemory2 = vramp + 0x2000 + 0x4000 * !page;
-                drawFont = (OEChar *)&hires80Font.front();
+                drawFont = (OEChar *)&hires80Font->front();
                 
                 break;
         }
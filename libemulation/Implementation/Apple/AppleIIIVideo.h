@@ -13,6 +13,7 @@
 
 #include "OEComponent.h"
 #include "OEImage.h"
+#include "OESharedData.h"
 
 #include "ControlBusInterface.h"
 
@@ -20,6 +21,7 @@ class AppleIIIVideo : public OEComponent
 {
 public:
     AppleIIIVideo();
+    ~AppleIIIVideo();
     
 	bool setValue(string name, string value);
 	bool getValue(string name, string& value);
@@ -33,6 +35,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
@@ -70,8 +75,8 @@ private:
     OEData text40Font;
     OEData text80Font;
     OEData loresFont;
-    OEData hires40Font;
-    OEData hires80Font;
+    const OEData *hires40Font;
+    const OEData *hires80Font;
     
     OEData framebuffer;
     OEChar *framebufferp;
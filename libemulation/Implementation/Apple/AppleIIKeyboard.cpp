@@ -10,6 +10,7 @@
 
 #include "AppleIIKeyboard.h"
 
+#include "DeviceInterface.h"
 #include "ControlBusInterface.h"
 
 #include "AppleIIInterface.h"
@@ -18,6 +19,7 @@ AppleIIKeyboard::AppleIIKeyboard()
 {
     type = APPLEIIKEYBOARD_TYPE_STANDARD;
     
+    device = NULL;
     controlBus = NULL;
     floatingBus = NULL;
     gamePort = NULL;
@@ -28,6 +30,10 @@ AppleIIKeyboard::AppleIIKeyboard()
     
     keyLatch = 0;
     keyStrobe = false;
+    
+    pasteSize = 0;
+    pastePercent = -1;
+    pasteWarp = false;
 }
 
 bool AppleIIKeyboard::setValue(string name, string value)
@@ -66,7 +72,9 @@ bool AppleIIKeyboard::getValue(string name, string& value)
 
 bool AppleIIKeyboard::setRef(string name, OEComponent *ref)
 {
-    if (name == "controlBus")
+    if (name == "device")
+        device = ref;
+    else if (name == "controlBus")
     {
         if (controlBus)
         {
@@ -141,6 +149,8 @@ void AppleIIKeyboard::notify(OEComponent *sender, int notification, void *data)
                 while (!pasteBuffer.empty())
                     pasteBuffer.pop();
                 
+                updatePaste();
+                
                 break;
         }
     }
@@ -293,6 +303,21 @@ void AppleIIKeyboard::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+// The paste buffer is host input, and is not stored
+bool AppleIIKeyboard::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(keyLatch);
+    snapshot->write(keyStrobe);
+    
+    return true;
+}
+
+bool AppleIIKeyboard::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(keyLatch) &&
+            snapshot->read(keyStrobe));
+}
+
 OEChar AppleIIKeyboard::read(OEAddress address)
 {
     if (address & 0x10)
@@ -390,6 +415,8 @@ void AppleIIKeyboard::paste(wstring *s)
     for (OEInt i = 0; i < s->size(); i++)
         pasteBuffer.push(s->at(i));
     
+    pasteSize += (OEInt) s->size();
+    
     emptyPasteBuffer();
 }
 
@@ -402,10 +429,49 @@ void AppleIIKeyboard::emptyPasteBuffer()
         if (c == '\n')
             c = '\r';
         else if (c == '\r')
+        {
+            pasteBuffer.pop();
+            
             continue;
+        }
         
         sendKey(c);
         
         pasteBuffer.pop();
     }
+    
+    updatePaste();
+}
+
+// The bus is warped while the paste buffer drains
+void AppleIIKeyboard::updatePaste()
+{
+    bool value = !pasteBuffer.empty();
+    
+    if (pasteWarp != value)
+    {
+        pasteWarp = value;
+        
+        controlBus->postMessage(this, (pasteWarp ?
+                                       CONTROLBUS_ASSERT_WARP :
+                                       CONTROLBUS_CLEAR_WARP), NULL);
+    }
+    
+    if (!pasteWarp)
+        pasteSize = 0;
+    
+    OESInt percent = -1;
+    
+    if (pasteSize)
+        percent = 100 * (pasteSize - (OEInt) pasteBuffer.size()) / pasteSize;
+    
+    if (!device || (pastePercent == percent))
+        return;
+    
+    pastePercent = percent;
+    
+    float progress = (percent < 0) ? -1 : percent / 100.0F;
+    
+    device->postMessage(this, DEVICE_SET_PROGRESS, &progress);
+    device->postMessage(this, DEVICE_UPDATE, NULL);
 }
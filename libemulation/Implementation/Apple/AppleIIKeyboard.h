@@ -45,6 +45,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
@@ -69,14 +72,19 @@ protected:
     void emptyPasteBuffer();
     
 private:
+    OEComponent *device;
     OEComponent *gamePort;
     
     AppleIIKeyboardState state;
     OEInt stateUsageId;
     
     queue<OEChar> pasteBuffer;
+    OEInt pasteSize;
+    OESInt pastePercent;
+    bool pasteWarp;
     
     void paste(wstring *s);
+    void updatePaste();
 };
 
 #endif
@@ -119,6 +119,25 @@ void AppleIISlotController::notify(OEComponent *sender, int notification, void *
     enableSlotExpansion(false);
 }
 
+bool AppleIISlotController::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(en);
+    
+    return true;
+}
+
+bool AppleIISlotController::deserialize(OESnapshot *snapshot)
+{
+    bool value;
+    
+    if (!snapshot->read(value))
+        return false;
+    
+    enableSlotExpansion(value);
+    
+    return true;
+}
+
 OEChar AppleIISlotController::read(OEAddress address)
 {
     enableSlotExpansion(true);
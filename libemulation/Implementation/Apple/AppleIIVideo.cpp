@@ -101,6 +101,10 @@ AppleIIVideo::AppleIIVideo()
     videoEnabled = false;
     colorKiller = true;
     
+    loresFont = NULL;
+    hires40Font = NULL;
+    hires80Font = NULL;
+    
     buildLoresFont();
     buildHires80Font();
     
@@ -119,11 +123,29 @@ AppleIIVideo::AppleIIVideo()
     flashCount = 0;
     
     powerState = CONTROLBUS_POWERSTATE_ON;
+    warp = false;
     an2 = false;
     monitorConnected = false;
     videoInhibitCount = 0;
 }
 
+AppleIIVideo::~AppleIIVideo()
+{
+    for (map<string, const OEData *>::iterator i = text40Font.begin();
+         i != text40Font.end();
+         i++)
+        OESharedData::release(i->second);
+    
+    for (map<string, const OEData *>::iterator i = text80Font.begin();
+         i != text80Font.end();
+         i++)
+        OESharedData::release(i->second);
+    
+    OESharedData::release(loresFont);
+    OESharedData::release(hires40Font);
+    OESharedData::release(hires80Font);
+}
+
 bool AppleIIVideo::setValue(string name, string value)
 {
 	if (name == "model")
@@ -221,12 +243,14 @@ bool AppleIIVideo::setRef(string name, OEComponent *ref)
         {
             controlBus->removeObserver(this, CONTROLBUS_POWERSTATE_DID_CHANGE);
             controlBus->removeObserver(this, CONTROLBUS_TIMER_DID_FIRE);
+            controlBus->removeObserver(this, CONTROLBUS_WARP_DID_CHANGE);
         }
         controlBus = ref;
         if (controlBus)
         {
             controlBus->addObserver(this, CONTROLBUS_POWERSTATE_DID_CHANGE);
             controlBus->addObserver(this, CONTROLBUS_TIMER_DID_FIRE);
+            controlBus->addObserver(this, CONTROLBUS_WARP_DID_CHANGE);
         }
     }
     else if (name == "gamePort")
@@ -447,6 +471,11 @@ void AppleIIVideo::notify(OEComponent *sender, int notification, void *data)
             case CONTROLBUS_TIMER_DID_FIRE:
                 scheduleNextTimer(*((OESLong *)data));
                 
+                break;
+                
+            case CONTROLBUS_WARP_DID_CHANGE:
+                warp = *((bool *)data);
+                
                 break;
         }
     }
@@ -480,6 +509,45 @@ void AppleIIVideo::notify(OEComponent *sender, int notification, void *data)
         refreshVideo();
 }
 
+// The image is not stored: it is redrawn over the next frame
+bool AppleIIVideo::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(mode);
+    snapshot->write(videoEnabled);
+    snapshot->write(frameStart);
+    snapshot->write(currentTimer);
+    snapshot->write(lastCycles);
+    snapshot->write(flash);
+    snapshot->write(flashCount);
+    snapshot->write(powerState);
+    snapshot->write(videoInhibitCount);
+    snapshot->write(an2);
+    
+    return true;
+}
+
+bool AppleIIVideo::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(mode) ||
+        !snapshot->read(videoEnabled) ||
+        !snapshot->read(frameStart) ||
+        !snapshot->read(currentTimer) ||
+        !snapshot->read(lastCycles) ||
+        !snapshot->read(flash) ||
+        !snapshot->read(flashCount) ||
+        !snapshot->read(powerState) ||
+        !snapshot->read(videoInhibitCount) ||
+        !snapshot->read(an2))
+        return false;
+    
+    pendingCycles = frameCycleNum;
+    imageModified = true;
+    
+    configureDraw();
+    
+    return true;
+}
+
 OEChar AppleIIVideo::read(OEAddress address)
 {
     write(address, 0);
@@ -531,8 +599,49 @@ bool AppleIIVideo::loadTextFont(string name, OEData *data)
     if (data->size() < (CHAR_NUM * CHAR_HEIGHT))
         return false;
     
-    OEData font40;
-    OEData font80;
+    // Font tables are shared by all instances that load the same font
+    string key40 = OESharedData::getKey("AppleIIVideo.text40Font." +
+                                        getString(model), *data);
+    string key80 = OESharedData::getKey("AppleIIVideo.text80Font." +
+                                        getString(model), *data);
+    
+    const OEData *sharedFont40 = OESharedData::retain(key40);
+    const OEData *sharedFont80 = OESharedData::retain(key80);
+    
+    if (!sharedFont40 || !sharedFont80)
+    {
+        OEData font40;
+        OEData font80;
+        
+        buildTextFont(data, font40, font80);
+        
+        if (!sharedFont40)
+            sharedFont40 = OESharedData::retain(key40, &font40);
+        if (!sharedFont80)
+            sharedFont80 = OESharedData::retain(key80, &font80);
+    }
+    
+    if (!sharedFont40 || !sharedFont80)
+    {
+        OESharedData::release(sharedFont40);
+        OESharedData::release(sharedFont80);
+        
+        return false;
+    }
+    
+    if (text40Font.count(name))
+        OESharedData::release(text40Font[name]);
+    if (text80Font.count(name))
+        OESharedData::release(text80Font[name]);
+    
+    text40Font[name] = sharedFont40;
+    text80Font[name] = sharedFont80;
+    
+    return true;
+}
+
+void AppleIIVideo::buildTextFont(OEData *data, OEData& font40, OEData& font80)
+{
     font40.resize(4 * FONT_SIZE);
     font80.resize(4 * FONT_SIZE);
     
@@ -571,16 +680,20 @@ bool AppleIIVideo::loadTextFont(string name, OEData *data)
             }
         }
     }
-    
-    text40Font[name] = font40;
-    text80Font[name] = font80;
-    
-    return true;
 }
 
 void AppleIIVideo::buildLoresFont()
 {
-    loresFont.resize(2 * FONT_SIZE);
+    if (loresFont)
+        return;
+    
+    loresFont = OESharedData::retain("AppleIIVideo.loresFont");
+    
+    if (loresFont)
+        return;
+    
+    OEData font;
+    font.resize(2 * FONT_SIZE);
     
     for (OEInt i = 0; i < 2 * CHAR_NUM; i++)
     {
@@ -592,13 +705,15 @@ void AppleIIVideo::buildLoresFont()
             
             for (OEInt x = 0; x < CHAR_WIDTH; x++)
             {
-                loresFont[(i * CHAR_HEIGHT + y) *
-                          CHAR_WIDTH + x] = (value & 0x1) ? 0xff : 0x00;
+                font[(i * CHAR_HEIGHT + y) *
+                     CHAR_WIDTH + x] = (value & 0x1) ? 0xff : 0x00;
                 
                 value >>= 1;
             }
         }
     }
+    
+    loresFont = OESharedData::retain("AppleIIVideo.loresFont", &font);
 }
 
 void AppleIIVideo::buildHires40Font()
@@ -607,7 +722,17 @@ void AppleIIVideo::buildHires40Font()
                          (model == MODEL_IIJPLUS) ||
                          (model == MODEL_IIE));
     
-    hires40Font.resize(2 * CHAR_NUM * CHAR_WIDTH);
+    string key = "AppleIIVideo.hires40Font." + getString((OEInt) delayEnabled);
+    
+    OESharedData::release(hires40Font);
+    
+    hires40Font = OESharedData::retain(key);
+    
+    if (hires40Font)
+        return;
+    
+    OEData font;
+    font.resize(2 * CHAR_NUM * CHAR_WIDTH);
     
     for (OEInt i = 0; i < 2 * CHAR_NUM; i++)
     {
@@ -618,14 +743,25 @@ void AppleIIVideo::buildHires40Font()
         {
             bool bit = (value >> ((x + 2 - delay) >> 1)) & 0x1;
             
-            hires40Font[i * CHAR_WIDTH + x] = bit ? 0xff : 0x00;
+            font[i * CHAR_WIDTH + x] = bit ? 0xff : 0x00;
         }
     }
+    
+    hires40Font = OESharedData::retain(key, &font);
 }
 
 void AppleIIVideo::buildHires80Font()
 {
-    hires80Font.resize(CHAR_NUM * CHAR_WIDTH);
+    if (hires80Font)
+        return;
+    
+    hires80Font = OESharedData::retain("AppleIIVideo.hires80Font");
+    
+    if (hires80Font)
+        return;
+    
+    OEData font;
+    font.resize(CHAR_NUM * CHAR_WIDTH);
     
     for (OEInt i = 0; i < CHAR_NUM; i++)
     {
@@ -635,9 +771,11 @@ void AppleIIVideo::buildHires80Font()
         {
             bool bit = (value >> x) & 0x1;
             
-            hires80Font[i * CHAR_WIDTH + x] = bit ? 0xff : 0x00;
+            font[i * CHAR_WIDTH + x] = bit ? 0xff : 0x00;
         }
     }
+    
+    hires80Font = OESharedData::retain("AppleIIVideo.hires80Font", &font);
 }
 
 void AppleIIVideo::setMode(OEInt mask, bool value)
@@ -668,21 +806,24 @@ void AppleIIVideo::configureDraw()
     {
         draw = &AppleIIVideo::drawText40Line;
         drawMemory1 = textMemory[page];
-        drawFont = (OEChar *)&text40Font[characterSet].front();
-        
-        drawFont += ((an2 << 1) | flash) * FONT_SIZE;
+        if (text40Font.count(characterSet))
+        {
+            drawFont = (OEChar *)&text40Font[characterSet]->front();
+            
+            drawFont += ((an2 << 1) | flash) * FONT_SIZE;
+        }
     }
     else if (!OEGetBit(mode, MODE_HIRES))
     {
         draw = &AppleIIVideo::drawLores40Line;
         drawMemory1 = textMemory[page];
-        drawFont = (OEChar *)&loresFont.front();
+        drawFont = (OEChar *)&loresFont->front();
     }
     else
     {
         draw = &AppleIIVideo::drawHires40Line;
         drawMemory1 = hiresMemory[page];
-        drawFont = (OEChar *)&hires40Font.front();
+        drawFont = (OEChar *)&hires40Font->front();
     }
     
     if (colorKiller != newColorKiller)
@@ -973,7 +1114,8 @@ void AppleIIVideo::scheduleNextTimer(OESLong cycles)
             
             postNotification(this, APPLEII_VBL_DID_CHANGE, &vbl);
             
-            if (imageModified)
+            // Frames are not presented while the bus is warped
+            if (imageModified && !warp)
             {
                 imageModified = false;
                 
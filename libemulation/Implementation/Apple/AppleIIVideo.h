@@ -10,6 +10,7 @@
 
 #include "OEComponent.h"
 #include "OEImage.h"
+#include "OESharedData.h"
 
 #include "ControlBusInterface.h"
 
@@ -17,6 +18,7 @@ class AppleIIVideo : public OEComponent
 {
 public:
     AppleIIVideo();
+    ~AppleIIVideo();
     
 	bool setValue(string name, string value);
 	bool getValue(string name, string& value);
@@ -29,6 +31,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
@@ -75,11 +80,11 @@ private:
     bool videoEnabled;
     bool colorKiller;
     
-    map<string, OEData> text40Font;
-    map<string, OEData> text80Font;
-    OEData loresFont;
-    OEData hires40Font;
-    OEData hires80Font;
+    map<string, const OEData *> text40Font;
+    map<string, const OEData *> text80Font;
+    const OEData *loresFont;
+    const OEData *hires40Font;
+    const OEData *hires80Font;
     
     OEImage image;
     OEChar *imagep;
@@ -107,6 +112,7 @@ private:
     
     // State
     ControlBusPowerState powerState;
+    bool warp;
     bool monitorConnected;
     OEInt videoInhibitCount;
     bool an2;
@@ -114,6 +120,7 @@ private:
     void initOffsets();
     
     bool loadTextFont(string name, OEData *data);
+    void buildTextFont(OEData *data, OEData& font40, OEData& font80);
     void buildLoresFont();
     void buildHires40Font();
     void buildHires80Font();
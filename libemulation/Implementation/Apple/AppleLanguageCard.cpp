@@ -144,6 +144,30 @@ void AppleLanguageCard::notify(OEComponent *sender, int notification, void *data
     }
 }
 
+bool AppleLanguageCard::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(bank1);
+    snapshot->write(ramRead);
+    snapshot->write(preWrite);
+    snapshot->write(ramWrite);
+    
+    return true;
+}
+
+bool AppleLanguageCard::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(bank1) ||
+        !snapshot->read(ramRead) ||
+        !snapshot->read(preWrite) ||
+        !snapshot->read(ramWrite))
+        return false;
+    
+    updateBankSwitcher();
+    updateBankOffset();
+    
+    return true;
+}
+
 OEChar AppleLanguageCard::read(OEAddress address)
 {
     if (titanIII && (address & 0x4))
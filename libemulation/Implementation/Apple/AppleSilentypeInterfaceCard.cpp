@@ -48,6 +48,8 @@
 #define SERIAL_STORECLOCK               (1 << 2)
 #define SERIAL_MACHINESTATUS            (1 << 2)
 
+#define SILENTYPE_QUIETTIME             (0.25F * APPLEII_CLOCKFREQUENCY)
+
 AppleSilentypeInterfaceCard::AppleSilentypeInterfaceCard()
 {
     controlBus = NULL;
@@ -55,6 +57,10 @@ AppleSilentypeInterfaceCard::AppleSilentypeInterfaceCard()
     slotController = NULL;
     memoryMapper = NULL;
     printer = NULL;
+    
+    bulkActivity = false;
+    lastWriteCycles = 0;
+    timerOn = false;
 }
 
 bool AppleSilentypeInterfaceCard::setRef(string name, OEComponent *ref)
@@ -96,14 +102,45 @@ bool AppleSilentypeInterfaceCard::init()
     return true;
 }
 
+void AppleSilentypeInterfaceCard::dispose()
+{
+    setBulkActivity(false);
+}
+
 void AppleSilentypeInterfaceCard::notify(OEComponent *sender, int notification, void *data)
 {
+    if ((sender == controlBus) && (notification == CONTROLBUS_TIMER_DID_FIRE))
+    {
+        timerOn = false;
+        
+        updateBulkActivity();
+        
+        return;
+    }
+    
     if (printer)
         printer->write(0, 0);
     
     setROMEnabled(false);
 }
 
+// The quiet timer and the bulk activity count are restored by the control bus
+bool AppleSilentypeInterfaceCard::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(bulkActivity);
+    snapshot->write(lastWriteCycles);
+    snapshot->write(timerOn);
+    
+    return true;
+}
+
+bool AppleSilentypeInterfaceCard::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(bulkActivity) &&
+            snapshot->read(lastWriteCycles) &&
+            snapshot->read(timerOn));
+}
+
 OEChar AppleSilentypeInterfaceCard::read(OEAddress address)
 {
     OEChar state = 0;
@@ -166,6 +203,10 @@ void AppleSilentypeInterfaceCard::write(OEAddress address, OEChar value)
         OESetBit(state, SERIAL_SHIFTCLOCK, shiftClock);
         if (printer)
             printer->write(0, state);
+            
+        controlBus->postMessage(this, CONTROLBUS_GET_CYCLES, &lastWriteCycles);
+        
+        setBulkActivity(true);
     }
 }
 
@@ -175,3 +216,43 @@ void AppleSilentypeInterfaceCard::setROMEnabled(bool value)
     
     memoryMapper->postMessage(this, ADDRESSMAPPER_SELECT, &m);
 }
+
+void AppleSilentypeInterfaceCard::setBulkActivity(bool value)
+{
+    if (bulkActivity != value)
+    {
+        bulkActivity = value;
+        
+        controlBus->postMessage(this, (bulkActivity ?
+                                       CONTROLBUS_ASSERT_BULKACTIVITY :
+                                       CONTROLBUS_CLEAR_BULKACTIVITY), NULL);
+    }
+    
+    if (bulkActivity && !timerOn)
+    {
+        ControlBusTimer timer = { (OESLong) SILENTYPE_QUIETTIME, 0 };
+        
+        controlBus->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
+        
+        timerOn = true;
+    }
+}
+
+// A print job is streaming until the printer has been quiet for a while
+void AppleSilentypeInterfaceCard::updateBulkActivity()
+{
+    OELong cycles;
+    
+    controlBus->postMessage(this, CONTROLBUS_GET_CYCLES, &cycles);
+    
+    if ((cycles - lastWriteCycles) < SILENTYPE_QUIETTIME)
+    {
+        ControlBusTimer timer = { (OESLong) (SILENTYPE_QUIETTIME - (cycles - lastWriteCycles)), 0 };
+        
+        controlBus->postMessage(this, CONTROLBUS_SCHEDULE_TIMER, &timer);
+        
+        timerOn = true;
+    }
+    else
+        setBulkActivity(false);
+}
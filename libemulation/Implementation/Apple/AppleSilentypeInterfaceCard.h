@@ -17,9 +17,13 @@ public:
 	
     bool setRef(string name, OEComponent *ref);
     bool init();
+    void dispose();
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
     
@@ -30,5 +34,11 @@ private:
     OEComponent *memoryMapper;
     OEComponent *printer;
     
+    bool bulkActivity;
+    OELong lastWriteCycles;
+    bool timerOn;
+    
     void setROMEnabled(bool value);
+    void setBulkActivity(bool value);
+    void updateBulkActivity();
 };
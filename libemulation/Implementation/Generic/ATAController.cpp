@@ -18,7 +18,12 @@
 
 // ATA commands
 #define ATA_READ                0x20
+#define ATA_READ_NORETRY        0x21
 #define ATA_WRITE               0x30
+#define ATA_WRITE_NORETRY       0x31
+#define ATA_READ_MULTIPLE       0xc4
+#define ATA_WRITE_MULTIPLE      0xc5
+#define ATA_SET_MULTIPLE        0xc6
 #define ATA_IDENTIFY            0xec
 #define ATA_SET_FEATURE         0xef
 
@@ -29,14 +34,6 @@
 #define ATA_LBA28               0xe0
 #define ATA_LBA48               0x40
 
-// ATA status codes
-#define ATA_ERR                 (1 << 0)
-#define ATA_DRQ                 (1 << 3)
-#define ATA_DSC                 (1 << 4)
-#define ATA_DF                  (1 << 5)
-#define ATA_RDY                 (1 << 6)
-#define ATA_BSY                 (1 << 7)
-
 // ATA device control bits
 #define ATA_SRST                (1 << 2)
 
@@ -47,9 +44,14 @@
 #define ATA_FIRMWARE_VER_SIZE   (4 * 2)
 #define ATA_MODEL               (27 * 2)
 #define ATA_MODEL_SIZE          (20 * 2)
+#define ATA_MAX_MULTIPLE        (47 * 2)
 #define ATA_SIZE                (57 * 2)
+#define ATA_CUR_MULTIPLE        (59 * 2)
 #define ATA_SIZE2               (60 * 2)
 
+// Maximum sectors per READ/WRITE MULTIPLE block
+#define ATA_MULTIPLE_SECTORS    0x10
+
 ATAController::ATAController()
 {
     drive[0] = NULL;
@@ -61,8 +63,11 @@ ATAController::ATAController()
     
     lba.q = 0;
     sectorCount = 0;
+    multipleCount = 0;
     
     bufferIndex = 0;
+    bufferSize = 0;
+    transferLBA = 0;
     
     driveSel = 0;
     addressMode = ATA_CHS;
@@ -93,6 +98,99 @@ void ATAController::update()
     selectDrive(driveSel);
 }
 
+bool ATAController::postMessage(OEComponent *sender, int message, void *data)
+{
+    switch (message)
+    {
+        case ATACONTROLLER_READ_DATA:
+        {
+            ATAData *ataData = (ATAData *)data;
+            
+            if (!OEGetBit(status, ATA_DRQ) || isWriteCommand() ||
+                pioByteMode || (bufferIndex % ATA_SECTOR_SIZE))
+                return false;
+            
+            OEInt size = bufferSize - bufferIndex;
+            if (size > ataData->size)
+                size = ataData->size - ataData->size % ATA_SECTOR_SIZE;
+            
+            memcpy(ataData->data, buffer + bufferIndex, size);
+            
+            ataData->size = size;
+            
+            advanceBuffer(size);
+            
+            return true;
+        }
+        case ATACONTROLLER_WRITE_DATA:
+        {
+            ATAData *ataData = (ATAData *)data;
+            
+            if (!OEGetBit(status, ATA_DRQ) || !isWriteCommand() ||
+                pioByteMode || (bufferIndex % ATA_SECTOR_SIZE))
+                return false;
+            
+            OEInt size = bufferSize - bufferIndex;
+            if (size > ataData->size)
+                size = ataData->size - ataData->size % ATA_SECTOR_SIZE;
+            
+            memcpy(buffer + bufferIndex, ataData->data, size);
+            
+            ataData->size = size;
+            
+            if (size)
+                advanceBuffer(size);
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Only the pending part of the transfer buffer is stored
+bool ATAController::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(feature);
+    snapshot->write(status);
+    snapshot->write(command);
+    snapshot->write(lba.q);
+    snapshot->write(sectorCount);
+    snapshot->write(multipleCount);
+    snapshot->write(bufferIndex);
+    snapshot->write(bufferSize);
+    snapshot->write(transferLBA);
+    snapshot->write(driveSel);
+    snapshot->write(addressMode);
+    snapshot->write(pioByteMode);
+    snapshot->write(buffer, bufferSize);
+    
+    return true;
+}
+
+bool ATAController::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(feature) ||
+        !snapshot->read(status) ||
+        !snapshot->read(command) ||
+        !snapshot->read(lba.q) ||
+        !snapshot->read(sectorCount) ||
+        !snapshot->read(multipleCount) ||
+        !snapshot->read(bufferIndex) ||
+        !snapshot->read(bufferSize) ||
+        !snapshot->read(transferLBA) ||
+        !snapshot->read(driveSel) ||
+        !snapshot->read(addressMode) ||
+        !snapshot->read(pioByteMode) ||
+        (bufferSize > ATA_BUFFER_SIZE) ||
+        !snapshot->read(buffer, bufferSize))
+        return false;
+    
+    selectDrive(driveSel);
+    
+    return true;
+}
+
 OEChar ATAController::read(OEAddress address)
 {
     return read16(address);
@@ -115,16 +213,17 @@ OEShort ATAController::read16(OEAddress address)
             case 0:
             {
                 // ATA Data
-                OEShort value = buffer[bufferIndex++];
-                if (!pioByteMode)
-                    value |= (buffer[bufferIndex++] << 8);
+                if (!OEGetBit(status, ATA_DRQ) || isWriteCommand())
+                    return 0;
                 
-                if (bufferIndex == ATA_BUFFER_SIZE)
+                OEShort value = buffer[bufferIndex];
+                if (pioByteMode)
+                    advanceBuffer(1);
+                else
                 {
-                    OEClearBit(status, ATA_DRQ);
+                    value |= (buffer[bufferIndex + 1] << 8);
                     
-                    bufferIndex = 0;
-                    lba.d.l++;
+                    advanceBuffer(2);
                 }
                 
                 return value;
@@ -176,6 +275,7 @@ void ATAController::write16(OEAddress address, OEShort value)
             command = 0;
             
             bufferIndex = 0;
+            bufferSize = 0;
         }
     }
     else
@@ -184,21 +284,16 @@ void ATAController::write16(OEAddress address, OEShort value)
         {
             case 0:
                 // ATA data
-                if (command == ATA_WRITE)
+                if (OEGetBit(status, ATA_DRQ) && isWriteCommand())
                 {
-                    buffer[bufferIndex++] = value;
-                    if (!pioByteMode)
-                        buffer[bufferIndex++] = (value >> 8);
-                    
-                    if (bufferIndex == ATA_BUFFER_SIZE)
+                    buffer[bufferIndex] = value;
+                    if (pioByteMode)
+                        advanceBuffer(1);
+                    else
                     {
-                        if (!blockStorage->writeBlocks(lba.d.l, buffer, 1))
-                            OEAssertBit(status, ATA_ERR);
+                        buffer[bufferIndex + 1] = (value >> 8);
                         
-                        OEClearBit(status, ATA_DRQ);
-                        
-                        bufferIndex = 0;
-                        lba.d.l++;
+                        advanceBuffer(2);
                     }
                 }
                 else
@@ -256,23 +351,43 @@ void ATAController::write16(OEAddress address, OEShort value)
                 OEClearBit(status, ATA_ERR);
                 OEClearBit(status, ATA_DRQ);
                 
+                bufferIndex = 0;
+                bufferSize = 0;
+                
                 switch (command)
                 {
                     case ATA_READ:
-                        bufferIndex = 0;
+                    case ATA_READ_NORETRY:
+                        beginRead();
                         
-                        if (blockStorage->readBlocks(lba.d.l, buffer, 1))
-                            OEAssertBit(status, ATA_DRQ);
+                        break;
+                        
+                    case ATA_WRITE:
+                    case ATA_WRITE_NORETRY:
+                        beginWrite();
+                        
+                        break;
+                        
+                    case ATA_READ_MULTIPLE:
+                        if (multipleCount)
+                            beginRead();
                         else
                             OEAssertBit(status, ATA_ERR);
                         
                         break;
                         
-                    case ATA_WRITE:
-                        bufferIndex = 0;
+                    case ATA_WRITE_MULTIPLE:
+                        if (multipleCount)
+                            beginWrite();
+                        else
+                            OEAssertBit(status, ATA_ERR);
                         
-                        if (blockStorage->isWriteEnabled())
-                            OEAssertBit(status, ATA_DRQ);
+                        break;
+                        
+                    case ATA_SET_MULTIPLE:
+                        if ((sectorCount <= ATA_MULTIPLE_SECTORS) &&
+                            !(sectorCount & (sectorCount - 1)))
+                            multipleCount = sectorCount;
                         else
                             OEAssertBit(status, ATA_ERR);
                         
@@ -281,14 +396,12 @@ void ATAController::write16(OEAddress address, OEShort value)
                     case ATA_IDENTIFY:
                     {
                         // Identify
-                        bufferIndex = 0;
-                        
                         if (blockStorage->isOpen())
                         {
                             OEUnion lbaSize;
                             lbaSize.q = blockStorage->getBlockNum();
                             
-                            memset(buffer, 0, ATA_BUFFER_SIZE);
+                            memset(buffer, 0, ATA_SECTOR_SIZE);
                             
                             setATAString((char *) buffer + ATA_SERIAL,
                                          blockStorage->getSerial().c_str(),
@@ -300,6 +413,12 @@ void ATAController::write16(OEAddress address, OEShort value)
                                          blockStorage->getModel().c_str(),
                                          ATA_MODEL_SIZE);
                             
+                            buffer[ATA_MAX_MULTIPLE + 0] = ATA_MULTIPLE_SECTORS;
+                            buffer[ATA_MAX_MULTIPLE + 1] = 0x80;
+                            
+                            buffer[ATA_CUR_MULTIPLE + 0] = multipleCount;
+                            buffer[ATA_CUR_MULTIPLE + 1] = multipleCount ? 0x01 : 0x00;
+                            
                             buffer[ATA_SIZE + 0] = lbaSize.b.l;
                             buffer[ATA_SIZE + 1] = lbaSize.b.h;
                             buffer[ATA_SIZE + 2] = lbaSize.b.h2;
@@ -310,6 +429,8 @@ void ATAController::write16(OEAddress address, OEShort value)
                             buffer[ATA_SIZE2 + 2] = lbaSize.b.h2;
                             buffer[ATA_SIZE2 + 3] = lbaSize.b.h3;
                             
+                            bufferSize = ATA_SECTOR_SIZE;
+                            
                             OEAssertBit(status, ATA_DRQ);
                         }
                         else
@@ -371,3 +492,83 @@ void ATAController::setATAString(char *dest, const char *src, OEInt size)
     for (OEInt i = 0; i < (strlen(src)) && (i < size); i++)
         dest[i ^ 1] = src[i];
 }
+
+OEInt ATAController::getTransferSectorNum()
+{
+    return sectorCount ? sectorCount : ATA_MAX_SECTORS;
+}
+
+bool ATAController::isReadCommand()
+{
+    return ((command == ATA_READ) ||
+            (command == ATA_READ_NORETRY) ||
+            (command == ATA_READ_MULTIPLE));
+}
+
+bool ATAController::isWriteCommand()
+{
+    return ((command == ATA_WRITE) ||
+            (command == ATA_WRITE_NORETRY) ||
+            (command == ATA_WRITE_MULTIPLE));
+}
+
+void ATAController::beginRead()
+{
+    OEInt sectorNum = getTransferSectorNum();
+    
+    // Read the whole transfer with one block storage access
+    if (blockStorage->readBlocks(lba.d.l, buffer, sectorNum))
+    {
+        bufferSize = sectorNum * ATA_SECTOR_SIZE;
+        
+        OEAssertBit(status, ATA_DRQ);
+    }
+    else
+        OEAssertBit(status, ATA_ERR);
+}
+
+void ATAController::beginWrite()
+{
+    if (blockStorage->isWriteEnabled())
+    {
+        bufferSize = getTransferSectorNum() * ATA_SECTOR_SIZE;
+        transferLBA = lba.d.l;
+        
+        OEAssertBit(status, ATA_DRQ);
+    }
+    else
+        OEAssertBit(status, ATA_ERR);
+}
+
+void ATAController::advanceBuffer(OEInt size)
+{
+    OEInt sectorNum = ((bufferIndex + size) / ATA_SECTOR_SIZE -
+                       bufferIndex / ATA_SECTOR_SIZE);
+    
+    bufferIndex += size;
+    
+    if (isReadCommand() || isWriteCommand())
+    {
+        lba.d.l += sectorNum;
+        sectorCount -= sectorNum;
+    }
+    
+    if (bufferIndex >= bufferSize)
+        endTransfer();
+}
+
+void ATAController::endTransfer()
+{
+    // Write the whole transfer with one block storage access
+    if (isWriteCommand())
+    {
+        if (!blockStorage->writeBlocks(transferLBA, buffer,
+                                       bufferSize / ATA_SECTOR_SIZE))
+            OEAssertBit(status, ATA_ERR);
+    }
+    
+    OEClearBit(status, ATA_DRQ);
+    
+    bufferIndex = 0;
+    bufferSize = 0;
+}
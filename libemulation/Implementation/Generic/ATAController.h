@@ -1,4 +1,3 @@
-
 /**
  * libemulation
  * ATA Controller
@@ -10,9 +9,12 @@
 
 #include "OEComponent.h"
 
+#include "ATAInterface.h"
+
 #include "diskimage.h"
 
-#define ATA_BUFFER_SIZE 0x200
+#define ATA_MAX_SECTORS 0x100
+#define ATA_BUFFER_SIZE (ATA_SECTOR_SIZE * ATA_MAX_SECTORS)
 
 class ATAController : public OEComponent
 {
@@ -23,6 +25,11 @@ public:
     bool init();
     void update();
     
+    bool postMessage(OEComponent *sender, int message, void *data);
+    
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
     OEShort read16(OEAddress address);
@@ -40,9 +47,12 @@ private:
     
     OEUnion lba;
     OEChar sectorCount;
+    OEInt multipleCount;
     
     OEChar buffer[ATA_BUFFER_SIZE];
     OEInt bufferIndex;
+    OEInt bufferSize;
+    OEInt transferLBA;
     
     bool driveSel;
     OEInt addressMode;
@@ -50,4 +60,12 @@ private:
     
     void selectDrive(OEInt value);
     void setATAString(char *dest, const char *src, OEInt size);
+    
+    OEInt getTransferSectorNum();
+    bool isReadCommand();
+    bool isWriteCommand();
+    void beginRead();
+    void beginWrite();
+    void advanceBuffer(OEInt size);
+    void endTransfer();
 };
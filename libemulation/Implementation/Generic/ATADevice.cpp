@@ -31,6 +31,12 @@ bool ATADevice::setValue(string name, string value)
         blockStorage.setForceWriteProtected(getOEInt(value));
     else if (name == "maxSize")
         blockStorage.setMaxSize(getOEInt(value));
+    else if (name == "cacheSize")
+        blockStorage.setCacheSize(getOEInt(value));
+    else if (name == "overlay")
+        setOverlay(getOEInt(value), blockStorage.getOverlayPath());
+    else if (name == "overlayPath")
+        setOverlay(blockStorage.getOverlay(), value);
     else
         return false;
     
@@ -43,6 +49,12 @@ bool ATADevice::getValue(string name, string& value)
         value = blockStorage.getPath();
     else if (name == "forceWriteProtected")
         value = getString(blockStorage.getForceWriteProtected());
+    else if (name == "cacheSize")
+        value = getString(blockStorage.getCacheSize());
+    else if (name == "overlay")
+        value = getString(blockStorage.getOverlay());
+    else if (name == "overlayPath")
+        value = blockStorage.getOverlayPath();
     else
         return false;
     
@@ -72,6 +84,11 @@ bool ATADevice::init()
     return true;
 }
 
+void ATADevice::dispose()
+{
+    blockStorage.flush();
+}
+
 bool ATADevice::postMessage(OEComponent *sender, int message, void *data)
 {
     switch(message)
@@ -83,6 +100,9 @@ bool ATADevice::postMessage(OEComponent *sender, int message, void *data)
         {
             DIATABlockStorage blockStorage;
             
+            // Probe through a RAM overlay, so a shared base image is not written
+            blockStorage.setOverlay(this->blockStorage.getOverlay());
+            
             return blockStorage.open(*((string *)data));
         }
             
@@ -120,6 +140,22 @@ bool ATADevice::postMessage(OEComponent *sender, int message, void *data)
             *((DIATABlockStorage **)data) = &blockStorage;
             
             return true;
+            
+        case STORAGE_FLUSH:
+            return blockStorage.flush();
+            
+        case STORAGE_GET_CACHESTATS:
+        {
+            StorageCacheStats *cacheStats = (StorageCacheStats *)data;
+            
+            cacheStats->hitNum = blockStorage.getCacheHitNum();
+            cacheStats->missNum = blockStorage.getCacheMissNum();
+            
+            return true;
+        }
+            
+        case STORAGE_COMMIT_OVERLAY:
+            return blockStorage.commitOverlay();
     }
     
     return false;
@@ -139,3 +175,19 @@ void ATADevice::closeDiskImage()
 {
     blockStorage.close();
 }
+
+void ATADevice::setOverlay(bool value, string path)
+{
+    if ((value == blockStorage.getOverlay()) &&
+        (path == blockStorage.getOverlayPath()))
+        return;
+    
+    blockStorage.setOverlay(value);
+    blockStorage.setOverlayPath(path);
+    
+    // Remount, so the overlay setting applies to the current image
+    string diskImagePath = blockStorage.getPath();
+    
+    if (diskImagePath != "")
+        openDiskImage(diskImagePath);
+}
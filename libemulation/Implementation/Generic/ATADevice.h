@@ -22,6 +22,7 @@ public:
     bool getValue(string name, string& value);
     bool setRef(string name, OEComponent *ref);
     bool init();
+    void dispose();
     
     bool postMessage(OEComponent *sender, int message, void *data);
     
@@ -32,4 +33,5 @@ private:
     
     bool openDiskImage(string path);
     void closeDiskImage();
+    void setOverlay(bool value, string path);
 };
@@ -118,6 +118,35 @@ void AddressDecoder::write(OEAddress address, OEChar value)
 	writeMapp[(size_t) ((address & mask) >> blockBits)]->write(address, value);
 }
 
+// Blocks are split at map block boundaries
+void AddressDecoder::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress n = min(size, blockSize - (address & (blockSize - 1)));
+        
+        readMapp[(size_t) ((address & mask) >> blockBits)]->readBlock(address, data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void AddressDecoder::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress n = min(size, blockSize - (address & (blockSize - 1)));
+        
+        writeMapp[(size_t) ((address & mask) >> blockBits)]->writeBlock(address, data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
 void AddressDecoder::mapMemory(MemoryMap& value)
 {
 	size_t startBlock = (size_t) (value.startAddress >> blockBits);
@@ -29,6 +29,8 @@ public:
     
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
+    void readBlock(OEAddress address, OEChar *data, OEAddress size);
+    void writeBlock(OEAddress address, const OEChar *data, OEAddress size);
     
 protected:
     OEAddress size;
@@ -70,3 +70,48 @@ void AddressMasker::write(OEAddress address, OEChar value)
 {
     memory->write((address & andMask) | orMask, value);
 }
+
+void AddressMasker::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    OEAddress runSize = getRunSize();
+    
+    while (size)
+    {
+        OEAddress n = min(size, runSize - (address & (runSize - 1)));
+        
+        memory->readBlock((address & andMask) | orMask, data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void AddressMasker::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    OEAddress runSize = getRunSize();
+    
+    while (size)
+    {
+        OEAddress n = min(size, runSize - (address & (runSize - 1)));
+        
+        memory->writeBlock((address & andMask) | orMask, data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+// Addresses map contiguously within aligned runs whose bits pass through
+// both masks unchanged
+OEAddress AddressMasker::getRunSize()
+{
+    OEAddress passMask = andMask & ~orMask;
+    OEAddress runSize = 1;
+    
+    for (OEInt i = 0; (i < 63) && (passMask & runSize); i++)
+        runSize <<= 1;
+        
+    return runSize;
+}
@@ -92,6 +92,35 @@ void AddressOffset::write(OEAddress address, OEChar value)
     memory->write(address + offsetp[(address & mask) >> blockBits], value);
 }
 
+// Blocks are split at offset block boundaries
+void AddressOffset::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress n = min(size, blockSize - (address & (blockSize - 1)));
+        
+        memory->readBlock(address + offsetp[(address & mask) >> blockBits], data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void AddressOffset::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress n = min(size, blockSize - (address & (blockSize - 1)));
+        
+        memory->writeBlock(address + offsetp[(address & mask) >> blockBits], data, n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
 bool AddressOffset::mapOffset(AddressOffsetMap& value)
 {
     if (!offset.size())
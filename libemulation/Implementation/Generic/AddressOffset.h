@@ -25,6 +25,8 @@ public:
     
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
+    void readBlock(OEAddress address, OEChar *data, OEAddress size);
+    void writeBlock(OEAddress address, const OEChar *data, OEAddress size);
     
 private:
     OEComponent *memory;
@@ -43,6 +43,7 @@ AudioCodec::AudioCodec()
     controlBus = NULL;
     
     audioBuffer = NULL;
+    mute = false;
     
     sampleRate = 0;
     channelNum = 0;
@@ -82,7 +83,13 @@ bool AudioCodec::setRef(string name, OEComponent *ref)
         }
     }
     else if (name == "controlBus")
+    {
+        if (controlBus)
+            controlBus->removeObserver(this, CONTROLBUS_WARP_DID_CHANGE);
         controlBus = ref;
+        if (controlBus)
+            controlBus->addObserver(this, CONTROLBUS_WARP_DID_CHANGE);
+    }
     else
         return false;
     
@@ -106,7 +113,10 @@ void AudioCodec::update()
 
 void AudioCodec::notify(OEComponent *sender, int notification, void *data)
 {
-    if (notification == AUDIO_BUFFER_WILL_RENDER)
+    // Output is muted while the bus is warped
+    if (sender == controlBus)
+        mute = *((bool *)data);
+    else if (notification == AUDIO_BUFFER_WILL_RENDER)
     {
         audioBuffer = (AudioBuffer *)data;
         
@@ -136,6 +146,52 @@ void AudioCodec::notify(OEComponent *sender, int notification, void *data)
         synthBuffer();
 }
 
+// Saving the pending samples lets run-ahead frames be rolled back
+bool AudioCodec::serialize(OESnapshot *snapshot)
+{
+    OEInt bufferSize = (OEInt) buffer.size();
+    OEInt channelSize = (OEInt) lastInput.size();
+    
+    if (!snapshot->write(bufferSize) ||
+        !snapshot->write(channelSize))
+        return false;
+    
+    if (bufferSize &&
+        !snapshot->write(&buffer.front(), bufferSize * sizeof(float)))
+        return false;
+    
+    if (!channelSize)
+        return true;
+    
+    return (snapshot->write(&lastInput.front(), channelSize * sizeof(float)) &&
+            snapshot->write(&lastOutput.front(), channelSize * sizeof(float)));
+}
+
+bool AudioCodec::deserialize(OESnapshot *snapshot)
+{
+    OEInt bufferSize;
+    OEInt channelSize;
+    
+    if (!snapshot->read(bufferSize) ||
+        !snapshot->read(channelSize))
+        return false;
+    
+    // Samples for another audio format are dropped
+    if ((bufferSize != buffer.size()) ||
+        (channelSize != lastInput.size()))
+        return snapshot->skip((bufferSize + 2 * channelSize) * sizeof(float));
+    
+    if (bufferSize &&
+        !snapshot->read(&buffer.front(), bufferSize * sizeof(float)))
+        return false;
+    
+    if (!channelSize)
+        return true;
+    
+    return (snapshot->read(&lastInput.front(), channelSize * sizeof(float)) &&
+            snapshot->read(&lastOutput.front(), channelSize * sizeof(float)));
+}
+
 OEChar AudioCodec::read(OEAddress address)
 {
     if (!audioBuffer)
@@ -153,7 +209,7 @@ OEChar AudioCodec::read(OEAddress address)
 
 void AudioCodec::write(OEAddress address, OEChar value)
 {
-    if (!audioBuffer)
+    if (!audioBuffer || mute)
         return;
     
     float audioBufferFrame;
@@ -181,7 +237,7 @@ OEShort AudioCodec::read16(OEAddress address)
 
 void AudioCodec::write16(OEAddress address, OEShort value)
 {
-    if (!audioBuffer)
+    if (!audioBuffer || mute)
         return;
     
     float audioBufferFrame;
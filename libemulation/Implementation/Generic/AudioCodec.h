@@ -24,6 +24,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
     OEShort read16(OEAddress address);
@@ -39,6 +42,7 @@ private:
     OEComponent *controlBus;
     
     AudioBuffer *audioBuffer;
+    bool mute;
     
     float sampleRate;
     OEInt channelNum;
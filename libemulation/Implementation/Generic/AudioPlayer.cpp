@@ -26,6 +26,7 @@ AudioPlayer::AudioPlayer()
     frameIndex = 0;
     
     sound = NULL;
+    sharedSound = NULL;
     
     srcChannelNum = 0;
     srcState = NULL;
@@ -35,6 +36,11 @@ AudioPlayer::AudioPlayer()
     audioBufferFrame = 0;
 }
 
+AudioPlayer::~AudioPlayer()
+{
+    OESound::release(sharedSound);
+}
+
 bool AudioPlayer::setValue(string name, string value)
 {
     if (name == "playing")
@@ -91,8 +97,11 @@ bool AudioPlayer::setData(string name, OEData *data)
 {
     if (name == "sound")
     {
-        loadedSound = OESound(*data);
-        sound = &loadedSound;
+        // Decoded sounds are shared between players
+        OESound::release(sharedSound);
+        
+        sharedSound = OESound::retain(*data);
+        sound = sharedSound;
     }
     else
         return false;
@@ -19,6 +19,7 @@ class AudioPlayer : public OEComponent
 {
 public:
     AudioPlayer();
+    ~AudioPlayer();
     
     bool setValue(string name, string value);
     bool getValue(string name, string value);
@@ -40,7 +41,7 @@ private:
     OEInt frameIndex;
     
     OESound *sound;
-    OESound loadedSound;
+    OESound *sharedSound;
     
     int srcChannelNum;
     SRC_STATE *srcState;
@@ -26,6 +26,12 @@ ControlBus::ControlBus()
     
     clockFrequency = 1E6F;
     cpuClockMultiplier = 1;
+    warpFrameMultiplier = 8;
+    warpCount = 0;
+    frameMultiplier = 1;
+    isFrameSkipped = false;
+    warp = false;
+    bulkActivityCount = 0;
     powerState = CONTROLBUS_POWERSTATE_OFF;
     resetOnPowerOn = true;
     resetCount = 0;
@@ -40,6 +46,12 @@ ControlBus::ControlBus()
     sampleToCycleRatio = 0;
     
     activity = false;
+    hibernation = false;
+    
+    readyCycles = 0;
+    readyPCStart = 0;
+    readyPCEnd = 0;
+    isReady = false;
 }
 
 bool ControlBus::setValue(string name, string value)
@@ -48,6 +60,8 @@ bool ControlBus::setValue(string name, string value)
         clockFrequency = getFloat(value);
     else if (name == "cpuClockMultiplier")
         cpuClockMultiplier = getFloat(value);
+    else if (name == "warpFrameMultiplier")
+        warpFrameMultiplier = getOEInt(value);
     else if (name == "powerState")
     {
         if (value.substr(0, 1) == "S")
@@ -61,6 +75,12 @@ bool ControlBus::setValue(string name, string value)
         irqCount = getOEInt(value);
     else if (name == "nmiCount")
         nmiCount = getOEInt(value);
+    else if (name == "readyCycles")
+        readyCycles = getOELong(value);
+    else if (name == "readyPCStart")
+        readyPCStart = getOEInt(value);
+    else if (name == "readyPCEnd")
+        readyPCEnd = getOEInt(value);
     else
         return false;
     
@@ -88,10 +108,16 @@ bool ControlBus::setRef(string name, OEComponent *ref)
     if (name == "emulation")
     {
         if (emulation)
+        {
             emulation->removeObserver(this, EMULATION_WAS_SIGNALED);
+            emulation->removeObserver(this, EMULATION_DID_RESUME);
+        }
         emulation = ref;
         if (emulation)
+        {
             emulation->addObserver(this, EMULATION_WAS_SIGNALED);
+            emulation->addObserver(this, EMULATION_DID_RESUME);
+        }
     }
     else if (name == "device")
         device = ref;
@@ -119,12 +145,19 @@ bool ControlBus::init()
     
     updatePowerState();
     
+    if (emulation)
+        emulation->postMessage(this, EMULATION_ADD_CONTROLBUS, NULL);
+        
     return true;
 }
 
 void ControlBus::dispose()
 {
     setActivity(false);
+    setHibernation(false);
+    
+    if (emulation)
+        emulation->postMessage(this, EMULATION_REMOVE_CONTROLBUS, NULL);
 }
 
 bool ControlBus::postMessage(OEComponent *sender, int message, void *data)
@@ -175,11 +208,70 @@ bool ControlBus::postMessage(OEComponent *sender, int message, void *data)
             
             return true;
             
+        case CONTROLBUS_RUN_FRAME:
+            if (powerState == CONTROLBUS_POWERSTATE_ON)
+                runFrame((AudioBuffer *)data);
+                
+            return true;
+            
         case CONTROLBUS_SET_CPUCLOCKMULTIPLIER:
             setCPUClockMultiplier(*((float *)data));
             
             break;
             
+        case CONTROLBUS_ASSERT_WARP:
+            warpCount++;
+            
+            return true;
+            
+        case CONTROLBUS_CLEAR_WARP:
+            if (warpCount <= 0)
+                return false;
+            
+            warpCount--;
+            
+            return true;
+            
+        case CONTROLBUS_IS_WARP_ASSERTED:
+            *((bool *)data) = (warpCount != 0);
+            
+            return true;
+            
+        case CONTROLBUS_SET_FRAMEMULTIPLIER:
+            frameMultiplier = *((OEInt *)data);
+            
+            if (!frameMultiplier)
+                frameMultiplier = 1;
+            
+            return true;
+            
+        case CONTROLBUS_ASSERT_BULKACTIVITY:
+            bulkActivityCount++;
+            
+            if (bulkActivityCount == 1)
+            {
+                bool bulkActivity = true;
+                
+                postNotification(this, CONTROLBUS_BULKACTIVITY_DID_CHANGE, &bulkActivity);
+            }
+            
+            return true;
+            
+        case CONTROLBUS_CLEAR_BULKACTIVITY:
+            if (bulkActivityCount <= 0)
+                return false;
+            
+            bulkActivityCount--;
+            
+            if (!bulkActivityCount)
+            {
+                bool bulkActivity = false;
+                
+                postNotification(this, CONTROLBUS_BULKACTIVITY_DID_CHANGE, &bulkActivity);
+            }
+            
+            return true;
+            
         case CONTROLBUS_ASSERT_RESET:
             resetCount++;
             
@@ -262,42 +354,57 @@ void ControlBus::notify(OEComponent *sender, int notification, void *data)
         if (powerState != CONTROLBUS_POWERSTATE_ON)
             return;
         
+        // Multiplied frames run back to back, and only the last is presented
         AudioBuffer *buffer = (AudioBuffer *)data;
+        OEInt frameNum = frameMultiplier;
         
-        audioBufferStart = cycles;
-        sampleToCycleRatio = buffer->sampleRate / clockFrequency;
+        if (warpCount && (warpFrameMultiplier > frameNum))
+            frameNum = warpFrameMultiplier;
         
-        scheduleTimer(NULL, ceil(buffer->frameNum / sampleToCycleRatio) - getCycles(), 0);
+        // Audio input is consumed once, by the last frame. The skipped
+        // frames hear silence, so cassette data is not replayed
+        AudioBuffer skippedBuffer = *buffer;
+        OEInt sampleNum = buffer->frameNum * buffer->channelNum;
         
-        while (true)
+        if ((frameNum > 1) && sampleNum)
         {
-            inEvent = true;
-            
-            cpuCycles += ceil(events.front().cycles * cpuClockMultiplier - cpuCycles);
-            setPendingCPUCycles(floor(cpuCycles + getPendingCPUCycles()));
-            runCPU();
+            if (silence.size() < sampleNum)
+                silence.resize(sampleNum);
             
-            inEvent = false;
+            skippedBuffer.input = &silence.front();
+        }
+        
+        for (OEInt i = frameNum; i > 0; i--)
+        {
+            isFrameSkipped = ((i > 1) || buffer->isSkipped);
+            updateWarp();
             
-            OEComponent *component = events.front().component;
-            OEInt id = events.front().id;
-            cycles += events.front().cycles;
-            cpuCycles -= events.front().cycles * cpuClockMultiplier;
-            events.front().cycles = 0;
-            events.pop_front();
+            runFrame((i > 1) ? &skippedBuffer : buffer);
             
-            if (component)
-            {
-                ControlBusTimer timer = { -getCycles(), id };
-                
-                component->notify(this, CONTROLBUS_TIMER_DID_FIRE, &timer);
-            }
-            else
+            if (powerState != CONTROLBUS_POWERSTATE_ON)
                 break;
-        };
+        }
+        
+        isFrameSkipped = false;
+        updateWarp();
+        
+        if (!isReady)
+            updateReady();
+            
+        if (emulation)
+            emulation->postMessage(this, EMULATION_END_FRAME, data);
     }
     else if (sender == emulation)
     {
+        // A bus resumed from hibernation wakes up without a reset
+        if (notification == EMULATION_DID_RESUME)
+        {
+            if (powerState == CONTROLBUS_POWERSTATE_HIBERNATE)
+                setPowerState(CONTROLBUS_POWERSTATE_ON);
+            
+            return;
+        }
+        
         switch (*((EmulationEvent *)data))
         {
             case EMULATION_POWERDOWN:
@@ -313,6 +420,12 @@ void ControlBus::notify(OEComponent *sender, int notification, void *data)
                 
             case EMULATION_WAKEUP:
                 setPowerState(CONTROLBUS_POWERSTATE_ON);
+            
+                break;
+            
+            case EMULATION_HIBERNATE:
+                if (powerState != CONTROLBUS_POWERSTATE_OFF)
+                    setPowerState(CONTROLBUS_POWERSTATE_HIBERNATE);
                 
                 break;
                 
@@ -343,6 +456,91 @@ void ControlBus::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+// Timers are stored with their component's snapshot index
+bool ControlBus::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(clockFrequency);
+    snapshot->write(cpuClockMultiplier);
+    snapshot->write(powerState);
+    snapshot->write(resetCount);
+    snapshot->write(irqCount);
+    snapshot->write(nmiCount);
+    snapshot->write(cycles);
+    snapshot->write(cpuCycles);
+    snapshot->write(audioBufferStart);
+    snapshot->write(sampleToCycleRatio);
+    snapshot->write(isReady);
+    snapshot->write(frameMultiplier);
+    snapshot->write(bulkActivityCount);
+    
+    OEInt eventNum = (OEInt) events.size();
+    
+    snapshot->write(eventNum);
+    
+    for (list<ControlBusEvent>::iterator i = events.begin();
+         i != events.end();
+         i++)
+    {
+        snapshot->write(i->cycles);
+        snapshot->write(i->id);
+        
+        if (!snapshot->writeRef(i->component))
+            return false;
+    }
+    
+    return true;
+}
+
+bool ControlBus::deserialize(OESnapshot *snapshot)
+{
+    ControlBusPowerState lastPowerState = powerState;
+    bool lastBulkActivity = (bulkActivityCount != 0);
+    OEInt eventNum;
+    
+    if (!snapshot->read(clockFrequency) ||
+        !snapshot->read(cpuClockMultiplier) ||
+        !snapshot->read(powerState) ||
+        !snapshot->read(resetCount) ||
+        !snapshot->read(irqCount) ||
+        !snapshot->read(nmiCount) ||
+        !snapshot->read(cycles) ||
+        !snapshot->read(cpuCycles) ||
+        !snapshot->read(audioBufferStart) ||
+        !snapshot->read(sampleToCycleRatio) ||
+        !snapshot->read(isReady) ||
+        !snapshot->read(frameMultiplier) ||
+        !snapshot->read(bulkActivityCount) ||
+        !snapshot->read(eventNum))
+        return false;
+    
+    events.clear();
+    
+    for (OEInt i = 0; i < eventNum; i++)
+    {
+        ControlBusEvent event;
+        
+        if (!snapshot->read(event.cycles) ||
+            !snapshot->read(event.id) ||
+            !snapshot->readRef(&event.component))
+            return false;
+        
+        events.push_back(event);
+    }
+    
+    inEvent = false;
+    
+    if (powerState != lastPowerState)
+        updatePowerState();
+    
+    // The paste warp count is host state and is kept
+    bool bulkActivity = (bulkActivityCount != 0);
+    
+    if (bulkActivity != lastBulkActivity)
+        postNotification(this, CONTROLBUS_BULKACTIVITY_DID_CHANGE, &bulkActivity);
+    
+    return true;
+}
+
 void ControlBus::setPowerState(ControlBusPowerState value)
 {
     if (powerState == value)
@@ -408,6 +606,7 @@ void ControlBus::updatePowerState()
     device->postMessage(this, DEVICE_UPDATE, NULL);
     
     setActivity(powerState == CONTROLBUS_POWERSTATE_ON);
+    setHibernation(powerState == CONTROLBUS_POWERSTATE_HIBERNATE);
 }
 
 void ControlBus::setActivity(bool value)
@@ -428,6 +627,25 @@ void ControlBus::updateActivity()
                                       EMULATION_CLEAR_ACTIVITY), NULL);
 }
 
+void ControlBus::setHibernation(bool value)
+{
+    if (hibernation == value)
+        return;
+    
+    hibernation = value;
+    
+    updateHibernation();
+}
+
+// A hibernated emulation stores its state when it is saved
+void ControlBus::updateHibernation()
+{
+    if (emulation)
+        emulation->postMessage(this, (hibernation ?
+                                      EMULATION_ASSERT_HIBERNATION :
+                                      EMULATION_CLEAR_HIBERNATION), NULL);
+}
+
 inline OESLong ControlBus::getPendingCPUCycles()
 {
     OESLong value;
@@ -447,6 +665,68 @@ inline void ControlBus::runCPU()
     cpu->postMessage(this, CPU_RUN, &cpuCycles);
 }
 
+void ControlBus::runFrame(AudioBuffer *buffer)
+{
+    audioBufferStart = cycles;
+    sampleToCycleRatio = buffer->sampleRate / clockFrequency;
+    
+    scheduleTimer(NULL, ceil(buffer->frameNum / sampleToCycleRatio) - getCycles(), 0);
+    
+    while (true)
+    {
+        inEvent = true;
+        
+        cpuCycles += ceil(events.front().cycles * cpuClockMultiplier - cpuCycles);
+        setPendingCPUCycles(floor(cpuCycles + getPendingCPUCycles()));
+        runCPU();
+        
+        inEvent = false;
+        
+        OEComponent *component = events.front().component;
+        OEInt id = events.front().id;
+        cycles += events.front().cycles;
+        cpuCycles -= events.front().cycles * cpuClockMultiplier;
+        events.front().cycles = 0;
+        events.pop_front();
+        
+        if (component)
+        {
+            ControlBusTimer timer = { -getCycles(), id };
+            
+            component->notify(this, CONTROLBUS_TIMER_DID_FIRE, &timer);
+        }
+        else
+            break;
+    };
+}
+
+// The bus is ready once it has run readyCycles and the CPU is inside the
+// readyPCStart-readyPCEnd range. A bus without a ready condition never is
+void ControlBus::updateReady()
+{
+    if (!readyCycles && !readyPCEnd)
+        return;
+        
+    if (readyCycles && (cycles < readyCycles))
+        return;
+        
+    if (readyPCEnd)
+    {
+        OEInt pc = 0;
+        
+        if (!cpu ||
+            !cpu->postMessage(this, CPU_GET_PC, &pc) ||
+            (pc < readyPCStart) ||
+            (pc > readyPCEnd))
+            return;
+    }
+    
+    isReady = true;
+    
+    if (emulation)
+        emulation->postMessage(this, EMULATION_END_BOOT, NULL);
+}
+
 OESLong ControlBus::getCycles()
 {
     return floor((cpuCycles - getPendingCPUCycles()) / cpuClockMultiplier);
@@ -541,3 +821,17 @@ void ControlBus::setCPUClockMultiplier(float value)
     
     cpuClockMultiplier = value;
 }
+
+// Presentation is suppressed in the frames skipped by warp or by the
+// frame multiplier
+void ControlBus::updateWarp()
+{
+    bool value = isFrameSkipped;
+    
+    if (warp == value)
+        return;
+    
+    warp = value;
+    
+    postNotification(this, CONTROLBUS_WARP_DID_CHANGE, &warp);
+}
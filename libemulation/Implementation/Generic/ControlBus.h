@@ -12,10 +12,12 @@
 #define _CONTROLBUS_H
 
 #include <list>
+#include <vector>
 
 #include "OEComponent.h"
 
 #include "ControlBusInterface.h"
+#include "AudioInterface.h"
 
 typedef struct
 {
@@ -39,6 +41,9 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 private:
     OEComponent *emulation;
     OEComponent *device;
@@ -47,6 +52,12 @@ private:
     
     float clockFrequency;
     double cpuClockMultiplier;
+    OEInt warpFrameMultiplier;
+    OEInt warpCount;
+    OEInt frameMultiplier;
+    bool isFrameSkipped;
+    bool warp;
+    OEInt bulkActivityCount;
     ControlBusPowerState powerState;
     bool resetOnPowerOn;
     OEInt resetCount;
@@ -60,8 +71,15 @@ private:
     
     OELong audioBufferStart;
     float sampleToCycleRatio;
+    vector<float> silence;
     
     bool activity;
+    bool hibernation;
+    
+    OELong readyCycles;
+    OEInt readyPCStart;
+    OEInt readyPCEnd;
+    bool isReady;
     
     void setPowerState(ControlBusPowerState value);
     void updatePowerState();
@@ -69,6 +87,12 @@ private:
     void setActivity(bool value);
     void updateActivity();
     
+    void setHibernation(bool value);
+    void updateHibernation();
+    
+    void runFrame(AudioBuffer *buffer);
+    void updateReady();
+    
     OESLong getPendingCPUCycles();
     void setPendingCPUCycles(OESLong value);
     void runCPU();
@@ -77,6 +101,7 @@ private:
     void invalidateTimers(OEComponent *component, OEInt id);
     
     void setCPUClockMultiplier(float value);
+    void updateWarp();
 };
 
 #endif
@@ -13,6 +13,7 @@
 #include "JoystickMapper.h"
 
 #include "DeviceInterface.h"
+#include "EmulationInterface.h"
 #include "CanvasInterface.h"
 #include "JoystickInterface.h"
 
@@ -254,6 +255,13 @@ void JoystickMapper::notify(OEComponent *sender, int notification, void *data)
     {
         if (notification == JOYSTICK_DID_CHANGE)
         {
+            EmulationInput input = {
+                sender, notification, EMULATION_INPUT_VALUE, data, sizeof(JoystickHIDEvent)
+            };
+            
+            if (device->postMessage(this, DEVICE_FILTER_INPUT, &input))
+                return;
+                
             JoystickHIDEvent *hidEvent = (JoystickHIDEvent *)data;
             
             mapNotification(JOYSTICK_START + JOYSTICK_OFFSET * hidEvent->deviceId + hidEvent->usageId,
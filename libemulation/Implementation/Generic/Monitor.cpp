@@ -11,6 +11,7 @@
 #include "Monitor.h"
 
 #include "DeviceInterface.h"
+#include "EmulationInterface.h"
 #include "AudioInterface.h"
 
 Monitor::Monitor()
@@ -274,7 +275,45 @@ void Monitor::notify(OEComponent *sender, int notification, void *data)
         updateBezel();
     }
     else if (sender == canvas)
+    {
+        if (filterInput(sender, notification, data))
+            return;
+            
         postNotification(sender, notification, data);
+    }
+}
+
+// Input is journaled by the emulation
+bool Monitor::filterInput(OEComponent *sender, int notification, void *data)
+{
+    EmulationInput input;
+    
+    input.sender = sender;
+    input.notification = notification;
+    input.data = data;
+    input.size = 0;
+    
+    switch (notification)
+    {
+        case CANVAS_UNICODECHAR_WAS_SENT:
+        case CANVAS_KEYBOARD_DID_CHANGE:
+        case CANVAS_POINTER_DID_CHANGE:
+        case CANVAS_MOUSE_DID_CHANGE:
+            input.type = EMULATION_INPUT_VALUE;
+            input.size = sizeof(CanvasHIDEvent);
+            
+            break;
+            
+        case CANVAS_DID_PASTE:
+            input.type = EMULATION_INPUT_STRING;
+            
+            break;
+            
+        default:
+            return false;
+    }
+    
+    return device->postMessage(this, DEVICE_FILTER_INPUT, &input);
 }
 
 void Monitor::updateBezel()
@@ -38,4 +38,5 @@ private:
     ControlBusPowerState powerState;
     
     void updateBezel();
+    bool filterInput(OEComponent *sender, int notification, void *data);
 };
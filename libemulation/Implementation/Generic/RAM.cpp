@@ -18,6 +18,8 @@ RAM::RAM()
     
     controlBus = NULL;
     powerState = CONTROLBUS_POWERSTATE_ON;
+    
+    isDataShared = false;
 }
 
 bool RAM::setValue(string name, string value)
@@ -61,7 +63,25 @@ bool RAM::setRef(string name, OEComponent *ref)
 bool RAM::setData(string name, OEData *data)
 {
     if (name == "memoryImage")
+    {
+        mappedData.close();
+        
         data->swap(this->data);
+    }
+    else
+        return false;
+    
+    return true;
+}
+
+bool RAM::setMappedData(string name, OEMappedData *data)
+{
+    if (name == "memoryImage")
+    {
+        this->data.clear();
+        
+        data->swap(mappedData);
+    }
     else
         return false;
     
@@ -75,7 +95,11 @@ bool RAM::getData(string name, OEData **data)
         if (powerState == CONTROLBUS_POWERSTATE_OFF)
             *data = NULL;
         else
+        {
+            loadMappedData();
+            
             *data = &this->data;
+        }
     }
     else
         return false;
@@ -101,18 +125,33 @@ bool RAM::init()
     else
         powerOnPattern.resize((size_t) getNextPowerOf2((int) powerOnPattern.size()));
     
+    mask = size - 1;
+    
+    if (mappedData.isOpen())
+    {
+        if (mappedData.getSize() == size)
+        {
+            datap = mappedData.getData();
+            
+            return true;
+        }
+        
+        loadMappedData();
+    }
+    
     size_t oldSize = data.size();
     data.resize((size_t) size);
     if (oldSize == 0)
         initMemory();
     datap = &data.front();
-    mask = size - 1;
     
     return true;
 }
 
 void RAM::update()
 {
+    loadMappedData();
+    
     size_t oldSize = data.size();
     
     init();
@@ -126,6 +165,10 @@ bool RAM::postMessage(OEComponent *sender, int message, void *data)
     switch (message)
     {
         case RAM_GET_DATA:
+            loadMappedData();
+            
+            isDataShared = true;
+            
             *((OEData **) data) = &this->data;
             return true;
     }
@@ -141,6 +184,40 @@ void RAM::notify(OEComponent *sender, int notification, void *data)
     powerState = *((ControlBusPowerState *)data);
 }
 
+// Memory is stored as a block. Unless other components point into the
+// memory, a block in a mapped snapshot is mapped copy-on-write, so only
+// the pages that are touched are read
+bool RAM::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(powerState);
+    snapshot->write(size);
+    snapshot->writeBlock(datap, (size_t) size);
+    
+    return true;
+}
+
+bool RAM::deserialize(OESnapshot *snapshot)
+{
+    OEAddress theSize;
+    
+    if (!snapshot->read(powerState) ||
+        !snapshot->read(theSize) ||
+        (theSize != size))
+        return false;
+    
+    if (!isDataShared &&
+        snapshot->readBlock(&mappedData, (size_t) size))
+    {
+        OEData().swap(data);
+        
+        datap = mappedData.getData();
+        
+        return true;
+    }
+    
+    return snapshot->readBlock(datap, (size_t) size);
+}
+
 OEChar RAM::read(OEAddress address)
 {
     return datap[address & mask];
@@ -151,10 +228,61 @@ void RAM::write(OEAddress address, OEChar value)
     datap[address & mask] = value;
 }
 
+// Blocks wrap around like single accesses
+void RAM::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress offset = address & mask;
+        OEAddress n = min(size, mask + 1 - offset);
+        
+        memcpy(data, datap + offset, (size_t) n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void RAM::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress offset = address & mask;
+        OEAddress n = min(size, mask + 1 - offset);
+        
+        memcpy(datap + offset, data, (size_t) n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
 void RAM::initMemory()
 {
+    // The pattern replaces the mapped image
+    if (mappedData.isOpen())
+    {
+        mappedData.close();
+        
+        data.resize((size_t) size);
+        datap = &data.front();
+    }
+    
     OEInt mask = (OEInt) powerOnPattern.size() - 1;
     
     for (OEInt i = 0; i < this->data.size(); i++)
         data[i] = powerOnPattern[i & mask];
 }
+
+void RAM::loadMappedData()
+{
+    if (!mappedData.isOpen())
+        return;
+    
+    mappedData.read(&data);
+    mappedData.close();
+    
+    datap = &data.front();
+}
@@ -20,6 +20,8 @@
 // * To determine the power state, set the controlBus.
 // * powerOnPattern is the byte pattern used when power is first applied.
 // * image is the RAM image.
+// * A mapped image of the right size is used copy-on-write until its
+//   OEData is requested.
 
 class RAM : public OEComponent
 {
@@ -30,6 +32,7 @@ public:
     bool getValue(string name, string &value);
     bool setRef(string name, OEComponent *ref);
     bool setData(string name, OEData *data);
+    bool setMappedData(string name, OEMappedData *data);
     bool getData(string name, OEData **data);
     bool init();
     void update();
@@ -38,8 +41,13 @@ public:
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
+    void readBlock(OEAddress address, OEChar *data, OEAddress size);
+    void writeBlock(OEAddress address, const OEChar *data, OEAddress size);
     
 protected:
     OEAddress size;
@@ -53,10 +61,13 @@ private:
     OEComponent *controlBus;
     
     OEData data;
+    OEMappedData mappedData;
+    bool isDataShared;
     
     ControlBusPowerState powerState;
     
     void initMemory();
+    void loadMappedData();
 };
 
 #endif
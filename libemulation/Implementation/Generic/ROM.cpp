@@ -10,10 +10,44 @@
 
 #include "ROM.h"
 
+ROM::ROM()
+{
+    sharedData = NULL;
+}
+
+ROM::~ROM()
+{
+    OESharedData::release(sharedData);
+}
+
 bool ROM::setData(string name, OEData *data)
 {
     if (name == "memoryImage")
+    {
+        mappedData.close();
+        
+        OESharedData::release(sharedData);
+        sharedData = NULL;
+        
         data->swap(this->data);
+    }
+    else
+        return false;
+    
+    return true;
+}
+
+bool ROM::setMappedData(string name, OEMappedData *data)
+{
+    if (name == "memoryImage")
+    {
+        this->data.clear();
+        
+        OESharedData::release(sharedData);
+        sharedData = NULL;
+        
+        data->swap(mappedData);
+    }
     else
         return false;
     
@@ -23,7 +57,12 @@ bool ROM::setData(string name, OEData *data)
 bool ROM::getData(string name, OEData **data)
 {
     if (name == "memoryImage")
+    {
+        loadMappedData();
+        unshareData();
+        
         *data = &this->data;
+    }
     else
         return false;
     
@@ -32,6 +71,23 @@ bool ROM::getData(string name, OEData **data)
 
 bool ROM::init()
 {
+    if (mappedData.isOpen())
+    {
+        OELong size = mappedData.getSize();
+        
+        if (size == (OELong) getNextPowerOf2(size))
+        {
+            datap = mappedData.getData();
+            mask = size - 1;
+            
+            return true;
+        }
+        
+        loadMappedData();
+    }
+    
+    unshareData();
+    
     if (!data.size())
     {
         logMessage("missing ROM");
@@ -44,6 +100,15 @@ bool ROM::init()
     datap = &data.front();
     mask = size - 1;
     
+    sharedData = OESharedData::retain(OESharedData::getKey("ROM", data), &data);
+    
+    if (sharedData)
+    {
+        data.clear();
+        
+        datap = (OEChar *) &sharedData->front();
+    }
+    
     return true;
 }
 
@@ -51,3 +116,42 @@ OEChar ROM::read(OEAddress address)
 {
     return datap[address & mask];
 }
+
+void ROM::readBlock(OEAddress address, OEChar *data, OEAddress size)
+{
+    while (size)
+    {
+        OEAddress offset = address & mask;
+        OEAddress n = min(size, mask + 1 - offset);
+        
+        memcpy(data, datap + offset, (size_t) n);
+        
+        address += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void ROM::loadMappedData()
+{
+    if (!mappedData.isOpen())
+        return;
+    
+    mappedData.read(&data);
+    mappedData.close();
+    
+    datap = &data.front();
+}
+
+void ROM::unshareData()
+{
+    if (!sharedData)
+        return;
+    
+    data = *sharedData;
+    
+    OESharedData::release(sharedData);
+    sharedData = NULL;
+    
+    datap = &data.front();
+}
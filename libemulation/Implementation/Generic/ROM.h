@@ -9,22 +9,35 @@
  */
 
 #include "OEComponent.h"
+#include "OESharedData.h"
 
 // Notes:
 // * image is the ROM image.
+// * A mapped image is used in place when its size is a power of two.
+// * Otherwise the image is shared with other ROMs of the same content.
 
 class ROM : public OEComponent
 {
 public:
+    ROM();
+    ~ROM();
+    
     bool setData(string name, OEData *data);
+    bool setMappedData(string name, OEMappedData *data);
     bool getData(string name, OEData **data);
     bool init();
     
     OEChar read(OEAddress address);
+    void readBlock(OEAddress address, OEChar *data, OEAddress size);
     
 private:
     OEData data;
+    OEMappedData mappedData;
+    const OEData *sharedData;
     
     OEChar *datap;
     OEAddress mask;
+    
+    void loadMappedData();
+    void unshareData();
 };
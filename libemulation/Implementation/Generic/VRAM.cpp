@@ -90,3 +90,23 @@ void VRAM::write(OEAddress address, OEChar value)
     
     datap[address] = value;
 }
+
+// A block is written at once, so the observer is notified once
+void VRAM::writeBlock(OEAddress address, const OEChar *data, OEAddress size)
+{
+    for (OEAddress i = 0; i < size; )
+    {
+        OEAddress blockAddress = (address + i) & mask;
+        
+        if (notifyMapp[blockAddress >> videoBlockBits])
+        {
+            videoObserver->notify(this, VRAM_WILL_CHANGE, NULL);
+            
+            break;
+        }
+        
+        i += videoBlockSize - (blockAddress & (videoBlockSize - 1));
+    }
+    
+    RAM::writeBlock(address, data, size);
+}
@@ -20,6 +20,7 @@ public:
     bool init();
     
     void write(OEAddress address, OEChar value);
+    void writeBlock(OEAddress address, const OEChar *data, OEAddress size);
     
 private:
     OEAddress videoBlockSize;
@@ -0,0 +1,97 @@
+/**
+ * libemulation
+ * Warp policy
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Warps a control bus while its devices do bulk work
+ */
+
+#include "WarpPolicy.h"
+
+#include "ControlBusInterface.h"
+
+WarpPolicy::WarpPolicy()
+{
+    controlBus = NULL;
+    
+    maxFrameMultiplier = 8;
+    
+    bulkActivity = false;
+}
+
+bool WarpPolicy::setValue(string name, string value)
+{
+    if (name == "maxFrameMultiplier")
+    {
+        maxFrameMultiplier = getOEInt(value);
+        
+        updateFrameMultiplier();
+    }
+    else
+        return false;
+        
+    return true;
+}
+
+bool WarpPolicy::getValue(string name, string& value)
+{
+    if (name == "maxFrameMultiplier")
+        value = getString(maxFrameMultiplier);
+    else
+        return false;
+        
+    return true;
+}
+
+bool WarpPolicy::setRef(string name, OEComponent *ref)
+{
+    if (name == "controlBus")
+    {
+        if (controlBus)
+            controlBus->removeObserver(this, CONTROLBUS_BULKACTIVITY_DID_CHANGE);
+        controlBus = ref;
+        if (controlBus)
+            controlBus->addObserver(this, CONTROLBUS_BULKACTIVITY_DID_CHANGE);
+    }
+    else
+        return false;
+        
+    return true;
+}
+
+bool WarpPolicy::init()
+{
+    OECheckComponent(controlBus);
+    
+    return true;
+}
+
+void WarpPolicy::dispose()
+{
+    bulkActivity = false;
+    
+    updateFrameMultiplier();
+}
+
+void WarpPolicy::notify(OEComponent *sender, int notification, void *data)
+{
+    bulkActivity = *((bool *)data);
+    
+    updateFrameMultiplier();
+}
+
+// Whole frames are multiplied, rather than the CPU clock, so devices
+// clocked by the bus keep their timing relative to the CPU
+void WarpPolicy::updateFrameMultiplier()
+{
+    if (!controlBus)
+        return;
+        
+    OEInt frameMultiplier = 1;
+    
+    if (bulkActivity && (maxFrameMultiplier > 1))
+        frameMultiplier = maxFrameMultiplier;
+        
+    controlBus->postMessage(this, CONTROLBUS_SET_FRAMEMULTIPLIER, &frameMultiplier);
+}
@@ -0,0 +1,33 @@
+/**
+ * libemulation
+ * Warp policy
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Warps a control bus while its devices do bulk work
+ */
+
+#include "OEComponent.h"
+
+class WarpPolicy : public OEComponent
+{
+public:
+    WarpPolicy();
+    
+    bool setValue(string name, string value);
+    bool getValue(string name, string& value);
+    bool setRef(string name, OEComponent *ref);
+    bool init();
+    void dispose();
+    
+    void notify(OEComponent *sender, int notification, void *data);
+    
+private:
+    OEComponent *controlBus;
+    
+    OEInt maxFrameMultiplier;
+    
+    bool bulkActivity;
+    
+    void updateFrameMultiplier();
+};
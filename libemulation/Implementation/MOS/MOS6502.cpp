@@ -12,6 +12,7 @@
 #include "MOS6502Opcodes.h"
 
 #include "CPUInterface.h"
+#include "MemoryInterface.h"
 
 MOS6502::MOS6502()
 {
@@ -22,6 +23,11 @@ MOS6502::MOS6502()
     
     icount = 0;
     
+    hybridAccuracy = false;
+    
+    dummyReadMap.resize(0x100, 1);
+    dummyReadMapp = &dummyReadMap.front();
+    
     isReset = false;
     isResetTransition = false;
     isIRQ = false;
@@ -45,6 +51,10 @@ bool MOS6502::setValue(string name, string value)
         p = getOEInt(value);
     else if (name == "pc")
         pc.w.l = getOEInt(value);
+    else if (name == "hybridAccuracy")
+        hybridAccuracy = getOEInt(value);
+    else if (name == "plainMemoryMap")
+        plainMemoryMap = value;
     else
         return false;
     
@@ -65,6 +75,8 @@ bool MOS6502::getValue(string name, string& value)
         value = getHexString(p);
     else if (name == "pc")
         value = getHexString(pc.w.l);
+    else if (name == "hybridAccuracy")
+        value = getString(hybridAccuracy);
     else
         return false;
     
@@ -103,6 +115,13 @@ bool MOS6502::setRef(string name, OEComponent *ref)
 
 bool MOS6502::init()
 {
+    if (!updateDummyReadMap())
+    {
+        logMessage("invalid value for plainMemoryMap");
+        
+        return false;
+    }
+    
     if (controlBus)
     {
         controlBus->postMessage(this, CONTROLBUS_GET_POWERSTATE, &powerState);
@@ -115,6 +134,11 @@ bool MOS6502::init()
     return true;
 }
 
+void MOS6502::update()
+{
+    updateDummyReadMap();
+}
+
 bool MOS6502::postMessage(OEComponent *sender, int message, void *data)
 {
     switch (message)
@@ -132,6 +156,16 @@ bool MOS6502::postMessage(OEComponent *sender, int message, void *data)
         case CPU_RUN:
             execute();
             
+            return true;
+            
+        case CPU_GET_PC:
+            *((OEInt *)data) = pc.w.l;
+            
+            return true;
+            
+        case CPU_GET_MEMORYBUS:
+            *((OEComponent **)data) = memoryBus;
+            
             return true;
     }
     
@@ -181,6 +215,47 @@ void MOS6502::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+bool MOS6502::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(a);
+    snapshot->write(x);
+    snapshot->write(y);
+    snapshot->write(p);
+    snapshot->write(pc);
+    snapshot->write(sp);
+    snapshot->write(icount);
+    snapshot->write(powerState);
+    snapshot->write(isReset);
+    snapshot->write(isResetTransition);
+    snapshot->write(isIRQ);
+    snapshot->write(isIRQEnabled);
+    snapshot->write(isNMITransition);
+    
+    return true;
+}
+
+bool MOS6502::deserialize(OESnapshot *snapshot)
+{
+    if (!snapshot->read(a) ||
+        !snapshot->read(x) ||
+        !snapshot->read(y) ||
+        !snapshot->read(p) ||
+        !snapshot->read(pc) ||
+        !snapshot->read(sp) ||
+        !snapshot->read(icount) ||
+        !snapshot->read(powerState) ||
+        !snapshot->read(isReset) ||
+        !snapshot->read(isResetTransition) ||
+        !snapshot->read(isIRQ) ||
+        !snapshot->read(isIRQEnabled) ||
+        !snapshot->read(isNMITransition))
+        return false;
+    
+    updateSpecialCondition();
+    
+    return true;
+}
+
 void MOS6502::initCPU()
 {
     a = 0x00;
@@ -196,6 +271,35 @@ void MOS6502::updateSpecialCondition()
     isSpecialCondition = isIRQ || isResetTransition || isNMITransition;
 }
 
+// In hybrid accuracy, dummy reads are skipped on pages of plain memory, as
+// they have no side effects there. The cycles are still counted
+bool MOS6502::updateDummyReadMap()
+{
+    MemoryMaps theMaps;
+    
+    if ((plainMemoryMap != "") &&
+        !appendMemoryMaps(theMaps, NULL, plainMemoryMap))
+        return false;
+    
+    fill(dummyReadMap.begin(), dummyReadMap.end(), 1);
+    
+    if (!hybridAccuracy)
+        return true;
+    
+    for (MemoryMaps::iterator i = theMaps.begin();
+         i != theMaps.end();
+         i++)
+    {
+        OEAddress startPage = (i->startAddress + 0xff) >> 8;
+        OEAddress endPage = (i->endAddress + 1) >> 8;
+        
+        for (OEAddress page = startPage; (page < endPage) && (page < 0x100); page++)
+            dummyReadMap[page] = 0;
+    }
+    
+    return true;
+}
+
 void MOS6502::execute()
 {
     if (powerState != CONTROLBUS_POWERSTATE_ON)
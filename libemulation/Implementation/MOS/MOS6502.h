@@ -23,11 +23,15 @@ public:
     bool getValue(string name, string& value);
     bool setRef(string name, OEComponent *ref);
     bool init();
+    void update();
     
     bool postMessage(OEComponent *sender, int message, void *data);
     
     void notify(OEComponent *sender, int notification, void *data);
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 protected:
     OEChar a;
     OEChar x;
@@ -41,6 +45,12 @@ protected:
     
     OESLong icount;
     
+    bool hybridAccuracy;
+    string plainMemoryMap;
+    
+    vector<OEChar> dummyReadMap;
+    OEChar *dummyReadMapp;
+    
     ControlBusPowerState powerState;
     
     bool isReset;
@@ -53,6 +63,7 @@ protected:
     
     void initCPU();
     void updateSpecialCondition();
+    bool updateDummyReadMap();
     virtual void execute();
 };
 
@@ -92,6 +92,16 @@
 #define RDMEM(addr) memoryBus->read(addr); icount--
 #define RDMEM_ID(a) memoryBus->read(a); icount--
 
+/***************************************************************
+ *  RDDUM   dummy read, skipped on pages without side effects
+ *  cores not derived from MOS6502 have no map and always read
+ ***************************************************************/
+#ifdef _MOS6502_H
+#define RDDUM(addr) do { if (dummyReadMapp[((addr) >> 8) & 0xff]) memoryBus->read(addr); icount--; } while (0)
+#else
+#define RDDUM(addr) do { memoryBus->read(addr); icount--; } while (0)
+#endif
+
 /***************************************************************
  *  WRMEM   write memory
  ***************************************************************/
@@ -107,11 +117,11 @@
         OESChar tmp2 = RDOPARG();								\
         if (cond)												\
         {														\
-            RDMEM(PCW);											\
+            RDDUM(PCW);											\
             EAW = PCW + tmp2;                                   \
             if (EAH != PCH)                                     \
             {                                                   \
-                RDMEM((PCH << 8) | EAL);						\
+                RDDUM((PCH << 8) | EAL);						\
             }                                                   \
             PCA = EAA;											\
         }														\
@@ -135,7 +145,7 @@
  ***************************************************************/
 #define EA_ZPX													\
     ZPL = RDOPARG();											\
-    RDMEM(ZPA);													\
+    RDDUM(ZPA);													\
     ZPL = X + ZPL;												\
     EAA = ZPA
 
@@ -144,7 +154,7 @@
  ***************************************************************/
 #define EA_ZPY													\
     ZPL = RDOPARG();											\
-    RDMEM(ZPA);													\
+    RDDUM(ZPA);													\
     ZPL = Y + ZPL;												\
     EAA = ZPA
 
@@ -163,7 +173,7 @@
     EA_ABS; 													\
     if (EAL + X > 0xff)                                         \
     {                                                           \
-        RDMEM((EAH << 8) | ((EAL + X) & 0xff));                 \
+        RDDUM((EAH << 8) | ((EAL + X) & 0xff));                 \
     }                                                           \
     EAW += X;
 
@@ -172,7 +182,7 @@
  ***************************************************************/
 #define EA_ABX_NP												\
     EA_ABS;														\
-    RDMEM((EAH << 8) | ((EAL + X) & 0xff));                     \
+    RDDUM((EAH << 8) | ((EAL + X) & 0xff));                     \
     EAW += X
 
 /***************************************************************
@@ -183,7 +193,7 @@
     EA_ABS; 													\
     if (EAL + Y > 0xff)                                         \
     {                                                           \
-        RDMEM((EAH << 8) | ((EAL + Y) & 0xff));                 \
+        RDDUM((EAH << 8) | ((EAL + Y) & 0xff));                 \
     }                                                           \
     EAW += Y;
 
@@ -192,7 +202,7 @@
  ***************************************************************/
 #define EA_ABY_NP												\
     EA_ABS;														\
-    RDMEM((EAH << 8) | ((EAL + Y) & 0xff));                     \
+    RDDUM((EAH << 8) | ((EAL + Y) & 0xff));                     \
     EAW += Y
 
 /***************************************************************
@@ -200,7 +210,7 @@
  ***************************************************************/
 #define EA_IDX													\
     ZPL = RDOPARG();											\
-    RDMEM(ZPA);													\
+    RDDUM(ZPA);													\
     ZPL = ZPL + X;												\
     EAL = RDMEM(ZPA);											\
     ZPL++;														\
@@ -217,7 +227,7 @@
     EAH = RDMEM(ZPA);											\
     if (EAL + Y > 0xff) 										\
     {                                                           \
-        RDMEM((EAH << 8 ) | ((EAL + Y) & 0xff));                \
+        RDDUM((EAH << 8 ) | ((EAL + Y) & 0xff));                \
     }                                                           \
     EAW += Y;
 
@@ -229,7 +239,7 @@
     EAL = RDMEM(ZPA);											\
     ZPL++;														\
     EAH = RDMEM(ZPA);											\
-    RDMEM((EAH << 8) | ((EAL + Y) & 0xff));                     \
+    RDDUM((EAH << 8) | ((EAL + Y) & 0xff));                     \
     EAW += Y
 
 /***************************************************************
@@ -272,17 +282,17 @@
 
 #define RD_IMM              tmp = RDOPARG()
 #define RD_IMM_DISCARD      RDOPARG()
-#define RD_DUM              RDMEM(PCW)
+#define RD_DUM              RDDUM(PCW)
 #define RD_ACC              tmp = A
 #define RD_ZPG              EA_ZPG; tmp = RDMEM(EAA)
-#define RD_ZPG_DISCARD      EA_ZPG; RDMEM(EAA)
+#define RD_ZPG_DISCARD      EA_ZPG; RDDUM(EAA)
 #define RD_ZPX              EA_ZPX; tmp = RDMEM(EAA)
-#define RD_ZPX_DISCARD      EA_ZPX; RDMEM(EAA)
+#define RD_ZPX_DISCARD      EA_ZPX; RDDUM(EAA)
 #define RD_ZPY              EA_ZPY; tmp = RDMEM(EAA)
 #define RD_ABS              EA_ABS; tmp = RDMEM(EAA)
-#define RD_ABS_DISCARD      EA_ABS; RDMEM(EAA)
+#define RD_ABS_DISCARD      EA_ABS; RDDUM(EAA)
 #define RD_ABX_P            EA_ABX_P; tmp = RDMEM(EAA)
-#define RD_ABX_P_DISCARD    EA_ABX_P; RDMEM(EAA);
+#define RD_ABX_P_DISCARD    EA_ABX_P; RDDUM(EAA)
 #define RD_ABX_NP           EA_ABX_NP; tmp = RDMEM(EAA)
 #define RD_ABY_P            EA_ABY_P; tmp = RDMEM(EAA)
 #define RD_ABY_NP           EA_ABY_NP; tmp = RDMEM(EAA)
@@ -303,7 +313,7 @@
 #define WR_ZPI              EA_ZPI; WRMEM(EAA, tmp)
 
 /* dummy read from the last EA */
-#define RD_EA               RDMEM(EAA)
+#define RD_EA               RDDUM(EAA)
 
 /* write back a value from tmp to the last EA */
 #define WB_ACC              A = (OEChar)tmp;
@@ -319,7 +329,7 @@
  * push a register onto the stack
  ***************************************************************/
 #define PUSH(Rg)            WRMEM(SPA, Rg); S--
-#define PUSH_DISCARD(Rg)    RDMEM(SPA); S--
+#define PUSH_DISCARD(Rg)    RDDUM(SPA); S--
 
 /***************************************************************
  * pull a register from the stack
@@ -565,7 +575,7 @@
  ***************************************************************/
 #define JSR 													\
     EAL = RDOPARG();											\
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PUSH(PCH);													\
     PUSH(PCL);													\
     EAH = RDOPARG();											\
@@ -629,7 +639,7 @@
  * PLA Pull accumulator
  ***************************************************************/
 #define PLA 													\
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(A);													\
     SET_NZ(A)
 
@@ -638,7 +648,7 @@
  * PLP Pull processor status (flags)
  ***************************************************************/
 #define PLP 													\
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(P);                                                    \
     P |= (F_T | F_B);
 
@@ -669,7 +679,7 @@
  ***************************************************************/
 #define RTI 													\
     RDOPARG();													\
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(P);													\
     PULL(PCL);													\
     PULL(PCH);													\
@@ -681,10 +691,10 @@
  ***************************************************************/
 #define RTS 													\
     RDOPARG();													\
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(PCL);													\
     PULL(PCH);													\
-    RDMEM(PCW); PCW++
+    RDDUM(PCW); PCW++
 
 /* 6502 ********************************************************
  * SBC Subtract with carry
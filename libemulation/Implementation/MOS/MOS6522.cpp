@@ -273,6 +273,43 @@ void MOS6522::notify(OEComponent *sender, int notification, void *data)
     }
 }
 
+// IRQ lines are restored by the control bus
+bool MOS6522::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(ddrA);
+    snapshot->write(dataA);
+    snapshot->write(ca1);
+    snapshot->write(ca2);
+    snapshot->write(ddrB);
+    snapshot->write(dataB);
+    snapshot->write(cb1);
+    snapshot->write(cb2);
+    snapshot->write(shift);
+    snapshot->write(auxControl);
+    snapshot->write(peripheralControl);
+    snapshot->write(interruptFlags);
+    snapshot->write(interruptEnable);
+    
+    return true;
+}
+
+bool MOS6522::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(ddrA) &&
+            snapshot->read(dataA) &&
+            snapshot->read(ca1) &&
+            snapshot->read(ca2) &&
+            snapshot->read(ddrB) &&
+            snapshot->read(dataB) &&
+            snapshot->read(cb1) &&
+            snapshot->read(cb2) &&
+            snapshot->read(shift) &&
+            snapshot->read(auxControl) &&
+            snapshot->read(peripheralControl) &&
+            snapshot->read(interruptFlags) &&
+            snapshot->read(interruptEnable));
+}
+
 OEChar MOS6522::read(OEAddress address)
 {
     switch (address & 0xf)
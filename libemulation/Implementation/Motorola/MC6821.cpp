@@ -262,6 +262,37 @@ void MC6821::notify(OEComponent *component, int notification, void *data)
     }
 }
 
+// IRQ lines are restored by the control bus
+bool MC6821::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(controlA);
+    snapshot->write(ddrA);
+    snapshot->write(dataA);
+    snapshot->write(ca1);
+    snapshot->write(ca2);
+    snapshot->write(controlB);
+    snapshot->write(ddrB);
+    snapshot->write(dataB);
+    snapshot->write(cb1);
+    snapshot->write(cb2);
+    
+    return true;
+}
+
+bool MC6821::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(controlA) &&
+            snapshot->read(ddrA) &&
+            snapshot->read(dataA) &&
+            snapshot->read(ca1) &&
+            snapshot->read(ca2) &&
+            snapshot->read(controlB) &&
+            snapshot->read(ddrB) &&
+            snapshot->read(dataB) &&
+            snapshot->read(cb1) &&
+            snapshot->read(cb2));
+}
+
 OEChar MC6821::read(OEAddress address)
 {
     switch(address & 0x3)
@@ -53,6 +53,9 @@ public:
 	
 	void notify(OEComponent *component, int notification, void *data);
 	
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 	OEChar read(OEAddress address);
 	void write(OEAddress address, OEChar value);
 	
@@ -56,6 +56,26 @@ bool MM58167::init()
     return true;
 }
 
+bool MM58167::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(deltaSec);
+    snapshot->write(deltaUSec);
+    snapshot->write(interruptFlags);
+    snapshot->write(interruptControl);
+    snapshot->write(ramp, ram.size());
+    
+    return true;
+}
+
+bool MM58167::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(deltaSec) &&
+            snapshot->read(deltaUSec) &&
+            snapshot->read(interruptFlags) &&
+            snapshot->read(interruptControl) &&
+            snapshot->read(ramp, ram.size()));
+}
+
 OEChar MM58167::read(OEAddress address)
 {
     logMessage("MM58167 R " + getHexString(address & 0x1f));
@@ -16,6 +16,8 @@ RDCFFA::RDCFFA()
     
     csMask = 0;
     ataData = 0;
+    
+    resetSector();
 }
 
 bool RDCFFA::setRef(string name, OEComponent *ref)
@@ -35,6 +37,29 @@ bool RDCFFA::init()
     return true;
 }
 
+// The local sector copy is stored, so a transfer resumes where it was
+bool RDCFFA::serialize(OESnapshot *snapshot)
+{
+    snapshot->write(csMask);
+    snapshot->write(ataData);
+    snapshot->write(sectorData);
+    snapshot->write(sectorIndex);
+    snapshot->write(sectorSize);
+    snapshot->write(sectorWrite);
+    
+    return true;
+}
+
+bool RDCFFA::deserialize(OESnapshot *snapshot)
+{
+    return (snapshot->read(csMask) &&
+            snapshot->read(ataData) &&
+            snapshot->read(sectorData) &&
+            snapshot->read(sectorIndex) &&
+            snapshot->read(sectorSize) &&
+            snapshot->read(sectorWrite));
+}
+
 OEChar RDCFFA::read(OEAddress address)
 {
     switch (address & 0xf)
@@ -53,10 +78,10 @@ OEChar RDCFFA::read(OEAddress address)
             break;
             
         case 0x6:
-            return ataController->read(0x3f6);
+            return readStatus(0x3f6);
             
         case 0x8:
-            return csMask ? 0 : (ataData = ataController->read16(0x1f0));
+            return csMask ? 0 : (ataData = readData());
             
         case 0x9:
             return ataController->read(0x1f1);
@@ -77,7 +102,7 @@ OEChar RDCFFA::read(OEAddress address)
             return ataController->read(0x1f6);
             
         case 0xf:
-            return ataController->read(0x1f7);
+            return readStatus(0x1f7);
     }
     
     return 0;
@@ -103,12 +128,14 @@ void RDCFFA::write(OEAddress address, OEChar value)
             break;
             
         case 0x6:
+            resetSector();
+            
             ataController->write(0x3f6, value);
             
             break;
             
         case 0x8:
-            ataController->write16(0x1f0, ataData | value);
+            writeData(ataData | value);
             
             break;
             
@@ -143,8 +170,92 @@ void RDCFFA::write(OEAddress address, OEChar value)
             break;
             
         case 0xf:
+            resetSector();
+            
             ataController->write(0x1f7, value);
             
             break;
     }
 }
+
+// The firmware streams whole sectors through the data register. Sectors are
+// transferred in bulk from and to the ATA controller, and served from a local
+// copy in between.
+OEShort RDCFFA::readData()
+{
+    if (sectorIndex == sectorSize)
+    {
+        resetSector();
+        
+        ATAData data;
+        data.data = sectorData;
+        data.size = ATA_SECTOR_SIZE;
+        
+        if (!ataController->postMessage(this, ATACONTROLLER_READ_DATA, &data) ||
+            !data.size)
+            return ataController->read16(0x1f0);
+        
+        sectorSize = data.size;
+    }
+    
+    OEShort value = sectorData[sectorIndex] | (sectorData[sectorIndex + 1] << 8);
+    
+    sectorIndex += 2;
+    
+    return value;
+}
+
+void RDCFFA::writeData(OEShort value)
+{
+    if (!sectorWrite)
+    {
+        resetSector();
+        
+        ATAData data;
+        data.data = sectorData;
+        data.size = 0;
+        
+        if (!ataController->postMessage(this, ATACONTROLLER_WRITE_DATA, &data))
+        {
+            ataController->write16(0x1f0, value);
+            
+            return;
+        }
+        
+        sectorWrite = true;
+    }
+    
+    sectorData[sectorIndex] = value;
+    sectorData[sectorIndex + 1] = value >> 8;
+    
+    sectorIndex += 2;
+    
+    if (sectorIndex == ATA_SECTOR_SIZE)
+    {
+        ATAData data;
+        data.data = sectorData;
+        data.size = ATA_SECTOR_SIZE;
+        
+        ataController->postMessage(this, ATACONTROLLER_WRITE_DATA, &data);
+        
+        resetSector();
+    }
+}
+
+OEChar RDCFFA::readStatus(OEAddress address)
+{
+    OEChar status = ataController->read(address);
+    
+    // Data is still pending while the local sector copy is not drained
+    if (sectorIndex < sectorSize)
+        OEAssertBit(status, ATA_DRQ);
+    
+    return status;
+}
+
+void RDCFFA::resetSector()
+{
+    sectorIndex = 0;
+    sectorSize = 0;
+    sectorWrite = false;
+}
@@ -10,6 +10,8 @@
 
 #include "OEComponent.h"
 
+#include "ATAInterface.h"
+
 class RDCFFA : public OEComponent
 {
 public:
@@ -18,12 +20,25 @@ public:
     bool setRef(string name, OEComponent *ref);
     bool init();
     
+    bool serialize(OESnapshot *snapshot);
+    bool deserialize(OESnapshot *snapshot);
+    
 private:
     OEComponent *ataController;
     
     bool csMask;
     OEShort ataData;
     
+    OEChar sectorData[ATA_SECTOR_SIZE];
+    OEInt sectorIndex;
+    OEInt sectorSize;
+    bool sectorWrite;
+    
     OEChar read(OEAddress address);
     void write(OEAddress address, OEChar value);
+    
+    OEShort readData();
+    void writeData(OEShort value);
+    OEChar readStatus(OEAddress address);
+    void resetSector();
 };
@@ -160,7 +160,7 @@
 #define W65C02S_OPd5 { int tmp; RD_ZPX; CMP;                      } /* 4 CMP ZPX */
 #define W65C02S_OPf5 { int tmp; RD_ZPX; SBC_C02;                  } /* 4/5 SBC ZPX */
 
-#define W65C02S_OP06 { int tmp; RD_ZPG, RD_EA; ASL; WB_EA;        } /* 5 ASL ZPG */
+#define W65C02S_OP06 { int tmp; RD_ZPG; RD_EA; ASL; WB_EA;        } /* 5 ASL ZPG */
 #define W65C02S_OP26 { int tmp; RD_ZPG; RD_EA; ROL; WB_EA;        } /* 5 ROL ZPG */
 #define W65C02S_OP46 { int tmp; RD_ZPG; RD_EA; LSR; WB_EA;        } /* 5 LSR ZPG */
 #define W65C02S_OP66 { int tmp; RD_ZPG; RD_EA; ROR; WB_EA;        } /* 5 ROR ZPG */
@@ -38,7 +38,7 @@
     EA_ABS;                                                     \
     if (EAL + X > 0xff)                                         \
     {                                                           \
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }                                                           \
     EAW += X;
 
@@ -47,7 +47,7 @@
  ***************************************************************/
 #define EA_ABX_C02_NP                                           \
     EA_ABS;														\
-    RDMEM(PCW - 1);                                             \
+    RDDUM(PCW - 1);                                             \
     EAW += X;
 
 /***************************************************************
@@ -58,7 +58,7 @@
     EA_ABS;														\
     if (EAL + Y > 0xff)                                         \
     {                                                           \
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }                                                           \
     EAW += Y;
 
@@ -67,7 +67,7 @@
  ***************************************************************/
 #define EA_ABY_C02_NP                                           \
     EA_ABS;														\
-    RDMEM(PCW - 1);                                             \
+    RDDUM(PCW - 1);                                             \
     EAW += Y
 
 /* 65C02 *******************************************************
@@ -81,7 +81,7 @@
     EAH = RDMEM(ZPA);											\
     if (EAL + Y > 0xff) 										\
     {                                                           \
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }                                                           \
     EAW += Y;
 
@@ -93,7 +93,7 @@
     EAL = RDMEM(ZPA);											\
     ZPL++;														\
     EAH = RDMEM(ZPA);											\
-    RDMEM(PCW - 1);                                             \
+    RDDUM(PCW - 1);                                             \
     EAW += Y
 
 /* 65C02 *******************************************************
@@ -103,7 +103,7 @@
 #define EA_IND_C02                                              \
     EA_ABS;														\
     tmp = RDMEM(EAA);											\
-    RDMEM(PCW - 1);												\
+    RDDUM(PCW - 1);												\
     EAA++;														\
     EAH = RDMEM(EAA);											\
     EAL = tmp
@@ -113,10 +113,10 @@
  ***************************************************************/
 #define EA_IAX                                                  \
     EA_ABS;														\
-    RDMEM(PCW - 1);                                             \
+    RDDUM(PCW - 1);                                             \
     if (EAL + X > 0xff) 										\
     {                                                           \
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }                                                           \
     EAW += X;													\
     tmp = RDMEM(EAA);											\
@@ -149,11 +149,11 @@
     tmp = RDOPARG();											\
     if (cond)													\
     {															\
-        RDMEM(PCW);												\
+        RDDUM(PCW);												\
         EAW = PCW + (OESChar)tmp;                               \
         if (EAH != PCH) 										\
         {                                                       \
-            RDMEM(PCW - 1);										\
+            RDDUM(PCW - 1);										\
         }                                                       \
         PCA = EAA;												\
     }
@@ -181,7 +181,7 @@
         if (hi & 0xff00)                                        \
             P |= F_C;											\
         A = (lo & 0x0f) + (hi & 0xf0);							\
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }															\
     else														\
     {															\
@@ -219,7 +219,7 @@
         if ((sum & 0xff00) == 0)								\
             P |= F_C;											\
         A = (lo & 0x0f) + (hi & 0xf0);							\
-        RDMEM(PCW - 1);                                         \
+        RDDUM(PCW - 1);                                         \
     }															\
     else														\
     {															\
@@ -290,7 +290,7 @@
  *  PLX Pull index X
  ***************************************************************/
 #define PLX                                                     \
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(X);													\
     SET_NZ(X)
 
@@ -298,7 +298,7 @@
  *  PLY Pull index Y
  ***************************************************************/
 #define PLY                                                     \
-    RDMEM(SPA);													\
+    RDDUM(SPA);													\
     PULL(Y);													\
     SET_NZ(Y)
 
@@ -348,7 +348,7 @@
  ***************************************************************/
 #define BSR                                                     \
     EAL = RDOPARG();											\
-    RDMEM(SPD);													\
+    RDDUM(SPD);													\
     PUSH(PCH);													\
     PUSH(PCL);													\
     EAH = RDOPARG();											\
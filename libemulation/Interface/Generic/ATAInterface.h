@@ -0,0 +1,46 @@
+/**
+ * libemulation
+ * ATA interface
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Defines the ATA interface
+ */
+
+// Notes:
+// * readData transfers pending sector data from the ATA controller, as if
+//   the data register was read repeatedly. It is only available at a sector
+//   boundary in 16-bit PIO mode, and transfers whole sectors up to
+//   ATAData.size. ATAData.size returns the number of transferred bytes.
+// * writeData transfers whole sectors to the ATA controller, as if the data
+//   register was written repeatedly. With ATAData.size = 0 it tests whether
+//   a write transfer is pending at a sector boundary.
+
+#ifndef _ATAINTERFACE_H
+#define _ATAINTERFACE_H
+
+#include "OECommon.h"
+
+#define ATA_SECTOR_SIZE         0x200
+
+// ATA status codes
+#define ATA_ERR                 (1 << 0)
+#define ATA_DRQ                 (1 << 3)
+#define ATA_DSC                 (1 << 4)
+#define ATA_DF                  (1 << 5)
+#define ATA_RDY                 (1 << 6)
+#define ATA_BSY                 (1 << 7)
+
+typedef enum
+{
+    ATACONTROLLER_READ_DATA,
+    ATACONTROLLER_WRITE_DATA,
+} ATAControllerMessage;
+
+typedef struct
+{
+    OEChar *data;
+    OEInt size;
+} ATAData;
+
+#endif
@@ -12,6 +12,9 @@
 // * setPendingCycles sets the number of cycles to be executed (OESLong)
 // * getPendingCycles returns the number of remaining cycles (OESLong)
 // * run executes a number of CPU cycles
+// * getPC returns the program counter (OEInt)
+// * getMemoryBus returns the component the CPU accesses memory through
+//   (OEComponent *)
 
 #ifndef _CPUINTERFACE_H
 #define _CPUINTERFACE_H
@@ -21,6 +24,8 @@ typedef enum
 	CPU_SET_PENDINGCYCLES,
 	CPU_GET_PENDINGCYCLES,
 	CPU_RUN,
+    CPU_GET_PC,
+    CPU_GET_MEMORYBUS,
     CPU_END,
 } CPUMessage;
 
@@ -13,6 +13,17 @@
 // * invalidateTimers receives the id of the timers to be removed
 // * timerDidFire passes the timer using ControlBusTimer
 //   (cycles is the number of remaining cycles for this timer)
+// * runFrame runs a powered bus for an AudioBuffer, without ending the
+//   emulation's frame (used for running ahead)
+// * assertWarp and clearWarp are counted. While warp is asserted, the bus
+//   runs warpFrameMultiplier frames for each audio buffer. Presentation is
+//   suppressed in all frames but the last
+// * setFrameMultiplier sets the number of frames run for each audio buffer
+//   (OEInt). Warp runs at least warpFrameMultiplier frames
+// * warpDidChange passes whether presentation is suppressed (bool)
+// * assertBulkActivity and clearBulkActivity are counted. Devices assert
+//   bulk activity during slow work that does not need presentation, such
+//   as disk access. bulkActivityDidChange passes the state (bool)
 
 #ifndef _CONTROLBUSINTERFACE_H
 #define _CONTROLBUSINTERFACE_H
@@ -37,7 +48,15 @@ typedef enum
     CONTROLBUS_SCHEDULE_TIMER,
     CONTROLBUS_INVALIDATE_TIMERS,
     
+    CONTROLBUS_RUN_FRAME,
+    
     CONTROLBUS_SET_CPUCLOCKMULTIPLIER,
+    CONTROLBUS_ASSERT_WARP,
+    CONTROLBUS_CLEAR_WARP,
+    CONTROLBUS_IS_WARP_ASSERTED,
+    CONTROLBUS_SET_FRAMEMULTIPLIER,
+    CONTROLBUS_ASSERT_BULKACTIVITY,
+    CONTROLBUS_CLEAR_BULKACTIVITY,
     
     CONTROLBUS_ASSERT_RESET,
     CONTROLBUS_CLEAR_RESET,
@@ -62,6 +81,8 @@ typedef enum
     CONTROLBUS_IRQ_DID_CHANGE,
     CONTROLBUS_NMI_DID_ASSERT,
     CONTROLBUS_NMI_DID_CLEAR,
+    CONTROLBUS_WARP_DID_CHANGE,
+    CONTROLBUS_BULKACTIVITY_DID_CHANGE,
 } ControlBusNotification;
 
 typedef enum
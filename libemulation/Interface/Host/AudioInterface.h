@@ -10,6 +10,8 @@
 
 // Notes:
 // * Buffer notifications send AudioBuffer
+// * isSkipped is set for buffers that are rendered faster than real time,
+//   and are not presented
 
 #ifndef _AUDIOINTERFACE_H
 #define _AUDIOINTERFACE_H
@@ -30,6 +32,7 @@ typedef struct
     OEInt frameNum;
     const float *input;
     float *output;
+    bool isSkipped;
 } AudioBuffer;
 
 float getLevelFromVolume(float value);
@@ -18,6 +18,10 @@
 
 using namespace std;
 
+// Notes:
+// * setProgress sets the progress of a lengthy operation, such as a paste,
+//   from 0 to 1 (float). A negative value means there is none
+
 typedef enum
 {
     DEVICE_SET_LABEL,
@@ -28,6 +32,8 @@ typedef enum
     DEVICE_GET_LOCATIONLABEL,
     DEVICE_SET_STATELABEL,
     DEVICE_GET_STATELABEL,
+    DEVICE_SET_PROGRESS,
+    DEVICE_GET_PROGRESS,
     
     DEVICE_SET_SETTINGS,
     DEVICE_GET_SETTINGS,
@@ -43,6 +49,9 @@ typedef enum
     DEVICE_GET_STORAGES,
     
     DEVICE_UPDATE,
+    
+    DEVICE_FILTER_INPUT,
+    DEVICE_GET_RANDOM,
 } DeviceMessage;
 
 typedef struct
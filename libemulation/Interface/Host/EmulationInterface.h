@@ -18,6 +18,18 @@
 
 using namespace std;
 
+// Notes:
+// * Components that relay host input post EMULATION_FILTER_INPUT with an
+//   EmulationInput before delivering it. The message returns true when the
+//   input must be dropped, as while a journal is being replayed.
+// * Replayed input is delivered by calling the relay's notify() with the
+//   original sender.
+// * Control buses post EMULATION_END_FRAME with the AudioBuffer they ran.
+// * Control buses post EMULATION_END_BOOT once, when their ready condition
+//   is first met. The emulation may cache a snapshot at that point.
+// * EMULATION_GET_RANDOM gets an OEInt from the emulation's seeded
+//   generator, which is saved with snapshots.
+
 typedef enum
 {
     EMULATION_CONSTRUCT_DISPLAYCANVAS,
@@ -29,11 +41,23 @@ typedef enum
     
     EMULATION_ASSERT_ACTIVITY,
     EMULATION_CLEAR_ACTIVITY,
+    
+    EMULATION_ASSERT_HIBERNATION,
+    EMULATION_CLEAR_HIBERNATION,
+    
+    EMULATION_ADD_CONTROLBUS,
+    EMULATION_REMOVE_CONTROLBUS,
+    EMULATION_END_FRAME,
+    EMULATION_END_BOOT,
+    
+    EMULATION_FILTER_INPUT,
+    EMULATION_GET_RANDOM,
 } EmulationMessage;
 
 typedef enum
 {
     EMULATION_WAS_SIGNALED,
+    EMULATION_DID_RESUME,
 } EmulationNotification;
 
 typedef enum
@@ -80,4 +104,20 @@ typedef enum
     EMULATION_END,
 } EmulationEvent;
 
+typedef enum
+{
+    EMULATION_INPUT_VALUE,
+    EMULATION_INPUT_STRING,
+} EmulationInputType;
+
+// Values are copied with their size, strings are wstrings
+typedef struct
+{
+    OEComponent *sender;
+    int notification;
+    EmulationInputType type;
+    void *data;
+    OEInt size;
+} EmulationInput;
+
 #endif
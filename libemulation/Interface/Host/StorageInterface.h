@@ -21,10 +21,16 @@
 //   E.g.: "16 sectors, 35 track, read-only".
 // * getObject() returns an object related to the storage device.
 //   (usually the object containing the data)
+// * flush() writes back any cached data to the mounted image.
+// * getCacheStats() returns the block cache counters in StorageCacheStats.
+// * commitOverlay() writes the changes held in a copy-on-write overlay
+//   back to the base image.
 
 #ifndef _STORAGEINTERFACE_H
 #define _STORAGEINTERFACE_H
 
+#include "OECommon.h"
+
 typedef enum
 {
     STORAGE_IS_AVAILABLE,
@@ -40,7 +46,18 @@ typedef enum
     
     STORAGE_GET_OBJECT,
     
+    STORAGE_FLUSH,
+    STORAGE_GET_CACHESTATS,
+    
+    STORAGE_COMMIT_OVERLAY,
+    
     STORAGE_END,
 } StorageMessage;
 
+typedef struct
+{
+    OELong hitNum;
+    OELong missNum;
+} StorageCacheStats;
+
 #endif
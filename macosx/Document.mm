@@ -284,10 +284,20 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     OEEmulation *theEmulation = new OEEmulation();
     
     theEmulation->setResourcePath([[[NSBundle mainBundle] resourcePath] cppString]);
+    
+    NSString *cachePath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory,
+                                                               NSUserDomainMask,
+                                                               YES) objectAtIndex:0];
+    cachePath = [cachePath stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]];
+    theEmulation->setCachePath([cachePath cppString]);
+    
     theEmulation->setConstructCanvas(constructCanvas);
     theEmulation->setDestroyCanvas(destroyCanvas);
     theEmulation->setUserData(self);
     
+    theEmulation->setProfile([[NSUserDefaults standardUserDefaults]
+                              boolForKey:@"OEProfileStartup"]);
+    
     theEmulation->addComponent("emulation", theEmulation);
     theEmulation->addComponent("audio", paAudio);
     theEmulation->addComponent("joystick", hidJoystick);
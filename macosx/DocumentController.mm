@@ -176,6 +176,7 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
                               [NSNumber numberWithBool:NO], @"OEAudioFullDuplex",
                               [NSNumber numberWithFloat:1], @"OEAudioPlayVolume",
                               [NSNumber numberWithBool:YES], @"OEAudioPlayThrough",
+                              [NSNumber numberWithInt:1], @"OEAudioPlaySpeed",
                               [NSNumber numberWithBool:shaderDefault], @"OEVideoEnableShader",
                               nil
                               ];
@@ -198,6 +199,10 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
                    forKeyPath:@"OEAudioPlayThrough"
                       options:NSKeyValueObservingOptionNew
                       context:nil];
+    [userDefaults addObserver:self
+                   forKeyPath:@"OEAudioPlaySpeed"
+                      options:NSKeyValueObservingOptionNew
+                      context:nil];
     
     ((PAAudio *)paAudio)->setFullDuplex([userDefaults
                                          boolForKey:@"OEAudioFullDuplex"]);
@@ -205,6 +210,8 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
                                            floatForKey:@"OEAudioPlayVolume"]);
     ((PAAudio *)paAudio)->setPlayerPlayThrough([userDefaults
                                                 boolForKey:@"OEAudioPlayThrough"]);
+    ((PAAudio *)paAudio)->setPlayerSpeed((OEInt) [userDefaults
+                                                  integerForKey:@"OEAudioPlaySpeed"]);
     
     ((PAAudio *)paAudio)->open();
 }
@@ -411,6 +418,8 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
         ((PAAudio *)paAudio)->setPlayerVolume([theObject floatValue]);
     else if ([keyPath isEqualToString:@"OEAudioPlayThrough"])
         ((PAAudio *)paAudio)->setPlayerPlayThrough([theObject boolValue]);
+    else if ([keyPath isEqualToString:@"OEAudioPlaySpeed"])
+        ((PAAudio *)paAudio)->setPlayerSpeed([theObject intValue]);
 }
 
 - (BOOL)validateUserInterfaceItem:(id <NSValidatedUserInterfaceItem>)anItem
@@ -0,0 +1,193 @@
+/**
+ * libemulation
+ * Apple III snapshot test
+ * (C) 2012 by Marc S. Ressl (mressl@umich.edu)
+ * Released under the GPL
+ *
+ * Checks that a restored Apple III system control maps its banks again
+ */
+
+#include <map>
+
+#include "AppleIIISystemControl.h"
+
+#include "MemoryInterface.h"
+
+#include "AppleIIInterface.h"
+#include "AppleIIIInterface.h"
+
+#include "MOS6522.h"
+
+#define TEST_BANKNUM    8
+
+// Records the offset mapped at each start address
+class TestSwitcher : public OEComponent
+{
+public:
+    map<OEAddress, OESLong> offsets;
+    
+    bool postMessage(OEComponent *sender, int message, void *data)
+    {
+        if (message != ADDRESSOFFSET_MAP)
+            return false;
+        
+        AddressOffsetMap *offsetMap = (AddressOffsetMap *)data;
+        
+        offsets[offsetMap->startAddress] = offsetMap->offset;
+        
+        return true;
+    }
+};
+
+class TestRAM : public OEComponent
+{
+public:
+    TestRAM()
+    {
+        data.resize(TEST_BANKNUM * APPLEIII_BANKSIZE);
+    }
+    
+    bool postMessage(OEComponent *sender, int message, void *data)
+    {
+        if (message != RAM_GET_DATA)
+            return false;
+        
+        *((OEData **)data) = &this->data;
+        
+        return true;
+    }
+    
+private:
+    OEData data;
+};
+
+class TestVIA : public OEComponent
+{
+public:
+    bool postMessage(OEComponent *sender, int message, void *data)
+    {
+        if ((message != MOS6522_GET_PA) && (message != MOS6522_GET_PB))
+            return false;
+        
+        *((OEChar *)data) = 0xff;
+        
+        return true;
+    }
+};
+
+class TestVideo : public OEComponent
+{
+public:
+    bool postMessage(OEComponent *sender, int message, void *data)
+    {
+        if (message != APPLEII_IS_VBL)
+            return false;
+        
+        *((bool *)data) = false;
+        
+        return true;
+    }
+};
+
+class TestMachine
+{
+public:
+    AppleIIISystemControl systemControl;
+    
+    TestSwitcher zeroPageSwitcher;
+    TestSwitcher bankSwitcher;
+    TestSwitcher extendedZeroPageSwitcher;
+    TestSwitcher extendedBankSwitcher;
+    
+    TestMachine()
+    {
+        systemControl.setRef("cpu", &component);
+        systemControl.setRef("controlBus", &component);
+        systemControl.setRef("zeroPageSwitcher", &zeroPageSwitcher);
+        systemControl.setRef("bankSwitcher", &bankSwitcher);
+        systemControl.setRef("extendedZeroPageSwitcher", &extendedZeroPageSwitcher);
+        systemControl.setRef("extendedBankSwitcher", &extendedBankSwitcher);
+        systemControl.setRef("ram", &ram);
+        systemControl.setRef("keyboard", &component);
+        systemControl.setRef("video", &video);
+        systemControl.setRef("rtc", &component);
+        systemControl.setRef("dVIA", &via);
+        systemControl.setRef("eVIA", &via);
+        systemControl.setRef("dac", &component);
+    }
+    
+    bool init()
+    {
+        return systemControl.init();
+    }
+    
+private:
+    OEComponent component;
+    TestRAM ram;
+    TestVIA via;
+    TestVideo video;
+};
+
+static bool checkOffset(string name, TestSwitcher& switcher,
+                        OEAddress startAddress, OESLong offset)
+{
+    if (switcher.offsets[startAddress] == offset)
+        return true;
+    
+    printf("%s maps %s to offset %s, expected %s\n",
+           name.c_str(),
+           getHexString(startAddress).c_str(),
+           getHexString(switcher.offsets[startAddress]).c_str(),
+           getHexString(offset).c_str());
+    
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    TestMachine saved;
+    
+    if (!saved.init())
+        return 1;
+    
+    OEChar extendedRAMBank = 0x5;
+    
+    saved.systemControl.write(0x1, 0x1a);
+    saved.systemControl.write(0x2, 0xf3);
+    saved.systemControl.postMessage(NULL, APPLEIII_SET_EXTENDEDRAMBANK, &extendedRAMBank);
+    
+    OESnapshot snapshot;
+    
+    if (!saved.systemControl.serialize(&snapshot))
+        return 1;
+    
+    // A fresh machine maps the banks from the VIA ports
+    TestMachine restored;
+    
+    if (!restored.init())
+        return 1;
+    
+    snapshot.rewind();
+    
+    if (!restored.systemControl.deserialize(&snapshot))
+    {
+        printf("could not deserialize the system control\n");
+        
+        return 1;
+    }
+    
+    bool success = true;
+    
+    success &= checkOffset("zeroPageSwitcher", restored.zeroPageSwitcher,
+                           0x0000, 0x1a00);
+    success &= checkOffset("extendedZeroPageSwitcher", restored.extendedZeroPageSwitcher,
+                           0x0000, 0x1a00);
+    success &= checkOffset("bankSwitcher", restored.bankSwitcher,
+                           0x2000, 3 * APPLEIII_BANKSIZE - 0x2000);
+    success &= checkOffset("extendedBankSwitcher", restored.extendedBankSwitcher,
+                           0x0000, 5 * APPLEIII_BANKSIZE);
+    success &= checkOffset("extendedBankSwitcher", restored.extendedBankSwitcher,
+                           0x8000, 6 * APPLEIII_BANKSIZE - 0x8000);
+    
+    return success ? 0 : 1;
+}